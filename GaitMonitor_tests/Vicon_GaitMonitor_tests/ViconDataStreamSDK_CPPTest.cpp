@@ -10,6 +10,7 @@
 ///////////////////////////////////////////////////////////////////////////////
 #include "include/Vicon/inc/DataStreamClient.h"
 #include "util/MemManager.h"
+#include "components/Comp_ViconHandler.h"
 
 #include <cassert>
 #include <chrono>
@@ -246,6 +247,8 @@ int main( int argc, char* argv[] )
   bool bQuiet = false;
   bool bUnlabelled = false;
   bool bOptimizeWireless = false;
+  bool bNameScan = false;
+  double LatencyBudgetMs = 20;
 
   std::vector<std::string> HapticOnList(0);
   unsigned int ClientBufferSize = 0;
@@ -271,6 +274,8 @@ int main( int argc, char* argv[] )
       std::cout << " --pre-fetch" << std::endl;
       std::cout << " --stream" << std::endl;
       std::cout << " --optimize-wireless" << std::endl;
+      std::cout << " --name-scan" << std::endl;
+      std::cout << " --latency-budget <milliseconds>" << std::endl;
       
       return 0;
     }
@@ -417,6 +422,20 @@ int main( int argc, char* argv[] )
     {
       bOptimizeWireless = true;
     }
+    else if ( arg == "--name-scan" )
+    {
+      // Read the markers with the original scan of every subject and marker name (to compare the ingest time)
+      bNameScan = true;
+    }
+    else if ( arg == "--latency-budget" )
+    {
+      // Latency of a frame (SDK latency + ingest) above which an alarm is raised, 0 to disable it
+      if( a + 1 < argc )
+      {
+        LatencyBudgetMs = atof( argv[a+1] );
+        ++a;
+      }
+    }
     else
     {
       std::cout << "Failed to understand argument <" << argv[a] << ">...exiting" << std::endl;
@@ -651,21 +670,13 @@ int main( int argc, char* argv[] )
 
   bool bSubjectFilterApplied = false;
 
-  double RHEEx = 0;
-  double RHEEy = 0;
-  double RHEEz = 0;
-  double LHEEx = 0;
-  double LHEEy = 0;
-  double LHEEz = 0;
-  double RTOEx = 0;
-  double RTOEy = 0;
-  double RTOEz = 0;
-  double LTOEx = 0;
-  double LTOEy = 0;
-  double LTOEz = 0;
+  // Local copy of the marker frame, published to the shared memory as a whole once all markers have been read
+  MarkerFrame vicon_frame = {};
 
   {
     ViconDataStreamSDK::CPP::Client & MyClient( ConnectToMultiCast ? MulticastClient : DirectClient );
+    ViconHandler MarkerHandler( MyClient );
+    MarkerHandler.set_latency_budget( LatencyBudgetMs / 1000 );
 
     size_t Counter = 0;
     const std::chrono::high_resolution_clock::time_point StartTime = std::chrono::high_resolution_clock::now();
@@ -676,20 +687,13 @@ int main( int argc, char* argv[] )
     while( true)
   #endif
     {
-      // Get a frame
-      // OutputStream << "Waiting for new frame...";
-      while( MyClient.GetFrame().Result != Result::Success )
+      // Get a frame: GetFrame blocks until the next frame arrives (ServerPush by default), and failed calls are retried
+      // with a bounded backoff of at most a few milliseconds; a timeout returns to the loop to check for a key press
+      if( !MarkerHandler.WaitForFrame( 200 ) )
       {
-        // Sleep a little so that we don't lumber the CPU with a busy poll
-        #ifdef WIN32
-          Sleep( 200 );
-        #else
-          sleep(1);
-        #endif
-
         OutputStream << ".";
+        continue;
       }
-      OutputStream << std::endl;
 
       // We have to call this after the call to get frame, otherwise we don't have any subject info
       // to map the name to ids
@@ -708,55 +712,18 @@ int main( int argc, char* argv[] )
       Output_GetFrameNumber _Output_GetFrameNumber = MyClient.GetFrameNumber();
       OutputStream << "Frame Number: " << _Output_GetFrameNumber.FrameNumber << std::endl;
 
-      // Count the number of subjects
-      unsigned int SubjectCount = MyClient.GetSubjectCount().SubjectCount;
-      // OutputStream << "Subjects (" << SubjectCount << "):" << std::endl;
-      for( unsigned int SubjectIndex = 0 ; SubjectIndex < SubjectCount ; ++SubjectIndex )
+      // Read the heel and toe markers: their subject and marker names are resolved once and cached by the handler,
+      // which is timed from the first to the last marker of the frame
+      if( bNameScan )
       {
-        // OutputStream << "  Subject #" << SubjectIndex << std::endl;
-
-        // Get the subject name
-        std::string SubjectName = MyClient.GetSubjectName( SubjectIndex ).SubjectName;
-        // OutputStream << "    Name: " << SubjectName << std::endl;
-
-        // Count the number of markers
-        unsigned int MarkerCount = MyClient.GetMarkerCount( SubjectName ).MarkerCount;
-        // OutputStream << "    Markers (" << MarkerCount << "):" << std::endl;
-        for( unsigned int MarkerIndex = 0 ; MarkerIndex < MarkerCount ; ++MarkerIndex )
-        {
-          // Get the marker name
-          std::string MarkerName = MyClient.GetMarkerName( SubjectName, MarkerIndex ).MarkerName;
-
-          // Get the marker parent
-          std::string MarkerParentName = MyClient.GetMarkerParentName( SubjectName, MarkerName ).SegmentName;
-
-          // Get the global marker translation
-          Output_GetMarkerGlobalTranslation _Output_GetMarkerGlobalTranslation =
-            MyClient.GetMarkerGlobalTranslation( SubjectName, MarkerName );
-
-          if (MarkerName == "RHEE") {
-            SharedMem.data->RHEEx = (_Output_GetMarkerGlobalTranslation.Translation[ 0 ]);
-            SharedMem.data->RHEEy = (_Output_GetMarkerGlobalTranslation.Translation[ 1 ]);
-            SharedMem.data->RHEEz = (_Output_GetMarkerGlobalTranslation.Translation[ 2 ]);
-          } 
-          if (MarkerName == "LHEE") {
-            SharedMem.data->LHEEx = (_Output_GetMarkerGlobalTranslation.Translation[ 0 ]);
-            SharedMem.data->LHEEy = (_Output_GetMarkerGlobalTranslation.Translation[ 1 ]);
-            SharedMem.data->LHEEz = (_Output_GetMarkerGlobalTranslation.Translation[ 2 ]);
-          }
-          if (MarkerName == "RTOE") {
-            SharedMem.data->RTOEx = (_Output_GetMarkerGlobalTranslation.Translation[ 0 ]);
-            SharedMem.data->RTOEy = (_Output_GetMarkerGlobalTranslation.Translation[ 1 ]);
-            SharedMem.data->RTOEz = (_Output_GetMarkerGlobalTranslation.Translation[ 2 ]);
-          }
-          if (MarkerName == "LTOE") {
-            SharedMem.data->LTOEx = (_Output_GetMarkerGlobalTranslation.Translation[ 0 ]);
-            SharedMem.data->LTOEy = (_Output_GetMarkerGlobalTranslation.Translation[ 1 ]);
-            SharedMem.data->LTOEz = (_Output_GetMarkerGlobalTranslation.Translation[ 2 ]);
-          }
-          SharedMem.data->frame = _Output_GetFrameNumber.FrameNumber;
-        }
+        MarkerHandler.ScanFrame( vicon_frame );
       }
+      else
+      {
+        MarkerHandler.ReadFrame( vicon_frame );
+      }
+      // Publish the complete frame to the shared memory once (seqlock protected, never blocks)
+      SharedMem.WriteMarkers(vicon_frame);
       ++Counter;
     }
 
@@ -785,6 +752,19 @@ int main( int argc, char* argv[] )
       MyClient.DisableVideoData();
     }
 
+    // Report the ingest time of the markers per frame
+    const ViconIngestStats& IngestStats = MarkerHandler.stats();
+    std::cout << "Marker ingest (" << ( bNameScan ? "name scan" : "cached names" ) << "): " << IngestStats.frames << " frames, mean "
+              << ( IngestStats.frames > 0 ? IngestStats.total_us / IngestStats.frames : 0 ) << " us, max " << IngestStats.max_us
+              << " us, " << IngestStats.resolutions << " name resolutions, " << IngestStats.missing << " missing markers" << std::endl;
+    std::cout << "Frame arrival: " << IngestStats.dropped_frames << " dropped frames, " << IngestStats.failed_gets << " failed GetFrame calls, "
+              << IngestStats.backoffs << " backoffs, max latency " << IngestStats.max_latency_s * 1000 << " ms, "
+              << IngestStats.latency_alarms << " frames over the latency budget of " << LatencyBudgetMs << " ms" << std::endl;
+    const ViconArrivalHistogram& ArrivalHistogram = MarkerHandler.arrival_histogram();
+    std::cout << "Frame arrival intervals: mean " << ArrivalHistogram.Mean() << " ms, min " << ArrivalHistogram.Min() << " ms, max "
+              << ArrivalHistogram.Max() << " ms, 99th percentile " << ArrivalHistogram.Percentile( 0.99 ) << " ms" << std::endl;
+    ArrivalHistogram.Print( std::cout, "ms" );
+
     // Disconnect Shm
     SharedMem.Disconnect();
 
@@ -0,0 +1,67 @@
+// Bench_ButterworthBlock.cpp
+
+// Description: Throughput of the ButterworthFilter in samples per second when a recorded trial is reprocessed
+// sample by sample (filter(double), one call per sample) and block by block (filter(const double*, double*, size_t)).
+// The vertical heel coordinate of the recorded trial in shared_mem_GaitMonitor_tests/test_input_files is repeated
+// until the signal is long enough for a stable measurement.
+
+#include "components/Comp_GaitMonitor.h"
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+const char* kTrialFile = "../shared_mem_GaitMonitor_tests/test_input_files/testing_vicon_input_healthy_subj_vst2.txt";
+const size_t kMinSamples = 20000000;
+
+int main() {
+    // Load the vertical coordinate of the left heel marker from the recorded trial
+    ifstream infile(kTrialFile);
+    if (!infile.is_open()) {
+        cerr << "Error opening the file " << kTrialFile << endl;
+        return 1;
+    }
+    vector<double> trial;
+    int frame, offline_fvespa_fs;
+    double lhee_y, lhee_z;
+    while (infile >> frame >> lhee_y >> lhee_z >> offline_fvespa_fs) {
+        trial.push_back(lhee_z);
+    }
+    vector<double> signal;
+    signal.reserve(kMinSamples + trial.size());
+    while (signal.size() < kMinSamples) {
+        signal.insert(signal.end(), trial.begin(), trial.end());
+    }
+    vector<double> scalar_output(signal.size()), block_output(signal.size());
+    cout << "Samples: " << signal.size() << " (" << trial.size() << " per trial)" << endl;
+
+    // (1) Sample by sample
+    ButterworthFilter scalar_filter(20, 100);
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < signal.size(); i++) {
+        scalar_output[i] = scalar_filter.filter(signal[i]);
+    }
+    double scalar_s = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    // (2) Whole trial blocks, as when a recording is reprocessed or a backlog of frames is drained
+    ButterworthFilter block_filter(20, 100);
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < signal.size(); i += trial.size()) {
+        block_filter.filter(signal.data() + i, block_output.data() + i, min(trial.size(), signal.size() - i));
+    }
+    double block_s = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    double max_diff = 0;
+    for (size_t i = 0; i < signal.size(); i++) {
+        max_diff = max(max_diff, fabs(scalar_output[i] - block_output[i]));
+    }
+
+    cout << fixed << setprecision(1)
+         << "filter(double):                 " << signal.size() / scalar_s / 1e6 << " Msamples/s" << endl
+         << "filter(const double*, double*): " << signal.size() / block_s / 1e6 << " Msamples/s" << endl
+         << setprecision(2) << "Speed-up: " << scalar_s / block_s << "x, max difference: " << scientific << max_diff << endl;
+    return 0;
+}
@@ -0,0 +1,95 @@
+// Bench_FVespaParams.cpp
+
+// Description: Time per frame of the F-VESPA algorithm on the recorded trial of shared_mem_GaitMonitor_tests, with the
+// parameters of the detection conditions read from the detector at run time (FootStrikeDetector constructed with an
+// FVespaParams) and fixed at compile time (FootStrikeDetector::FVESPA<Params>), for the healthy and the prosthesis
+// parameters. Both paths must detect the same foot-strikes; the trial is replayed several times to get stable timings.
+
+#include "components/Comp_GaitMonitor.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+const char* kTrialFile = "../shared_mem_GaitMonitor_tests/test_input_files/testing_vicon_input_healthy_subj_vst2.txt";
+const double kCutoffFreq = 20;          // [Hz] Cutoff frequency of the Butterworth filter
+const double kSampleFreq = 100;         // [Hz] Sampling frequency of Vicon
+const int kRepetitions = 50;            // Number of replays of the trial per measurement
+
+// Replay the trial through a detector with run-time parameters; returns the time per frame [ns]
+double RunRuntime(const FVespaParams& params, const vector<int>& frames, const vector<double>& vert, const vector<double>& sag,
+                  vector<int>& foot_strikes) {
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < kRepetitions; r++) {
+        FootStrikeDetector detector(params, TimeSource::FRAME_CLOCK, kSampleFreq);
+        for (size_t i = 0; i < frames.size(); i++) {
+            if (detector.FVESPA(frames[i], vert[i], sag[i]) && r == 0) {
+                foot_strikes.push_back(detector.last_hs_frame);
+            }
+        }
+    }
+    auto stop = chrono::steady_clock::now();
+    return chrono::duration<double, nano>(stop - start).count() / (static_cast<double>(kRepetitions) * frames.size());
+}
+
+// Replay the trial through a detector with compile-time parameters; returns the time per frame [ns]
+template <const FVespaParams& Params>
+double RunStatic(const vector<int>& frames, const vector<double>& vert, const vector<double>& sag, vector<int>& foot_strikes) {
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < kRepetitions; r++) {
+        FootStrikeDetector detector(TimeSource::FRAME_CLOCK, kSampleFreq);
+        for (size_t i = 0; i < frames.size(); i++) {
+            if (detector.FVESPA<Params>(frames[i], vert[i], sag[i]) && r == 0) {
+                foot_strikes.push_back(detector.last_hs_frame);
+            }
+        }
+    }
+    auto stop = chrono::steady_clock::now();
+    return chrono::duration<double, nano>(stop - start).count() / (static_cast<double>(kRepetitions) * frames.size());
+}
+
+int main() {
+    // Load the frames and the coordinates of the left heel marker from the recorded trial
+    ifstream infile(kTrialFile);
+    if (!infile.is_open()) {
+        cerr << "Error opening the file " << kTrialFile << endl;
+        return 1;
+    }
+    vector<int> frames;
+    vector<double> vert, sag;
+    int frame, offline_fvespa_fs;
+    double lhee_y, lhee_z;
+    while (infile >> frame >> lhee_y >> lhee_z >> offline_fvespa_fs) {
+        frames.push_back(frame);
+        sag.push_back(lhee_y);
+        vert.push_back(lhee_z);
+    }
+    ButterworthFilter filter_vert(kCutoffFreq, kSampleFreq), filter_sag(kCutoffFreq, kSampleFreq);
+    filter_vert.filter(vert, vert);
+    filter_sag.filter(sag, sag);
+    cout << "Frames: " << frames.size() << " (replayed " << kRepetitions << " times)" << endl;
+
+    cout << fixed << setprecision(2);
+    cout << setw(12) << "Parameters" << setw(14) << "Foot-strikes" << setw(18) << "Run-time [ns]" << setw(20) << "Compile-time [ns]"
+         << setw(11) << "Speedup" << setw(11) << "Identical" << endl;
+    bool all_identical = true;
+    for (int p = 0; p < 2; p++) {
+        vector<int> runtime_strikes, static_strikes;
+        double runtime_ns, static_ns;
+        if (p == 0) {
+            runtime_ns = RunRuntime(kHealthyFVespaParams, frames, vert, sag, runtime_strikes);
+            static_ns = RunStatic<kHealthyFVespaParams>(frames, vert, sag, static_strikes);
+        }
+        else {
+            runtime_ns = RunRuntime(kProsthesisFVespaParams, frames, vert, sag, runtime_strikes);
+            static_ns = RunStatic<kProsthesisFVespaParams>(frames, vert, sag, static_strikes);
+        }
+        bool identical = runtime_strikes == static_strikes;
+        all_identical = all_identical && identical;
+        cout << setw(12) << (p == 0 ? "Healthy" : "Prosthesis") << setw(14) << runtime_strikes.size() << setw(18) << runtime_ns
+             << setw(20) << static_ns << setw(11) << runtime_ns / static_ns << setw(11) << (identical ? "yes" : "NO") << endl;
+    }
+    return all_identical ? 0 : 1;
+}
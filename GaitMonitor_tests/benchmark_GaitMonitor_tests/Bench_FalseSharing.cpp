@@ -0,0 +1,153 @@
+// Bench_FalseSharing.cpp
+
+// Description: Measure the cost of cross-core cache-line invalidations in the shared memory.
+// Three threads play the role of the processes writing the shared memory: the Vicon process (marker coordinates
+// and frame number), the GaitMonitor (gait cycle percentages, rewritten on every iteration of its loop) and the
+// treadmill handler (actual belt velocities). Each thread only writes its own fields, as in the real pipeline.
+// With the original packed layout these fields share cache lines, which then bounce between the cores;
+// with the cache-line partitioned SharedMemStruct every writer owns its lines.
+
+#include "util/SharedMemStruct.h"
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <thread>
+
+#ifdef __linux__
+  #include <pthread.h>
+#endif
+
+using namespace std;
+
+// Original layout of the shared memory (before the cache-line partitioning), kept here for comparison
+struct LegacySharedMemStruct {
+    int value1;
+    int value2;
+    ExpStates experiment_state;
+    bool VSTcontrol_ready;
+    bool ForcematHandler_ready;
+    bool UserInterface_ready;
+    bool EncoderHandler_ready;
+    bool DAQ_state;
+    float vsm_left_dStiffness_kNpm;
+    float vsm_right_dStiffness_kNpm;
+    int vsm_left_aPos_cnts;
+    int vsm_right_aPos_cnts;
+    float belt_left_dVel_mps;
+    float belt_right_dVel_mps;
+    float belt_left_aVel_rpm;
+    float belt_right_aVel_rpm;
+    float vsm_left_RMS;
+    float vsm_right_RMS;
+    float belt_left_RMS;
+    float belt_right_RMS;
+    MarkerFrame markers;
+    int left_gc;
+    double left_gc_pct;
+    int left_last_hs_frame;
+    double left_gc_dur;
+    double left_time_stamp_hs;
+    int right_gc;
+    double right_gc_pct;
+    int right_last_hs_frame;
+    double right_gc_dur;
+    double right_time_stamp_hs;
+};
+
+// Both layouts live in static storage, so that their alignment is honored
+alignas(64) static LegacySharedMemStruct legacy_mem;
+static SharedMemStruct partitioned_mem;
+
+const long kIterations = 20000000;
+
+// Pin the calling thread to a core (only on Linux, and only if there are enough cores)
+void PinToCore(unsigned int core) {
+#ifdef __linux__
+    if (core < thread::hardware_concurrency()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+#else
+    (void)core;
+#endif
+}
+
+// Writers of the three "processes". The signal fence keeps the compiler from merging the stores of consecutive iterations.
+template <typename Mem>
+void ViconWriter(Mem& mem, long iterations) {
+    for (long i = 0; i < iterations; i++) {
+        double value = static_cast<double>(i);
+        mem.markers.RHEEx = value; mem.markers.RHEEy = value; mem.markers.RHEEz = value;
+        mem.markers.LHEEx = value; mem.markers.LHEEy = value; mem.markers.LHEEz = value;
+        mem.markers.RTOEx = value; mem.markers.RTOEy = value; mem.markers.RTOEz = value;
+        mem.markers.LTOEx = value; mem.markers.LTOEy = value; mem.markers.LTOEz = value;
+        mem.markers.frame = static_cast<int>(i);
+        atomic_signal_fence(memory_order_seq_cst);
+    }
+}
+
+template <typename Mem>
+void GaitMonitorWriter(Mem& mem, long iterations) {
+    for (long i = 0; i < iterations; i++) {
+        mem.left_gc_pct = i * 1e-6;
+        mem.right_gc_pct = i * 2e-6;
+        atomic_signal_fence(memory_order_seq_cst);
+    }
+}
+
+template <typename Mem>
+void TreadmillWriter(Mem& mem, long iterations) {
+    for (long i = 0; i < iterations; i++) {
+        mem.belt_left_aVel_rpm = static_cast<float>(i);
+        mem.belt_right_aVel_rpm = static_cast<float>(i);
+        atomic_signal_fence(memory_order_seq_cst);
+    }
+}
+
+// Run the three writers concurrently and return the mean time per write iteration in ns
+template <typename Mem>
+double RunWriters(Mem& mem) {
+    atomic<int> ready(0);
+    auto timed = [&ready](void (*writer)(Mem&, long), Mem& m, unsigned int core, double& ns_per_iter) {
+        PinToCore(core);
+        ready.fetch_add(1);
+        while (ready.load() < 3) {}     // Start all writers at the same time
+        auto start = chrono::steady_clock::now();
+        writer(m, kIterations);
+        auto stop = chrono::steady_clock::now();
+        ns_per_iter = chrono::duration<double, nano>(stop - start).count() / kIterations;
+    };
+
+    double vicon_ns = 0, gait_ns = 0, treadmill_ns = 0;
+    thread vicon(timed, &ViconWriter<Mem>, ref(mem), 0u, ref(vicon_ns));
+    thread gait(timed, &GaitMonitorWriter<Mem>, ref(mem), 1u, ref(gait_ns));
+    thread treadmill(timed, &TreadmillWriter<Mem>, ref(mem), 2u, ref(treadmill_ns));
+    vicon.join();
+    gait.join();
+    treadmill.join();
+
+    cout << fixed << setprecision(2)
+         << "  Vicon writer:       " << vicon_ns << " ns/iteration" << endl
+         << "  GaitMonitor writer: " << gait_ns << " ns/iteration" << endl
+         << "  Treadmill writer:   " << treadmill_ns << " ns/iteration" << endl;
+    return (vicon_ns + gait_ns + treadmill_ns) / 3;
+}
+
+int main() {
+    cout << "Hardware threads: " << thread::hardware_concurrency() << endl;
+    if (thread::hardware_concurrency() < 3) {
+        cout << "WARNING: fewer than 3 cores, the writers share cores and false sharing cannot be observed" << endl;
+    }
+
+    cout << endl << "===== Packed layout (before) =====" << endl;
+    double legacy_ns = RunWriters(legacy_mem);
+
+    cout << endl << "===== Cache-line partitioned layout (after) =====" << endl;
+    double partitioned_ns = RunWriters(partitioned_mem);
+
+    cout << endl << "Mean cost per write iteration: " << legacy_ns << " ns -> " << partitioned_ns << " ns ("
+         << legacy_ns / partitioned_ns << "x)" << endl;
+    return 0;
+}
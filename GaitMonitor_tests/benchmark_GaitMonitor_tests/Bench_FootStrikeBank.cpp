@@ -0,0 +1,94 @@
+// Bench_FootStrikeBank.cpp
+
+// Description: Time per frame of the F-VESPA algorithm for many feet (e.g. several subjects in one capture volume),
+// with one FootStrikeDetector object per foot and with a single FootStrikeDetectorBank.
+// Every foot replays the left heel trajectory of the recorded trial in shared_mem_GaitMonitor_tests/test_input_files,
+// shifted by a different number of frames, so that the feet do not strike at the same frames.
+
+#include "components/Comp_GaitMonitor.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+
+const char* kTrialFile = "../shared_mem_GaitMonitor_tests/test_input_files/testing_vicon_input_healthy_subj_vst2.txt";
+const int kFrames = 20000;
+const int kFeet[] = {2, 16, 128, 256, 512};
+
+// Return the mean and the 99th percentile of the frame times in microseconds
+void FrameStats(vector<double>& frame_us, double& mean_us, double& p99_us) {
+    mean_us = 0;
+    for (double us : frame_us) {
+        mean_us += us;
+    }
+    mean_us /= frame_us.size();
+    nth_element(frame_us.begin(), frame_us.begin() + frame_us.size() * 99 / 100, frame_us.end());
+    p99_us = frame_us[frame_us.size() * 99 / 100];
+}
+
+int main() {
+    // Load the vertical and sagittal coordinates of the left heel marker from the recorded trial
+    ifstream infile(kTrialFile);
+    if (!infile.is_open()) {
+        cerr << "Error opening the file " << kTrialFile << endl;
+        return 1;
+    }
+    vector<double> trial_vert, trial_sag;
+    int frame, offline_fvespa_fs;
+    double lhee_y, lhee_z;
+    while (infile >> frame >> lhee_y >> lhee_z >> offline_fvespa_fs) {
+        trial_sag.push_back(lhee_y);
+        trial_vert.push_back(lhee_z);
+    }
+    const size_t trial_frames = trial_vert.size();
+
+    cout << "Frames per run: " << kFrames << endl;
+    cout << setw(6) << "Feet" << setw(26) << "FootStrikeDetector [us]" << setw(28) << "FootStrikeDetectorBank [us]"
+         << setw(10) << "Speed-up" << setw(12) << "Strikes" << endl;
+    cout << setw(6) << "" << setw(26) << "mean / p99" << setw(28) << "mean / p99" << endl;
+
+    for (int num_feet : kFeet) {
+        vector<FootStrikeDetector> detectors(num_feet);
+        FootStrikeDetectorBank bank(num_feet);
+        vector<double> vert(num_feet), sag(num_feet);
+        vector<unsigned char> strike(num_feet);
+        vector<double> single_us(kFrames), bank_us(kFrames);
+        long single_strikes = 0, bank_strikes = 0;
+
+        for (int f = 1; f <= kFrames; f++) {
+            // Gather the new samples of all feet (not timed)
+            for (int foot = 0; foot < num_feet; foot++) {
+                size_t sample = (f + 37 * static_cast<size_t>(foot)) % trial_frames;
+                vert[foot] = trial_vert[sample];
+                sag[foot] = trial_sag[sample];
+            }
+            double time_stamp = f * 0.01;
+
+            auto start = chrono::steady_clock::now();
+            for (int foot = 0; foot < num_feet; foot++) {
+                single_strikes += detectors[foot].FVESPA(f, vert[foot], sag[foot], time_stamp);
+            }
+            auto middle = chrono::steady_clock::now();
+            bank_strikes += bank.FVESPA(f, vert.data(), sag.data(), time_stamp, strike.data());
+            auto stop = chrono::steady_clock::now();
+
+            single_us[f - 1] = chrono::duration<double, micro>(middle - start).count();
+            bank_us[f - 1] = chrono::duration<double, micro>(stop - middle).count();
+        }
+
+        double single_mean, single_p99, bank_mean, bank_p99;
+        FrameStats(single_us, single_mean, single_p99);
+        FrameStats(bank_us, bank_mean, bank_p99);
+        ostringstream single_col, bank_col;
+        single_col << fixed << setprecision(3) << single_mean << " / " << single_p99;
+        bank_col << fixed << setprecision(3) << bank_mean << " / " << bank_p99;
+        cout << setw(6) << num_feet << setw(26) << single_col.str() << setw(28) << bank_col.str()
+             << setw(9) << fixed << setprecision(2) << single_mean / bank_mean << "x"
+             << setw(12) << bank_strikes << (bank_strikes == single_strikes ? "" : " (MISMATCH)") << endl;
+    }
+    return 0;
+}
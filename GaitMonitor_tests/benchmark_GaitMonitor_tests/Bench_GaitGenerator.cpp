@@ -0,0 +1,199 @@
+// Bench_GaitGenerator.cpp
+
+// Description: Load and accuracy benchmark of the GaitMonitor pipeline on synthetic gait (util/GaitGenerator.h), whose
+// true foot-strike frames are known, at scales the recorded trial cannot cover.
+//      (1) Throughput of the generator itself (frames/second), which bounds every benchmark built on it.
+//      (2) Accuracy of the BilateralGaitMonitor (Butterworth filters, F-VESPA and fail-safe mechanism) for healthy and
+//          pathological gait at 100 Hz and 1 kHz: every true foot-strike is matched to the first detected foot-strike
+//          of the same foot within 30 ms; true positives, false positives, false negatives, F1 score, mean offset of the
+//          detections (positive: detected frame after the true frame) and foot-strikes inserted by the fail-safe.
+//      (3) Scaling: 50 subjects (100 feet) captured at 1 kHz, filtered by one ButterworthFilterBank and detected by one
+//          FootStrikeDetectorBank, time per frame against the 1000 us frame period.
+// The first 2 s of every run are left out of the accuracy and of the foot-strike counts, as the start-up transient of
+// the filters gives a spurious detection.
+
+#include "components/Comp_BilateralGaitMonitor.h"
+#include "util/GaitGenerator.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+using namespace std;
+
+const size_t kGeneratorFrames = 10000000;
+const double kTrialSeconds = 300;
+const double kToleranceSeconds = 0.03;
+const double kWarmUpSeconds = 2;
+const double kRates[] = {100, 1000};
+const int kSubjects = 50;
+const int kScalingFrames = 10000;
+
+struct Scenario {
+    const char* name;
+    GaitGeneratorParams params;
+};
+
+struct Accuracy {
+    int true_positives = 0, false_positives = 0, false_negatives = 0, inserted = 0;
+    double offset_frames = 0;           // Sum of the offsets of the true positives
+};
+
+// Match the detected foot-strikes of one foot to the true ones (both in increasing frame order); every true foot-strike
+// is matched to the first unmatched detection within "tolerance" frames
+void MatchStrikes(const vector<int>& truth, const vector<int>& detected, int tolerance, Accuracy& accuracy) {
+    size_t d = 0;
+    for (int true_frame : truth) {
+        while (d < detected.size() && detected[d] < true_frame - tolerance) {
+            accuracy.false_positives++;
+            d++;
+        }
+        if (d < detected.size() && detected[d] <= true_frame + tolerance) {
+            accuracy.true_positives++;
+            accuracy.offset_frames += detected[d] - true_frame;
+            d++;
+        }
+        else {
+            accuracy.false_negatives++;
+        }
+    }
+    accuracy.false_positives += static_cast<int>(detected.size() - d);
+}
+
+// Run the BilateralGaitMonitor on synthetic gait and measure its accuracy against the ground truth
+Accuracy MeasureAccuracy(const GaitGeneratorParams& params) {
+    GaitGenerator generator(params);
+    BilateralGaitMonitor gait_monitor(20, params.sample_rate);
+    const int frames = static_cast<int>(kTrialSeconds * params.sample_rate);
+    const int warm_up = static_cast<int>(kWarmUpSeconds * params.sample_rate);
+    vector<int> truth[2], detected[2];
+    Accuracy accuracy;
+    MarkerFrame frame;
+    for (int i = 0; i < frames; i++) {
+        int strikes = generator.Next(frame);
+        BilateralGaitEvents events = gait_monitor.process(frame, frame.frame / params.sample_rate);
+        if (frame.frame < warm_up) {
+            continue;
+        }
+        if (strikes & kGaitLeftStrike) truth[0].push_back(frame.frame);
+        if (strikes & kGaitRightStrike) truth[1].push_back(frame.frame);
+        if (events.left_strike) detected[0].push_back(gait_monitor.left().last_hs_frame);
+        if (events.right_strike) detected[1].push_back(gait_monitor.right().last_hs_frame);
+        accuracy.inserted += events.left_missed + events.right_missed;
+    }
+    const int tolerance = static_cast<int>(kToleranceSeconds * params.sample_rate + 0.5);
+    for (int foot = 0; foot < 2; foot++) {
+        // A true foot-strike in the last frames may be detected after the end of the run
+        if (!truth[foot].empty() && truth[foot].back() > frames - tolerance) {
+            truth[foot].pop_back();
+        }
+        MatchStrikes(truth[foot], detected[foot], tolerance, accuracy);
+    }
+    return accuracy;
+}
+
+int main() {
+    // (1) Throughput of the generator
+    {
+        GaitGenerator generator;
+        vector<MarkerFrame> frames(100000);
+        vector<unsigned char> strikes(frames.size());
+        auto start = chrono::steady_clock::now();
+        for (size_t generated = 0; generated < kGeneratorFrames; generated += frames.size()) {
+            generator.Generate(frames.data(), strikes.data(), frames.size());
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << "Gait generator: " << fixed << setprecision(2) << kGeneratorFrames / seconds / 1e6 << " million frames/s ("
+             << setprecision(1) << seconds / kGeneratorFrames * 1e9 << " ns/frame, both feet)" << endl << endl;
+    }
+
+    // (2) Accuracy for healthy and pathological gait
+    vector<Scenario> scenarios(6);
+    scenarios[0].name = "healthy";
+    scenarios[1].name = "noisy (1 mm)";
+    scenarios[1].params.noise_mm = 1;
+    scenarios[2].name = "variable (CV 5 %)";
+    scenarios[2].params.cycle_variability = 0.05;
+    scenarios[3].name = "dropouts (0.2 %)";
+    scenarios[3].params.dropout_rate = 0.002;
+    scenarios[4].name = "asymmetric (+10 %)";
+    scenarios[4].params.step_asymmetry = 0.1;
+    scenarios[5].name = "low right swing (40 %)";
+    scenarios[5].params.right_swing_scale = 0.4;
+
+    cout << "Accuracy over " << kTrialSeconds << " s of gait (tolerance " << kToleranceSeconds * 1000 << " ms)" << endl;
+    cout << left << setw(24) << "Scenario" << right << setw(8) << "Rate" << setw(7) << "TP" << setw(7) << "FP"
+         << setw(7) << "FN" << setw(8) << "F1" << setw(14) << "Offset [ms]" << setw(10) << "Inserted" << endl;
+    for (double rate : kRates) {
+        for (const Scenario& scenario : scenarios) {
+            GaitGeneratorParams params = scenario.params;
+            params.sample_rate = rate;
+            Accuracy accuracy = MeasureAccuracy(params);
+            double f1 = 2.0 * accuracy.true_positives /
+                        max(1, 2 * accuracy.true_positives + accuracy.false_positives + accuracy.false_negatives);
+            double offset_ms = accuracy.true_positives > 0 ? accuracy.offset_frames / accuracy.true_positives / rate * 1000 : 0;
+            cout << left << setw(24) << scenario.name << right << setw(8) << setprecision(0) << rate
+                 << setw(7) << accuracy.true_positives << setw(7) << accuracy.false_positives
+                 << setw(7) << accuracy.false_negatives << setw(8) << setprecision(3) << f1
+                 << setw(14) << setprecision(1) << offset_ms << setw(10) << accuracy.inserted << endl;
+        }
+    }
+    cout << endl;
+
+    // (3) Scaling: 50 subjects at 1 kHz. The heel trajectories are generated beforehand (not timed), one generator per
+    // subject with its own seed and cadence, so that the feet do not strike at the same frames.
+    {
+        const int feet = 2 * kSubjects;
+        const double rate = 1000;
+        vector<double> heel(static_cast<size_t>(kScalingFrames) * 2 * feet);    // per frame: vertical of all feet, then sagittal
+        int true_strikes = 0;
+        for (int subject = 0; subject < kSubjects; subject++) {
+            GaitGeneratorParams params;
+            params.sample_rate = rate;
+            params.cycle_seconds = 1.0 + 0.004 * subject;
+            params.cycle_variability = 0.02;
+            params.seed = subject + 1;
+            GaitGenerator generator(params);
+            MarkerFrame frame;
+            for (int f = 0; f < kScalingFrames; f++) {
+                int strikes = generator.Next(frame);
+                if (frame.frame >= kWarmUpSeconds * rate) {
+                    true_strikes += ((strikes & kGaitLeftStrike) != 0) + ((strikes & kGaitRightStrike) != 0);
+                }
+                double* row = &heel[static_cast<size_t>(f) * 2 * feet];
+                row[2 * subject] = frame.LHEEz;
+                row[2 * subject + 1] = frame.RHEEz;
+                row[feet + 2 * subject] = frame.LHEEy;
+                row[feet + 2 * subject + 1] = frame.RHEEy;
+            }
+        }
+
+        ButterworthFilterBank filters(2 * feet, 20, rate);
+        FootStrikeDetectorBank detectors(feet);
+        vector<double> filtered(2 * feet);
+        vector<double> frame_us(kScalingFrames);
+        long detected_strikes = 0;
+        for (int f = 0; f < kScalingFrames; f++) {
+            auto start = chrono::steady_clock::now();
+            filters.filter(&heel[static_cast<size_t>(f) * 2 * feet], filtered.data());
+            int strikes = detectors.FVESPA(f + 1, filtered.data(), filtered.data() + feet, (f + 1) / rate);
+            frame_us[f] = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+            detected_strikes += (f + 1 >= kWarmUpSeconds * rate) ? strikes : 0;
+        }
+        double mean_us = 0;
+        for (double us : frame_us) {
+            mean_us += us;
+        }
+        mean_us /= kScalingFrames;
+        nth_element(frame_us.begin(), frame_us.begin() + kScalingFrames * 99 / 100, frame_us.end());
+        double p99_us = frame_us[kScalingFrames * 99 / 100];
+        cout << "Scaling: " << kSubjects << " subjects (" << feet << " feet) at " << setprecision(0) << rate << " Hz, "
+             << kScalingFrames << " frames" << endl;
+        cout << "  filters + F-VESPA: " << setprecision(3) << mean_us << " us/frame mean, " << p99_us << " us/frame p99 ("
+             << setprecision(2) << mean_us / (1e6 / rate) * 100 << " % of the " << setprecision(0) << 1e6 / rate << " us frame period)" << endl;
+        cout << "  foot-strikes after " << setprecision(0) << kWarmUpSeconds << " s: " << detected_strikes << " detected, "
+             << true_strikes << " true" << endl;
+    }
+    return 0;
+}
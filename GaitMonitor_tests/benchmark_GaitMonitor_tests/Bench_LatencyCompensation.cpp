@@ -0,0 +1,175 @@
+// Bench_LatencyCompensation.cpp
+
+// Description: Detection latency of the real-time F-VESPA algorithm on the recorded trial of
+// shared_mem_GaitMonitor_tests/test_input_files, without and with each latency-compensation stage between the
+// Butterworth filter and the detector. The reference foot-strikes are those of the offline F-VESPA implementation
+// in MATLAB (4th column of the trial). For every detection the latency is the frame at which FVESPA returned true
+// minus the frame of the matching offline foot-strike, converted to milliseconds at the sampling frequency.
+// The offline implementation uses the same causal filter, so the latency without compensation is close to zero and
+// a negative latency is a detection before the offline one; the "Removed" column is the gain over no compensation.
+// The last rows replace the Butterworth filter and the first differences by a HeelKalmanTracker per coordinate.
+
+#include "components/Comp_GaitMonitor.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+const char* kTrialFile = "../shared_mem_GaitMonitor_tests/test_input_files/testing_vicon_input_healthy_subj_vst2.txt";
+const double kCutoffFreq = 20;          // [Hz] Cutoff frequency of the Butterworth filter
+const double kSampleFreq = 100;         // [Hz] Sampling frequency of Vicon
+const int kMatchFrames = 15;            // A detection is matched to an offline foot-strike at most this many frames apart
+
+// Detection statistics of one latency-compensation stage
+struct LatencyStats {
+    int matched = 0;                    // Detections matched to an offline foot-strike
+    int extra = 0;                      // Detections without an offline foot-strike
+    int missed = 0;                     // Offline foot-strikes without a detection
+    double latency_ms = 0;              // Mean detection latency (detection frame - offline foot-strike frame)
+    double hs_error_ms = 0;             // Mean error of the reported foot-strike frame (last_hs_frame - offline foot-strike frame)
+    double ns_per_frame = 0;            // Processing time of the detector per frame
+};
+
+// Match the detections to the offline foot-strikes and average their latencies
+LatencyStats Score(const vector<int>& detection_frames, const vector<int>& hs_frames, const vector<int>& offline_fs) {
+    LatencyStats stats;
+    vector<bool> used(offline_fs.size(), false);
+    for (size_t d = 0; d < detection_frames.size(); d++) {
+        // Nearest offline foot-strike not matched yet
+        int best = -1;
+        for (size_t o = 0; o < offline_fs.size(); o++) {
+            if (!used[o] && abs(detection_frames[d] - offline_fs[o]) <= kMatchFrames &&
+                (best < 0 || abs(detection_frames[d] - offline_fs[o]) < abs(detection_frames[d] - offline_fs[best]))) {
+                best = static_cast<int>(o);
+            }
+        }
+        if (best < 0) {
+            stats.extra++;
+            continue;
+        }
+        used[best] = true;
+        stats.matched++;
+        stats.latency_ms += (detection_frames[d] - offline_fs[best]) * 1000 / kSampleFreq;
+        stats.hs_error_ms += (hs_frames[d] - offline_fs[best]) * 1000 / kSampleFreq;
+    }
+    stats.missed = static_cast<int>(count(used.begin(), used.end(), false));
+    if (stats.matched > 0) {
+        stats.latency_ms /= stats.matched;
+        stats.hs_error_ms /= stats.matched;
+    }
+    return stats;
+}
+
+// Detect the foot-strikes of the filtered trajectory with a latency-compensation stage
+LatencyStats Run(LatencyCompensation mode, double horizon, const vector<int>& frames, const vector<double>& vert,
+                 const vector<double>& sag, const vector<int>& offline_fs) {
+    FootStrikeDetector detector(TimeSource::FRAME_CLOCK, kSampleFreq);
+    detector.set_latency_compensation(mode, horizon);
+    vector<int> detection_frames, hs_frames;
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < frames.size(); i++) {
+        if (detector.FVESPA(frames[i], vert[i], sag[i])) {
+            detection_frames.push_back(frames[i]);
+            hs_frames.push_back(detector.last_hs_frame);
+        }
+    }
+    auto stop = chrono::steady_clock::now();
+
+    LatencyStats stats = Score(detection_frames, hs_frames, offline_fs);
+    stats.ns_per_frame = chrono::duration<double, nano>(stop - start).count() / frames.size();
+    return stats;
+}
+
+// Detect the foot-strikes of the raw trajectory with a Kalman tracker per coordinate (the time includes the trackers)
+LatencyStats RunKalman(double process_noise, const vector<int>& frames, const vector<double>& raw_vert,
+                       const vector<double>& raw_sag, const vector<int>& offline_fs) {
+    FootStrikeDetector detector(TimeSource::FRAME_CLOCK, kSampleFreq);
+    HeelKalmanTracker tracker_vert(process_noise), tracker_sag(process_noise);
+    vector<int> detection_frames, hs_frames;
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < frames.size(); i++) {
+        if (detector.FVESPA(frames[i], tracker_vert.update(raw_vert[i]), tracker_sag.update(raw_sag[i]))) {
+            detection_frames.push_back(frames[i]);
+            hs_frames.push_back(detector.last_hs_frame);
+        }
+    }
+    auto stop = chrono::steady_clock::now();
+
+    LatencyStats stats = Score(detection_frames, hs_frames, offline_fs);
+    stats.ns_per_frame = chrono::duration<double, nano>(stop - start).count() / frames.size();
+    return stats;
+}
+
+int main() {
+    // Load the frames, the coordinates of the left heel marker and the offline foot-strikes from the recorded trial
+    ifstream infile(kTrialFile);
+    if (!infile.is_open()) {
+        cerr << "Error opening the file " << kTrialFile << endl;
+        return 1;
+    }
+    vector<int> frames, offline_fs;
+    vector<double> trial_vert, trial_sag;
+    int frame, offline_fvespa_fs, last_offline_fs = -1;
+    double lhee_y, lhee_z;
+    while (infile >> frame >> lhee_y >> lhee_z >> offline_fvespa_fs) {
+        frames.push_back(frame);
+        trial_sag.push_back(lhee_y);
+        trial_vert.push_back(lhee_z);
+        // The 4th column holds the last offline foot-strike frame: every new value is a new foot-strike
+        if (offline_fvespa_fs != last_offline_fs && last_offline_fs != -1) {
+            offline_fs.push_back(offline_fvespa_fs);
+        }
+        last_offline_fs = offline_fvespa_fs;
+    }
+
+    // Filter the heel trajectory once; every stage receives the same filtered samples
+    ButterworthFilter filter_vert(kCutoffFreq, kSampleFreq), filter_sag(kCutoffFreq, kSampleFreq);
+    vector<double> vert, sag;
+    filter_vert.filter(trial_vert, vert);
+    filter_sag.filter(trial_sag, sag);
+
+    double group_delay = ButterworthGroupDelayFrames(kCutoffFreq, kSampleFreq);
+    cout << "Frames: " << frames.size() << ", offline foot-strikes: " << offline_fs.size() << endl;
+    cout << "Group delay of the " << kCutoffFreq << " Hz Butterworth filter: " << group_delay << " frames ("
+         << group_delay * 1000 / kSampleFreq << " ms)" << endl;
+
+    struct Stage {
+        const char* name;
+        LatencyCompensation mode;
+        double horizon;
+    };
+    const Stage stages[] = {
+        {"NONE", LatencyCompensation::NONE, 0},
+        {"LINEAR", LatencyCompensation::LINEAR, group_delay},
+        {"QUADRATIC", LatencyCompensation::QUADRATIC, group_delay},
+        {"ALPHA_BETA", LatencyCompensation::ALPHA_BETA, group_delay},
+        {"LINEAR (2x)", LatencyCompensation::LINEAR, 2 * group_delay},
+        {"ALPHA_BETA (2x)", LatencyCompensation::ALPHA_BETA, 2 * group_delay},
+    };
+
+    cout << fixed << setprecision(2);
+    cout << setw(16) << "Stage" << setw(10) << "Horizon" << setw(9) << "Matched" << setw(7) << "Extra" << setw(8) << "Missed"
+         << setw(14) << "Latency [ms]" << setw(12) << "Removed" << setw(16) << "HS error [ms]" << setw(12) << "ns/frame" << endl;
+    double baseline_ms = 0;
+    for (const Stage& stage : stages) {
+        LatencyStats stats = Run(stage.mode, stage.horizon, frames, vert, sag, offline_fs);
+        if (stage.mode == LatencyCompensation::NONE) {
+            baseline_ms = stats.latency_ms;
+        }
+        cout << setw(16) << stage.name << setw(10) << stage.horizon << setw(9) << stats.matched << setw(7) << stats.extra
+             << setw(8) << stats.missed << setw(14) << stats.latency_ms << setw(12) << baseline_ms - stats.latency_ms
+             << setw(16) << stats.hs_error_ms << setw(12) << stats.ns_per_frame << endl;
+    }
+    const double process_noises[] = {0.1, 0.5, 2};
+    for (double process_noise : process_noises) {
+        LatencyStats stats = RunKalman(process_noise, frames, trial_vert, trial_sag, offline_fs);
+        cout << setw(11) << "KALMAN q=" << setw(5) << setprecision(1) << process_noise << setprecision(2) << setw(10) << "-"
+             << setw(9) << stats.matched << setw(7) << stats.extra << setw(8) << stats.missed << setw(14) << stats.latency_ms
+             << setw(12) << baseline_ms - stats.latency_ms << setw(16) << stats.hs_error_ms << setw(12) << stats.ns_per_frame << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,193 @@
+// Test_FrameSource.cpp
+
+// Description: Runs the GaitMonitor pipeline (BilateralGaitMonitor: Butterworth filters, F-VESPA for both feet and the
+// fail-safe mechanism) directly on the frames of any frame source (components/Comp_FrameSource.h), without the shared
+// memory and without Vicon Nexus, so the same detector can be tested on a plain Linux machine and stress-tested at any
+// rate. The frames are processed as soon as they are read: a recorded trial or synthetic gait is processed as fast as
+// possible, a UDP stream at the rate of its sender. The time stamps are derived from the frame numbers.
+// At the end the frames, the detected foot-strikes of both feet, the achieved frame rate and the processing time per
+// frame are printed; for synthetic gait also the true number of foot-strikes.
+//
+// Usage: Test_FrameSource.exe [options] <source>
+// Sources:
+//      trial:<path>[:<repeat>]     recorded trial (.fvt or .txt), replayed <repeat> times
+//      synthetic[:<frames>[:<rate>]]  synthetic gait of both feet (util/GaitGenerator.h, endless if <frames> is omitted
+//                                  or 0) captured at <rate> Hz (default 100)
+//      udp:<port>                  frames sent by another Test_FrameSource.exe with --forward
+//      vicon:<host:port>           frames streamed by Vicon Nexus (only when built with -DFRAME_SOURCE_VICON, see the makefile)
+// Options:
+//      --forward <ip>:<port>       send every frame read to a UDP receiver, and the end of the stream when the source finishes
+//      --no-detect                 only read (and forward) the frames
+//      --block <n>                 largest number of frames read at once                           (default 64)
+//      --idle-timeout <s>          stop after <s> seconds without a frame (0: wait forever)         (default 2)
+//      --cutoff <Hz>               cutoff frequency of the Butterworth filters                       (default 20)
+//      --print                     print every foot-strike
+//
+// Example (two terminals): build/Test_FrameSource.exe udp:9000
+//                          build/Test_FrameSource.exe --no-detect --forward 127.0.0.1:9000 trial:../shared_mem_GaitMonitor_tests/test_input_files/testing_vicon_input_healthy_subj_vst2.txt
+
+#ifdef _WIN32
+  #include <winsock2.h>     // Must precede windows.h, included by the frame source header
+#endif
+#include "components/Comp_BilateralGaitMonitor.h"
+#include "components/Comp_FrameSource.h"
+#ifdef FRAME_SOURCE_VICON
+  #include "components/Comp_ViconHandler.h"
+#endif
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#ifdef FRAME_SOURCE_VICON
+// Connect to Vicon Nexus and return a frame source streaming its frames (ServerPush mode, marker data only)
+unique_ptr<FrameSource> MakeViconFrameSource(const string& host, ViconDataStreamSDK::CPP::Client& client) {
+    using namespace ViconDataStreamSDK::CPP;
+    cout << "Connecting to " << host << " ..." << flush;
+    while (client.Connect(host).Result != Result::Success) {
+        cout << "." << flush;
+    }
+    cout << endl;
+    client.EnableMarkerData();
+    client.SetStreamMode(StreamMode::ServerPush);
+    return unique_ptr<FrameSource>(new ViconFrameSource(client));
+}
+#endif
+
+int main(int argc, char* argv[]) {
+    string source_description, forward_address;
+    bool detect = true, print = false;
+    size_t block = 64;
+    double idle_timeout = 2, cutoff = 20;
+
+    for (int a = 1; a < argc; a++) {
+        string option = argv[a];
+        if (option.compare(0, 2, "--") != 0) {
+            source_description = option;
+            continue;
+        }
+        if (option == "--no-detect") {
+            detect = false;
+            continue;
+        }
+        if (option == "--print") {
+            print = true;
+            continue;
+        }
+        if (a + 1 >= argc) {
+            cerr << "Missing value of the option " << option << endl;
+            return 1;
+        }
+        string value = argv[++a];
+        if (option == "--forward") forward_address = value;
+        else if (option == "--block") block = static_cast<size_t>(atoi(value.c_str()));
+        else if (option == "--idle-timeout") idle_timeout = atof(value.c_str());
+        else if (option == "--cutoff") cutoff = atof(value.c_str());
+        else {
+            cerr << "Unknown option " << option << endl;
+            return 1;
+        }
+    }
+    if (source_description.empty() || block == 0) {
+        cerr << "Usage: " << argv[0] << " [options] <trial:<path>[:<repeat>] | synthetic[:<frames>[:<rate>]] | udp:<port>>" << endl;
+        return 1;
+    }
+
+    // (1) Open the frame source, and the receiver of the forwarded frames
+    unique_ptr<FrameSource> source;
+#ifdef FRAME_SOURCE_VICON
+    ViconDataStreamSDK::CPP::Client vicon_client;
+    if (source_description.compare(0, 6, "vicon:") == 0) {
+        source = MakeViconFrameSource(source_description.substr(6), vicon_client);
+    }
+    else
+#endif
+    source = MakeFrameSource(source_description);
+    if (!source) {
+        return 1;
+    }
+    UdpFrameSender sender;
+    if (!forward_address.empty()) {
+        size_t colon = forward_address.rfind(':');
+        if (colon == string::npos || !sender.Open(forward_address.substr(0, colon), static_cast<unsigned short>(atoi(forward_address.c_str() + colon + 1)))) {
+            cerr << "Invalid forward address " << forward_address << " (expected <ip>:<port>)" << endl;
+            return 1;
+        }
+    }
+    cout << "Frame source: " << source->Describe() << endl;
+
+    // (2) Read the frames in blocks and run the GaitMonitor pipeline on every frame
+    const double sample_freq = source->SampleRate();
+    BilateralGaitMonitor gait_monitor(cutoff, sample_freq);
+    vector<MarkerFrame> frames(block);
+    unsigned long long num_frames = 0, send_failures = 0;
+    int strikes[2] = {0, 0}, missed[2] = {0, 0};
+    double process_seconds = 0;
+    const int kReadTimeoutMs = 100;
+    auto start = chrono::steady_clock::now(), last_frame_time = start;
+    bool receiving = false;     // whether the first frame has been read (the measured time starts with it)
+
+    while (!source->Finished()) {
+        size_t count = source->Read(frames.data(), block, kReadTimeoutMs);
+        auto now = chrono::steady_clock::now();
+        if (count == 0) {
+            if (idle_timeout > 0 && chrono::duration<double>(now - last_frame_time).count() > idle_timeout) {
+                cout << "No frame for " << idle_timeout << " s, stopping" << endl;
+                break;
+            }
+            continue;
+        }
+        if (!receiving) {
+            start = now;
+            receiving = true;
+        }
+        num_frames += count;
+
+        if (!forward_address.empty() && !sender.Send(frames.data(), count)) {
+            send_failures++;
+        }
+        if (detect) {
+            for (size_t i = 0; i < count; i++) {
+                const MarkerFrame& frame = frames[i];
+                BilateralGaitEvents events = gait_monitor.process(frame, frame.frame / sample_freq);
+                strikes[0] += events.left_strike;
+                strikes[1] += events.right_strike;
+                missed[0] += events.left_missed;
+                missed[1] += events.right_missed;
+                if (print && events.left_strike) {
+                    cout << "Left FS: " << gait_monitor.left().last_hs_frame << endl;
+                }
+                if (print && events.right_strike) {
+                    cout << "Right FS: " << gait_monitor.right().last_hs_frame << endl;
+                }
+            }
+        }
+        last_frame_time = chrono::steady_clock::now();
+        process_seconds += chrono::duration<double>(last_frame_time - now).count();
+    }
+    double elapsed = chrono::duration<double>(last_frame_time - start).count();
+    if (!forward_address.empty()) {
+        sender.SendEnd();
+    }
+
+    // (3) Report
+    cout << "Frames: " << num_frames << " (dropped by the source: " << source->Dropped() << ")" << endl;
+    cout << "Achieved rate: " << (elapsed > 0 ? num_frames / elapsed : 0) << " frames/s over " << elapsed << " s" << endl;
+    if (!forward_address.empty()) {
+        cout << "Forwarded to " << forward_address << " (failed sends: " << send_failures << ")" << endl;
+    }
+    if (detect) {
+        cout << "Foot-strikes: left " << strikes[0] << " (missed, inserted: " << missed[0] << "), right " << strikes[1]
+             << " (missed, inserted: " << missed[1] << ")" << endl;
+        unsigned long long true_strikes[2];
+        if (source->GroundTruth(true_strikes)) {
+            cout << "True foot-strikes: left " << true_strikes[0] << ", right " << true_strikes[1] << endl;
+        }
+        cout << "Processing time: " << (num_frames > 0 ? process_seconds / num_frames * 1e9 : 0) << " ns/frame" << endl;
+    }
+    return 0;
+}
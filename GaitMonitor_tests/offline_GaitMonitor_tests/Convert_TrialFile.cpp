@@ -0,0 +1,73 @@
+// Convert_TrialFile.cpp
+
+// Description: One-shot converter of a recorded trial from the whitespace separated .txt format of
+// shared_mem_GaitMonitor_tests/test_input_files to the memory-mapped binary trial format (util/TrialFile.h).
+// The four columns of the text format are stored as:
+//      "frame"      (int32)   Frame number from Vicon Nexus
+//      "LHEEy"      (float64) Y-coordinate of the left heel marker (sagittal)
+//      "LHEEz"      (float64) Z-coordinate of the left heel marker (vertical)
+//      "offline_fs" (int32)   Last foot-strike frame calculated by the offline F-VESPA in MATLAB
+// The written file is mapped back and compared with the text values before the converter reports success.
+//
+// Usage: Convert_TrialFile.exe <input.txt> <output.fvt> [sampling rate in Hz, default 100]
+
+#include "util/TrialFile.h"
+#include <cstdlib>
+#include <fstream>
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "Usage: " << argv[0] << " <input.txt> <output.fvt> [sampling rate in Hz]" << endl;
+        return 1;
+    }
+    double sample_rate = (argc > 3) ? atof(argv[3]) : 100.0;
+
+    ifstream infile(argv[1]);
+    if (!infile.is_open()) {
+        cerr << "Error opening the file " << argv[1] << endl;
+        return 1;
+    }
+    vector<int32_t> frame, offline_fvespa_fs;
+    vector<double> lhee_y, lhee_z;
+    int32_t f, fs;
+    double y, z;
+    while (infile >> f >> y >> z >> fs) {
+        frame.push_back(f);
+        lhee_y.push_back(y);
+        lhee_z.push_back(z);
+        offline_fvespa_fs.push_back(fs);
+    }
+    infile.close();
+
+    vector<TrialColumn> columns = {
+        {"frame", TrialColumnType::INT32, frame.data()},
+        {"LHEEy", TrialColumnType::FLOAT64, lhee_y.data()},
+        {"LHEEz", TrialColumnType::FLOAT64, lhee_z.data()},
+        {"offline_fs", TrialColumnType::INT32, offline_fvespa_fs.data()}
+    };
+    if (!WriteTrialFile(argv[2], sample_rate, frame.size(), columns)) {
+        return 1;
+    }
+
+    // Check the written file against the parsed text
+    TrialFile trial;
+    if (!trial.Open(argv[2]) || trial.NumFrames() != frame.size()) {
+        cerr << "Verification of " << argv[2] << " failed" << endl;
+        return 1;
+    }
+    TrialSpan<int32_t> frame_col = trial.Column<int32_t>("frame");
+    TrialSpan<double> lhee_y_col = trial.Column<double>("LHEEy");
+    TrialSpan<double> lhee_z_col = trial.Column<double>("LHEEz");
+    TrialSpan<int32_t> fs_col = trial.Column<int32_t>("offline_fs");
+    for (size_t i = 0; i < frame.size(); i++) {
+        if (frame_col[i] != frame[i] || lhee_y_col[i] != lhee_y[i] || lhee_z_col[i] != lhee_z[i] || fs_col[i] != offline_fvespa_fs[i]) {
+            cerr << "Verification of " << argv[2] << " failed at frame " << frame[i] << endl;
+            return 1;
+        }
+    }
+
+    cout << "Converted " << frame.size() << " frames (" << trial.NumColumns() << " columns, " << sample_rate << " Hz) to " << argv[2] << endl;
+    return 0;
+}
@@ -0,0 +1,115 @@
+// Offline_FVESPA.cpp
+
+// Description: Offline ground truth of the F-VESPA algorithm for a recorded trial in the binary trial format
+// (util/TrialFile.h, see Convert_TrialFile), generated in C++ instead of MATLAB. The columns of the trial are used in
+// place from the memory-mapped file: every float64 column (marker coordinate) is zero-phase filtered with the
+// Butterworth filter, all columns in parallel, and the F-VESPA algorithm is run on the filtered LHEEz and LHEEy columns.
+// The foot-strikes are compared with the offline MATLAB foot-strikes of the "offline_fs" column, if the trial has one.
+// With an output path, the filtered columns and the new "cpp_offline_fs" column (last foot-strike frame before every
+// frame, same layout as "offline_fs") are written to a new trial file.
+//
+// Usage: Offline_FVESPA.exe <trial.fvt> [output.fvt] [cutoff frequency in Hz, default 20]
+
+#include "components/Comp_OfflineGaitAnalysis.h"
+#include "util/TrialFile.h"
+#include <chrono>
+#include <cstdlib>
+
+using namespace std;
+
+const int kMatchFrames = 15;            // A foot-strike is matched to a MATLAB foot-strike at most this many frames apart
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cerr << "Usage: " << argv[0] << " <trial.fvt> [output.fvt] [cutoff frequency in Hz]" << endl;
+        return 1;
+    }
+    double cutoff_freq = (argc > 3) ? atof(argv[3]) : 20.0;
+
+    TrialFile trial;
+    if (!trial.Open(argv[1])) {
+        return 1;
+    }
+    TrialSpan<int32_t> frames = trial.Column<int32_t>("frame");
+    if (frames.empty() || trial.Column<double>("LHEEz").empty() || trial.Column<double>("LHEEy").empty()) {
+        cerr << "The trial file " << argv[1] << " does not contain the columns frame, LHEEz and LHEEy." << endl;
+        return 1;
+    }
+    const size_t n = trial.NumFrames();
+
+    // (1) Zero-phase filter every marker coordinate of the trial, all columns in parallel
+    vector<int> marker_columns;
+    for (int c = 0; c < trial.NumColumns(); c++) {
+        if (trial.ColumnType(c) == TrialColumnType::FLOAT64) {
+            marker_columns.push_back(c);
+        }
+    }
+    vector<vector<double>> filtered(marker_columns.size(), vector<double>(n));
+    vector<const double*> inputs;
+    vector<double*> outputs;
+    int vert_index = -1, sag_index = -1;
+    for (size_t m = 0; m < marker_columns.size(); m++) {
+        inputs.push_back(trial.Column<double>(marker_columns[m]).data);
+        outputs.push_back(filtered[m].data());
+        if (marker_columns[m] == trial.FindColumn("LHEEz")) vert_index = static_cast<int>(m);
+        if (marker_columns[m] == trial.FindColumn("LHEEy")) sag_index = static_cast<int>(m);
+    }
+    auto start = chrono::steady_clock::now();
+    FiltFiltChannels(cutoff_freq, trial.SampleRate(), inputs.data(), outputs.data(), static_cast<int>(marker_columns.size()), n);
+    auto filtered_time = chrono::steady_clock::now();
+
+    // (2) F-VESPA on the zero-phase filtered heel trajectory
+    FootStrikeDetector detector(TimeSource::FRAME_CLOCK, trial.SampleRate());
+    vector<int> foot_strikes;
+    for (size_t i = 0; i < n; i++) {
+        if (detector.FVESPA(frames[i], filtered[vert_index][i], filtered[sag_index][i])) {
+            foot_strikes.push_back(detector.last_hs_frame);
+        }
+    }
+    auto stop = chrono::steady_clock::now();
+    cout << "Trial: " << argv[1] << " (" << n << " frames, " << marker_columns.size() << " marker columns, " << trial.SampleRate() << " Hz)" << endl;
+    cout << "Zero-phase filtering: " << chrono::duration<double, milli>(filtered_time - start).count() << " ms, F-VESPA: "
+         << chrono::duration<double, milli>(stop - filtered_time).count() << " ms" << endl;
+    cout << "Foot-strikes: " << foot_strikes.size() << endl;
+
+    // (3) Compare with the foot-strikes of the MATLAB implementation (every new value of the "offline_fs" column)
+    TrialSpan<int32_t> matlab_column = trial.Column<int32_t>("offline_fs");
+    if (!matlab_column.empty()) {
+        vector<int> matlab_strikes;
+        for (size_t i = 1; i < n; i++) {
+            if (matlab_column[i] != matlab_column[i - 1]) {
+                matlab_strikes.push_back(matlab_column[i]);
+            }
+        }
+        int matched = 0;
+        double offset_sum = 0;
+        size_t m = 0;
+        for (int foot_strike : foot_strikes) {
+            while (m < matlab_strikes.size() && matlab_strikes[m] < foot_strike - kMatchFrames) {
+                m++;
+            }
+            if (m < matlab_strikes.size() && abs(matlab_strikes[m] - foot_strike) <= kMatchFrames) {
+                matched++;
+                offset_sum += foot_strike - matlab_strikes[m];
+                m++;
+            }
+        }
+        cout << "MATLAB foot-strikes: " << matlab_strikes.size() << ", matched: " << matched << ", mean offset: "
+             << (matched > 0 ? offset_sum / matched : 0) << " frames (negative: earlier than MATLAB)" << endl;
+    }
+
+    // (4) Write the filtered columns and the foot-strike column
+    if (argc > 2) {
+        vector<int32_t> fs_column = LastFootStrikeColumn(frames.data, n, foot_strikes, frames[0]);
+        vector<TrialColumn> columns = {{"frame", TrialColumnType::INT32, frames.data}};
+        for (size_t m = 0; m < marker_columns.size(); m++) {
+            columns.push_back({trial.ColumnName(marker_columns[m]), TrialColumnType::FLOAT64, filtered[m].data()});
+        }
+        columns.push_back({"cpp_offline_fs", TrialColumnType::INT32, fs_column.data()});
+        if (!WriteTrialFile(argv[2], trial.SampleRate(), n, columns)) {
+            return 1;
+        }
+        cout << "Written the zero-phase filtered columns and cpp_offline_fs to " << argv[2] << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,357 @@
+// Sweep_FVESPA.cpp
+
+// Description: Parameter sweep of the real-time F-VESPA algorithm over a set of recorded trials in the binary trial
+// format (util/TrialFile.h, see Convert_TrialFile). Every combination of a grid of Butterworth cutoff frequencies and
+// F-VESPA thresholds (FVespaParams) is run over every trial, and its detections are scored against the reference
+// foot-strikes of the trials (every new value of the "offline_fs" column, or of the column given with --reference).
+// A detection is matched to a reference foot-strike when its foot-strike frame (last_hs_frame) is at most
+// --tolerance frames away. The combinations are ranked by F1 score, then by mean absolute offset of the matched
+// foot-strikes, and the ranked table is written as tab separated values.
+//
+// The heel trajectory of every trial is filtered once per cutoff frequency before the sweep. The combinations then run
+// on a WorkStealingPool (util/WorkStealingPool.h) using all cores; a run keeps its detector on the stack and scores its
+// detections while streaming, so no memory is allocated per run.
+//
+// Usage: Sweep_FVESPA.exe [options] <trial.fvt | directory of .fvt trials>...
+// Grid options take a single value, a comma separated list or start:stop:step, e.g. --height 400:600:50
+//      --cutoff        cutoff frequency of the Butterworth filter [Hz]         (default 20)
+//      --height        FVespaParams::max_heel_height [mm]                      (default 500)
+//      --rise          FVespaParams::min_swing_rise [mm]                       (default 100)
+//      --vel-vert      FVespaParams::strike_vel_vert_min [mm/frame]            (default 0)
+//      --vel-sag       FVespaParams::strike_vel_sag_max [mm/frame]             (default 0)
+// Other options:
+//      --foot L|R      heel marker (LHEE or RHEE) of the trials                (default L)
+//      --reference     column holding the last reference foot-strike frame   (default offline_fs)
+//      --tolerance     maximum distance of a matched foot-strike [frames]      (default 2)
+//      --threads       number of threads, 0 for one per hardware thread        (default 0)
+//      --out           path of the ranked table                                (default sweep_results.tsv)
+//      --top           number of ranked rows printed to the console            (default 10)
+
+#include "components/Comp_GaitMonitor.h"
+#include "util/TrialFile.h"
+#include "util/WorkStealingPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+  #include <dirent.h>     // For opendir()
+  #include <sys/stat.h>   // For stat()
+#endif
+
+using namespace std;
+
+// Heel trajectory and reference foot-strikes of one trial
+struct SweepTrial {
+    string path;
+    vector<int> frames;
+    vector<double> raw_vert, raw_sag;
+    vector<vector<double>> vert, sag;   // Filtered trajectory, one per cutoff frequency of the grid
+    vector<int> reference;              // Reference foot-strike frames, in order
+};
+
+// Score of one combination of parameters over all trials
+struct SweepResult {
+    size_t combination = 0;
+    double cutoff = 0;
+    FVespaParams params;
+    int true_positives = 0;             // Detections matched to a reference foot-strike
+    int false_positives = 0;            // Detections without a reference foot-strike
+    int false_negatives = 0;            // Reference foot-strikes without a detection
+    double abs_offset_sum = 0;          // [frames] Sum of the absolute offsets of the matched detections
+
+    double precision() const { return true_positives > 0 ? static_cast<double>(true_positives) / (true_positives + false_positives) : 0; }
+    double recall() const { return true_positives > 0 ? static_cast<double>(true_positives) / (true_positives + false_negatives) : 0; }
+    double f1() const { return true_positives > 0 ? 2.0 * true_positives / (2 * true_positives + false_positives + false_negatives) : 0; }
+    double mean_abs_offset() const { return true_positives > 0 ? abs_offset_sum / true_positives : 0; }
+};
+
+// Parse a grid option: "value", "v1,v2,..." or "start:stop:step"
+bool ParseGrid(const string& text, vector<double>& values) {
+    values.clear();
+    size_t first = text.find(':');
+    if (first != string::npos) {
+        size_t second = text.find(':', first + 1);
+        if (second == string::npos) {
+            return false;
+        }
+        double start = atof(text.substr(0, first).c_str());
+        double stop = atof(text.substr(first + 1, second - first - 1).c_str());
+        double step = atof(text.substr(second + 1).c_str());
+        if (step <= 0 || stop < start) {
+            return false;
+        }
+        // Count the steps so that rounding errors neither drop nor add the last value
+        int steps = static_cast<int>(floor((stop - start) / step + 1e-9));
+        for (int i = 0; i <= steps; i++) {
+            values.push_back(start + i * step);
+        }
+        return true;
+    }
+    size_t begin = 0;
+    while (begin <= text.size()) {
+        size_t end = text.find(',', begin);
+        if (end == string::npos) {
+            end = text.size();
+        }
+        if (end == begin) {
+            return false;
+        }
+        values.push_back(atof(text.substr(begin, end - begin).c_str()));
+        begin = end + 1;
+    }
+    return !values.empty();
+}
+
+// Append the path of a trial, or of every .fvt trial in a directory (sorted by name)
+void CollectTrialPaths(const string& path, vector<string>& paths) {
+    vector<string> found;
+#ifdef _WIN32
+    DWORD attributes = GetFileAttributesA(path.c_str());
+    if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_DIRECTORY)) {
+        paths.push_back(path);
+        return;
+    }
+    WIN32_FIND_DATAA entry;
+    HANDLE search = FindFirstFileA((path + "\\*.fvt").c_str(), &entry);
+    if (search != INVALID_HANDLE_VALUE) {
+        do {
+            found.push_back(path + "\\" + entry.cFileName);
+        } while (FindNextFileA(search, &entry));
+        FindClose(search);
+    }
+#else
+    struct stat path_stat;
+    if (stat(path.c_str(), &path_stat) != 0 || !S_ISDIR(path_stat.st_mode)) {
+        paths.push_back(path);
+        return;
+    }
+    DIR* directory = opendir(path.c_str());
+    if (directory != nullptr) {
+        while (struct dirent* entry = readdir(directory)) {
+            string name = entry->d_name;
+            if (name.size() > 4 && name.compare(name.size() - 4, 4, ".fvt") == 0) {
+                found.push_back(path + "/" + name);
+            }
+        }
+        closedir(directory);
+    }
+#endif
+    sort(found.begin(), found.end());
+    paths.insert(paths.end(), found.begin(), found.end());
+}
+
+// Load the heel trajectory and the reference foot-strikes of a trial
+bool LoadTrial(const string& path, const string& foot, const string& reference_column, SweepTrial& trial, double& sample_freq) {
+    TrialFile file;
+    if (!file.Open(path)) {
+        return false;
+    }
+    TrialSpan<int32_t> frames = file.Column<int32_t>("frame");
+    TrialSpan<double> vert = file.Column<double>(foot + "HEEz");
+    TrialSpan<double> sag = file.Column<double>(foot + "HEEy");
+    TrialSpan<int32_t> reference = file.Column<int32_t>(reference_column);
+    if (frames.empty() || vert.empty() || sag.empty() || reference.empty()) {
+        cerr << "The trial file " << path << " does not contain the columns frame, " << foot << "HEEz, " << foot << "HEEy and "
+             << reference_column << "." << endl;
+        return false;
+    }
+    trial.path = path;
+    trial.frames.assign(frames.begin(), frames.end());
+    trial.raw_vert.assign(vert.begin(), vert.end());
+    trial.raw_sag.assign(sag.begin(), sag.end());
+    // The reference column holds the last foot-strike frame: every new value is a new foot-strike
+    for (size_t i = 1; i < reference.size; i++) {
+        if (reference[i] != reference[i - 1]) {
+            trial.reference.push_back(reference[i]);
+        }
+    }
+    sample_freq = file.SampleRate();
+    return true;
+}
+
+// Run F-VESPA with one combination of parameters over one trial and add the score of its detections to "result".
+// The detections are matched in order while streaming: a reference foot-strike is matched to at most one detection.
+void RunTrial(const SweepTrial& trial, size_t cutoff_index, double sample_freq, int tolerance, SweepResult& result) {
+    FootStrikeDetector detector(TimeSource::FRAME_CLOCK, sample_freq);
+    detector.set_params(result.params);
+    const vector<double>& vert = trial.vert[cutoff_index];
+    const vector<double>& sag = trial.sag[cutoff_index];
+    const vector<int>& reference = trial.reference;
+    size_t next_reference = 0;
+    for (size_t i = 0; i < trial.frames.size(); i++) {
+        if (!detector.FVESPA(trial.frames[i], vert[i], sag[i])) {
+            continue;
+        }
+        int foot_strike = detector.last_hs_frame;
+        // Reference foot-strikes too early for this and every later detection are missed
+        while (next_reference < reference.size() && reference[next_reference] < foot_strike - tolerance) {
+            result.false_negatives++;
+            next_reference++;
+        }
+        if (next_reference < reference.size() && abs(reference[next_reference] - foot_strike) <= tolerance) {
+            result.true_positives++;
+            result.abs_offset_sum += abs(reference[next_reference] - foot_strike);
+            next_reference++;
+        }
+        else {
+            result.false_positives++;
+        }
+    }
+    result.false_negatives += static_cast<int>(reference.size() - next_reference);
+}
+
+int main(int argc, char* argv[]) {
+    vector<double> cutoffs = {20}, heights = {500}, rises = {100}, vels_vert = {0}, vels_sag = {0};
+    string foot = "L", reference_column = "offline_fs", out_path = "sweep_results.tsv";
+    int tolerance = 2, num_threads = 0, top = 10;
+    vector<string> paths;
+
+    for (int a = 1; a < argc; a++) {
+        string option = argv[a];
+        if (option.compare(0, 2, "--") != 0) {
+            CollectTrialPaths(option, paths);
+            continue;
+        }
+        if (a + 1 >= argc) {
+            cerr << "Missing value of the option " << option << endl;
+            return 1;
+        }
+        string value = argv[++a];
+        bool ok = true;
+        if (option == "--cutoff") ok = ParseGrid(value, cutoffs);
+        else if (option == "--height") ok = ParseGrid(value, heights);
+        else if (option == "--rise") ok = ParseGrid(value, rises);
+        else if (option == "--vel-vert") ok = ParseGrid(value, vels_vert);
+        else if (option == "--vel-sag") ok = ParseGrid(value, vels_sag);
+        else if (option == "--foot") foot = value;
+        else if (option == "--reference") reference_column = value;
+        else if (option == "--tolerance") tolerance = atoi(value.c_str());
+        else if (option == "--threads") num_threads = atoi(value.c_str());
+        else if (option == "--out") out_path = value;
+        else if (option == "--top") top = atoi(value.c_str());
+        else {
+            cerr << "Unknown option " << option << endl;
+            return 1;
+        }
+        if (!ok) {
+            cerr << "Invalid grid " << value << " of the option " << option << " (expected value, v1,v2,... or start:stop:step)" << endl;
+            return 1;
+        }
+    }
+    if (paths.empty()) {
+        cerr << "Usage: " << argv[0] << " [options] <trial.fvt | directory of .fvt trials>..." << endl;
+        return 1;
+    }
+
+    // (1) Load the trials; all trials must share the sampling frequency of the first one
+    vector<SweepTrial> trials(paths.size());
+    double sample_freq = 0;
+    size_t num_frames = 0, num_reference = 0;
+    for (size_t t = 0; t < paths.size(); t++) {
+        double trial_freq;
+        if (!LoadTrial(paths[t], foot, reference_column, trials[t], trial_freq)) {
+            return 1;
+        }
+        if (t == 0) {
+            sample_freq = trial_freq;
+        }
+        else if (trial_freq != sample_freq) {
+            cerr << "The trial " << paths[t] << " is sampled at " << trial_freq << " Hz instead of " << sample_freq << " Hz." << endl;
+            return 1;
+        }
+        num_frames += trials[t].frames.size();
+        num_reference += trials[t].reference.size();
+    }
+
+    WorkStealingPool pool(num_threads);
+    auto start = chrono::steady_clock::now();
+
+    // (2) Filter the heel trajectory of every trial once per cutoff frequency (causal filter, as in real time)
+    for (SweepTrial& trial : trials) {
+        trial.vert.resize(cutoffs.size());
+        trial.sag.resize(cutoffs.size());
+    }
+    auto filter_task = [&](size_t task, int) {
+        SweepTrial& trial = trials[task / cutoffs.size()];
+        size_t c = task % cutoffs.size();
+        ButterworthFilter filter_vert(cutoffs[c], sample_freq), filter_sag(cutoffs[c], sample_freq);
+        filter_vert.filter(trial.raw_vert, trial.vert[c]);
+        filter_sag.filter(trial.raw_sag, trial.sag[c]);
+    };
+    pool.Run(trials.size() * cutoffs.size(), filter_task);
+    auto filtered_time = chrono::steady_clock::now();
+
+    // (3) Run every combination of the grid over all trials
+    const size_t num_combinations = cutoffs.size() * heights.size() * rises.size() * vels_vert.size() * vels_sag.size();
+    vector<SweepResult> results(num_combinations);
+    auto sweep_task = [&](size_t combination, int) {
+        // Decode the combination index, the last grid varying fastest
+        SweepResult& result = results[combination];
+        size_t index = combination;
+        result.combination = combination;
+        result.params.strike_vel_sag_max = vels_sag[index % vels_sag.size()];
+        index /= vels_sag.size();
+        result.params.strike_vel_vert_min = vels_vert[index % vels_vert.size()];
+        index /= vels_vert.size();
+        result.params.min_swing_rise = rises[index % rises.size()];
+        index /= rises.size();
+        result.params.max_heel_height = heights[index % heights.size()];
+        index /= heights.size();
+        result.cutoff = cutoffs[index];
+        for (const SweepTrial& trial : trials) {
+            RunTrial(trial, index, sample_freq, tolerance, result);
+        }
+    };
+    pool.Run(num_combinations, sweep_task);
+    auto stop = chrono::steady_clock::now();
+
+    // (4) Rank the combinations: highest F1, then smallest mean absolute offset, then fewest false positives
+    sort(results.begin(), results.end(), [](const SweepResult& a, const SweepResult& b) {
+        if (a.f1() != b.f1()) return a.f1() > b.f1();
+        if (a.mean_abs_offset() != b.mean_abs_offset()) return a.mean_abs_offset() < b.mean_abs_offset();
+        if (a.false_positives != b.false_positives) return a.false_positives < b.false_positives;
+        return a.combination < b.combination;
+    });
+
+    ofstream out(out_path);
+    if (!out.is_open()) {
+        cerr << "Error opening the file " << out_path << endl;
+        return 1;
+    }
+    out << "rank\tcutoff_hz\tmax_heel_height\tmin_swing_rise\tstrike_vel_vert_min\tstrike_vel_sag_max\t"
+           "true_positives\tfalse_positives\tfalse_negatives\tprecision\trecall\tf1\tmean_abs_offset_ms\n";
+    for (size_t r = 0; r < results.size(); r++) {
+        const SweepResult& result = results[r];
+        out << r + 1 << '\t' << result.cutoff << '\t' << result.params.max_heel_height << '\t' << result.params.min_swing_rise << '\t'
+            << result.params.strike_vel_vert_min << '\t' << result.params.strike_vel_sag_max << '\t' << result.true_positives << '\t'
+            << result.false_positives << '\t' << result.false_negatives << '\t' << result.precision() << '\t' << result.recall() << '\t'
+            << result.f1() << '\t' << result.mean_abs_offset() * 1000 / sample_freq << '\n';
+    }
+
+    double sweep_ms = chrono::duration<double, milli>(stop - filtered_time).count();
+    cout << "Trials: " << trials.size() << " (" << num_frames << " frames, " << num_reference << " reference foot-strikes, "
+         << sample_freq << " Hz)" << endl;
+    cout << "Combinations: " << num_combinations << " on " << pool.Threads() << " threads (" << pool.Steals() << " steals)" << endl;
+    cout << "Filtering: " << chrono::duration<double, milli>(filtered_time - start).count() << " ms, sweep: " << sweep_ms << " ms ("
+         << sweep_ms * 1e6 / (static_cast<double>(num_combinations) * num_frames) << " ns per frame and combination)" << endl;
+    cout << fixed << setprecision(2);
+    cout << setw(5) << "Rank" << setw(8) << "Cutoff" << setw(8) << "Height" << setw(7) << "Rise" << setw(10) << "Vel vert"
+         << setw(9) << "Vel sag" << setw(6) << "TP" << setw(6) << "FP" << setw(6) << "FN" << setw(7) << "F1"
+         << setw(13) << "Offset [ms]" << endl;
+    for (int r = 0; r < top && r < static_cast<int>(results.size()); r++) {
+        const SweepResult& result = results[r];
+        cout << setw(5) << r + 1 << setw(8) << result.cutoff << setw(8) << result.params.max_heel_height << setw(7)
+             << result.params.min_swing_rise << setw(10) << result.params.strike_vel_vert_min << setw(9) << result.params.strike_vel_sag_max
+             << setw(6) << result.true_positives << setw(6) << result.false_positives << setw(6) << result.false_negatives
+             << setw(7) << result.f1() << setw(13) << result.mean_abs_offset() * 1000 / sample_freq << endl;
+    }
+    cout << "Ranked table written to " << out_path << endl;
+    return 0;
+}
@@ -8,6 +8,7 @@
 // https://doi.org/10.1016/j.jbiomech.2021.110849
 
 #include "components/Comp_GaitMonitor.h"
+#include "components/Comp_GaitEvents.h"
 #include "util/MemManager.h"
 
 // Define constants
@@ -25,19 +26,47 @@ int main() {
 	// Print out message to indicate that the connection to the shared memory has been established
 	cout << "Connected to Shared Memory" << endl;
 
-	// Declare two ButterworthFilter objects of specicied cutoff frequency and sampling frequency
-    double cutoffFrequency = 20; 		// Hz
-    double samplingFrequency = 100; 	// Hz
-    ButterworthFilter filter_lhee_y(cutoffFrequency, samplingFrequency);
-    ButterworthFilter filter_lhee_z(cutoffFrequency, samplingFrequency);
+	// Declare two Butterworth filters of cutoff frequency 20 Hz and sampling frequency 100 Hz,
+	// which are fixed at build time so that the filter coefficients are compile-time constants
+    FixedButterworthFilter<20, 100> filter_lhee_y;
+    FixedButterworthFilter<20, 100> filter_lhee_z;
 
 	// Declare a FootStrikeDetector object to detect foot-strike events
-    FootStrikeDetector left_foot;
-
-	int iter_count;
+	// Its time stamps are derived from the frame numbers, so the replay gives the same gait cycle durations at any speed
+    FootStrikeDetector left_foot(TimeSource::FRAME_CLOCK, 100);
+    // Sink publishing the foot-strike events to the shared memory
+    SharedMemGaitSink shared_mem_sink(SharedMem.data);
+
+	// Marker frames taken from the marker ring of the shared memory, and their heel coordinates (raw and filtered)
+	MarkerFrame markers[kMarkerRingCapacity];
+	double lhee_y[kMarkerRingCapacity], lhee_z[kMarkerRingCapacity];
+
+	// Process every frame received from Vicon since the last call, in order, so that the velocities of the F-VESPA
+	// algorithm stay correct even if this process was descheduled. Returns the number of frames processed.
+	auto process_pending_markers = [&]() {
+		// (1) Load all pending frames from the shared memory (usually one, more when catching up)
+		size_t num_frames = SharedMem.PopMarkers(markers, kMarkerRingCapacity);
+		for (size_t i = 0; i < num_frames; i++){
+			lhee_y[i] = markers[i].LHEEy;
+			lhee_z[i] = markers[i].LHEEz;
+		}
+		// (2) Filter the new samples as one block using the "filter" method of the "Butterworthfilter" class
+		filter_lhee_y.filter(lhee_y, lhee_y, num_frames);
+		filter_lhee_z.filter(lhee_z, lhee_z, num_frames);
+		for (size_t i = 0; i < num_frames; i++){
+			// (3) Use the filtered sampled as inputs for the F-VESPA algorithm to detect foot-strike events
+			// (4) Check whether a new foot-strike event has been detected or not for the new frame
+			if (left_foot.FVESPA(markers[i].frame,lhee_z[i],lhee_y[i])){
+				//New heel-strike detected - update shared memory
+				shared_mem_sink.on_foot_strike(MakeFootStrikeEvent(left_foot, Foot::LEFT, markers[i].frame));
+			}
+		}
+		return num_frames;
+	};
 
 	//----------- Initialization -----------------//
-	iter_count = 1;	// Initialize the local frame number to 1
+	SharedMem.SkipToLatestMarkers();	// Ignore frames published before this process connected
+	unsigned int notify_seen = SharedMem.MarkerNotifyCount();	// Number of published frames already waited for
 
     // Start an infinite loop
     while(true) {
@@ -50,28 +79,18 @@ int main() {
 
             case ExpStates::RUNNING:	// Experiment is running
 
-                // Run only when a new frame has been received from Vicon
-                if (SharedMem.data->frame != iter_count){
-                // Read all the variables and write to shared memory
-
-					iter_count = SharedMem.data->frame; //Update the local frame number
-
-					// (1) Load the new raw samples of the heel marker position (y and z) from the shared memory
-					// (2) Filter the new samples using the "filter" method of the "Butterworthfilter" class
-					// (3) Use the filtered sampled as inputs for the F-VESPA algorithm to detect foot-strike events
-					// (4) Check whether a new foot-strike event has been detected or not for the new frame
-					if (left_foot.FVESPA(SharedMem.data->frame,filter_lhee_z.filter(SharedMem.data->LHEEz),filter_lhee_y.filter(SharedMem.data->LHEEy))){
-						//New heel-strike detected - update shared memory
-						SharedMem.data->left_gc = left_foot.gait_cycle;
-						SharedMem.data->left_last_hs_frame = left_foot.last_hs_frame;
-						SharedMem.data->left_gc_dur = left_foot.gait_cycle_duration;
-						SharedMem.data->left_time_stamp_hs = left_foot.time_stamp_hs;
-					}
-				}
+                // Sleep until Vicon publishes a new frame (with a timeout so that a change of the experiment state is noticed)
+                SharedMem.WaitForMarkers(notify_seen, 100);
 
+                process_pending_markers();
                 break;
             
             case ExpStates::END:
+                // Process the frames published before the end of the experiment that are still in the marker ring
+                while (process_pending_markers() > 0) {
+                }
+                cout << "Marker frames dropped (ring overruns): " << SharedMem.MarkerOverruns() << endl;
+                cout << "Marker wakeups: " << SharedMem.GetWakeupStats() << endl;
                 cout << "Terminating Loop, Ending Experiment";
                 SharedMem.Disconnect();
                 return 0;
@@ -3,34 +3,110 @@
 // Here, pre-recorded Vicon data are read from a .txt file and loaded to a shared memory.
 // Then, a GaitMonitor process is loading the kinematic data from the shared memory and 
 // foot-strike events are detected using the real-time F-VESPA algorithm for the left foot. 
-// The newly calculated foot-strike frame number is loaded from the shared memory, 
+// The newly calculated foot-strikes are read from the heel-strike log of the shared memory, 
 // and it is compared to the results of an offline implementation of F-VESPA in MATLAB
 // to check the accuracy of the real-time F-VESPA algorithm.
+// By default the frames are replayed at the 100 Hz sampling rate of Vicon (or the sampling rate of a binary trial file),
+// every frame at its absolute deadline (util/ReplayScheduler.h), so the replay does not drift from the recorded timing.
+// "--speed <x>" replays x times faster (e.g. 0.5, 10 or 100), and "--spin <us>" sets the busy-wait before every deadline.
+// With the argument "--unthrottled" the frames are replayed as fast as the GaitMonitor process can consume them; the
+// GaitMonitor uses the frame clock for its time stamps, so the gait cycle durations are the same as in a real-time replay.
+// At the end the achieved frame rate, the deadline misses and the percentiles of the lateness of the frames are printed.
+// The recording is the .txt file in test_input_files unless another file is given as argument; files with the
+// extension .fvt are read as memory-mapped binary trial files (see offline_GaitMonitor_tests/Convert_TrialFile).
 
 #include "util/MemManager.h" 
+#include "util/TrialFile.h"
+#include "util/ReplayScheduler.h"
+#include <chrono>
+#include <cstdlib>
 #include <fstream>
 #include <thread>
+#include <cstring>
 
 using namespace std; 
 
-int main() {
+// Longest wait for the GaitMonitor to take the frames left in the marker ring at the end of the recording, and time
+// given to it afterwards to process them and publish their foot-strikes
+const int kDrainTimeoutMs = 2000;
+const int kSettleMs = 50;
+
+int main(int argc, char* argv[]) {
+    // Replay at the Vicon sampling rate unless "--unthrottled" or "--speed" is given
+    bool unthrottled = false;
+    double speed = 1, spin_seconds = kReplayDefaultSpinSeconds;
+    string trial_path = "test_input_files/testing_vicon_input_healthy_subj_vst2.txt";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--unthrottled") == 0) {
+            unthrottled = true;
+        }
+        else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            speed = atof(argv[++i]);
+            if (speed <= 0) {
+                cerr << "The replay speed must be positive (use --unthrottled to replay as fast as possible)." << endl;
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--spin") == 0 && i + 1 < argc) {
+            spin_seconds = atof(argv[++i]) * 1e-6;
+        }
+        else {
+            trial_path = argv[i];
+        }
+    }
+    bool binary = trial_path.size() > 4 && trial_path.compare(trial_path.size() - 4, 4, ".fvt") == 0;
+
     // Set up connection to the shared memory
     MemManager SharedMem(L"MySharedMemory");
     SharedMem.Create();
     
     // Load input file that contains the Vicon data
-    ifstream infile("test_input_files/testing_vicon_input_healthy_subj_vst2.txt");
-
-    // Check if the file is open
-    if (!infile.is_open()) {
-        cerr << "Error opening the file." << endl;
-        return 1;
+    ifstream infile;
+    TrialFile trial;
+    TrialSpan<int32_t> trial_frame = {}, trial_offline_fs = {};
+    TrialSpan<double> trial_lhee_y = {}, trial_lhee_z = {};
+    size_t trial_index = 0;
+    if (binary) {
+        if (!trial.Open(trial_path)) {
+            return 1;
+        }
+        trial_frame = trial.Column<int32_t>("frame");
+        trial_lhee_y = trial.Column<double>("LHEEy");
+        trial_lhee_z = trial.Column<double>("LHEEz");
+        trial_offline_fs = trial.Column<int32_t>("offline_fs");
+        if (trial_frame.empty() || trial_lhee_y.empty() || trial_lhee_z.empty() || trial_offline_fs.empty()) {
+            cerr << "The trial file " << trial_path << " does not contain the columns frame, LHEEy, LHEEz and offline_fs." << endl;
+            return 1;
+        }
+    }
+    else {
+        infile.open(trial_path);
+        // Check if the file is open
+        if (!infile.is_open()) {
+            cerr << "Error opening the file." << endl;
+            return 1;
+        }
     }
 
-    // Variables to save the frame number of the last heel-strike event detected by the offline F-VESPA algorithm
-    int offline_fvespa_fs,last_realtime_fvespa_fs;
-    last_realtime_fvespa_fs = 0;
+    // Deadlines of the replayed frames (the schedule starts with the experiment)
+    ReplayScheduler scheduler(binary ? trial.SampleRate() : 100, unthrottled ? 0 : speed, spin_seconds);
+
+    // Frame number of the last heel-strike event detected by the offline F-VESPA algorithm
+    int offline_fvespa_fs = 0;
+    // Subscribe to the heel-strike log, so that every foot-strike published by the GaitMonitor is seen exactly once
+    int heel_strike_consumer = SharedMem.SubscribeHeelStrikes();
+    HeelStrikeRecord heel_strike;
+    // Local copy of the marker frame, published to the shared memory as a whole once a line has been read
+    MarkerFrame vicon_frame = {};
     SharedMem.data->experiment_state = ExpStates::NOT_STARTED; // Initialize the experiment state to NOT_STARTED
+    // Print the foot-strikes published to the heel-strike log since the last call
+    auto print_heel_strikes = [&]() {
+        while (SharedMem.PollHeelStrike(heel_strike_consumer, heel_strike)) {
+            if (heel_strike.foot == 0) {     // left foot
+                cout << "Real-time F-VESPA FS: " << heel_strike.frame << " Offline F-VESPA FS: " << offline_fvespa_fs  << endl;
+            }
+        }
+    };
     // Variable to store the user input
     float input;
 	// 1: Experiment Running
@@ -40,6 +116,7 @@ int main() {
     if (input == 1){
 		SharedMem.data->experiment_state = ExpStates::RUNNING;
         cout << "Experiment Started" << endl;
+        scheduler.Start();
 	}
 	else if (input == 2){
 		SharedMem.data->experiment_state = ExpStates::END;
@@ -57,31 +134,65 @@ int main() {
                 break;
 
             case ExpStates::RUNNING:
-				// Read a line from the input file and separate columns based on gaps and store them in 3 variables
-				infile >> SharedMem.data->frame >> SharedMem.data->LHEEy >> SharedMem.data->LHEEz >> offline_fvespa_fs;
+				if (binary) {
+					// Take the next frame directly from the mapped columns
+					vicon_frame.frame = trial_frame[trial_index];
+					vicon_frame.LHEEy = trial_lhee_y[trial_index];
+					vicon_frame.LHEEz = trial_lhee_z[trial_index];
+					offline_fvespa_fs = trial_offline_fs[trial_index];
+					trial_index++;
+				}
+				else {
+					// Read a line from the input file and separate columns based on gaps and store them in 3 variables
+					infile >> vicon_frame.frame >> vicon_frame.LHEEy >> vicon_frame.LHEEz >> offline_fvespa_fs;
+				}
+				// Publish the complete frame to the shared memory at its deadline
+				scheduler.WaitNext();
+				SharedMem.WriteMarkers(vicon_frame);
 
-                // Check whether a new foot-strike event has been detected by the real-time F-VESPA algorithm and 
+                // Take every new foot-strike event detected by the real-time F-VESPA algorithm and
                 // compare with the offline F-VESPA algorithm implemented in MATLAB
-                if (SharedMem.data->left_last_hs_frame != last_realtime_fvespa_fs){
-                    // New foot-strike event detected by the offline F-VESPA algorithm
-                    cout << "Real-time F-VESPA FS: " << SharedMem.data->left_last_hs_frame << " Offline F-VESPA FS: " << offline_fvespa_fs  << endl;
-                    // Update the frame number of the last heel-strike event detected by the offline F-VESPA algorithm
-                    last_realtime_fvespa_fs = SharedMem.data->left_last_hs_frame;
-                }
+                print_heel_strikes();
 
-                // Sleep for 0.01 seconds (10 milliseconds) to similate the 100 Hz sampling rate of Vicon
-                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                if (unthrottled) {
+                    // Wait while the marker ring is full, so that the GaitMonitor does not miss any frame
+                    while (SharedMem.data->marker_ring.Size() >= kMarkerRingCapacity) {
+                        std::this_thread::yield();
+                    }
+                }
 
-                if (infile.eof()) {
-                    // End of file is reached
+                if (binary ? trial_index >= trial_frame.size : infile.eof()) {
+                    // End of file is reached: let the GaitMonitor process the frames still in the marker ring and
+                    // print their foot-strikes before ending the experiment. An empty ring only means that the frames
+                    // were taken, so the log is polled a little longer while the last of them are processed.
+                    auto drain_deadline = chrono::steady_clock::now() + chrono::milliseconds(kDrainTimeoutMs);
+                    while (SharedMem.data->marker_ring.Size() > 0 && chrono::steady_clock::now() < drain_deadline) {
+                        print_heel_strikes();
+                        std::this_thread::yield();
+                    }
+                    if (SharedMem.data->marker_ring.Size() > 0) {
+                        cout << SharedMem.data->marker_ring.Size() << " marker frames were not taken by the GaitMonitor" << endl;
+                    }
+                    auto settle_deadline = chrono::steady_clock::now() + chrono::milliseconds(kSettleMs);
+                    while (chrono::steady_clock::now() < settle_deadline) {
+                        print_heel_strikes();
+                        std::this_thread::sleep_for(chrono::milliseconds(1));
+                    }
+                    print_heel_strikes();
                     SharedMem.data->experiment_state = ExpStates::END;
                 }
 
                 break; 
 
             case ExpStates::END:
+                if (SharedMem.HeelStrikesLost(heel_strike_consumer) > 0) {
+                    cout << SharedMem.HeelStrikesLost(heel_strike_consumer) << " foot-strikes were overwritten before they were read" << endl;
+                }
+                SharedMem.UnsubscribeHeelStrikes(heel_strike_consumer);
+                scheduler.Report(cout);
                 cout << "Terminating Loop, Ending Experiment";
 				infile.close();
+				trial.Close();
                 SharedMem.Disconnect();
                 return 0;
 
@@ -10,14 +10,51 @@
 
 #include "GaitMonitor_tests/unit_GaitMonitor_tests/test_macros.h"
 #include "components/Comp_GaitMonitor.h"
+#include "components/Comp_BilateralGaitMonitor.h"
+#include "components/Comp_OfflineGaitAnalysis.h"
+#include "components/Comp_FrameSource.h"
+#include "util/MemManager.h"
+#include "util/TrialFile.h"
+#include "util/WorkStealingPool.h"
+#include "util/LatencyHistogram.h"
+#include "util/GaitGenerator.h"
+#include "util/ReplayScheduler.h"
+#include <thread>
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <random>
 
 using namespace std; 
 
+// Sink counting the events it receives (used by the gait event tests)
+struct CountingGaitSink : GaitEventSink {
+    int strikes = 0, missed = 0, phases = 0, order = 0;
+    int* order_counter;
+    explicit CountingGaitSink(int* counter) : order_counter(counter) {}
+    void on_foot_strike(const FootStrikeEvent& event) {
+        strikes += !event.missed;
+        missed += event.missed;
+        order = ++(*order_counter);
+    }
+    void on_gait_phase(const GaitPhaseEvent&) { phases++; }
+};
+
+// Whether two marker frames hold the same values (compared field by field: the padding after "frame" is undefined)
+bool SameMarkerFrame(const MarkerFrame& a, const MarkerFrame& b) {
+    return a.RHEEx == b.RHEEx && a.RHEEy == b.RHEEy && a.RHEEz == b.RHEEz && a.LHEEx == b.LHEEx && a.LHEEy == b.LHEEy &&
+           a.LHEEz == b.LHEEz && a.RTOEx == b.RTOEx && a.RTOEy == b.RTOEy && a.RTOEz == b.RTOEz && a.LTOEx == b.LTOEx &&
+           a.LTOEy == b.LTOEy && a.LTOEz == b.LTOEz && a.frame == b.frame && a.vicon_latency == b.vicon_latency;
+}
+
 // Define pi if not already defined
 #ifndef M_PI 
 #define M_PI 3.14159
 #endif
 
+// Parameters with a shorter velocity history and no frame offset, for the compile-time F-VESPA tests
+constexpr FVespaParams kShortHistoryFVespaParams = {500, 100, 0, 0, 2, 0};
+
 int main(int argc, char **argv) {
 
     // Declare a ButterworthFilter object with specific cutoff and sampling frequencies
@@ -39,6 +76,58 @@ int main(int argc, char **argv) {
     ASSERT_EQUAL_TOL(filter_dummy.filter(702.431274), 701.6724,0.001);
 
 
+    // The block version must give the same output as the sample-by-sample version, also when continued across blocks
+    std::vector<double> block_input = {690.129028, 697.071411, 702.212158, 705.408997, 706.516418, 705.519226, 702.431274};
+    std::vector<double> block_output;
+    ButterworthFilter filter_block(cutoffFrequency, samplingFrequency);
+    ButterworthFilter filter_sample(cutoffFrequency, samplingFrequency);
+    filter_block.filter(block_input.data(), block_input.data(), 3);   // in place, first part of the signal
+    ASSERT_EQUAL(block_input[0], filter_sample.filter(690.129028));
+    ASSERT_EQUAL(block_input[2], (filter_sample.filter(697.071411), filter_sample.filter(702.212158)));
+    filter_block.filter(std::vector<double>(block_input.begin() + 3, block_input.end()), block_output);
+    ASSERT_EQUAL(block_output.size(), 4u);
+    ASSERT_EQUAL_TOL(block_output[3], 701.6724, 0.001);
+    filter_sample.filter(705.408997); filter_sample.filter(706.516418); filter_sample.filter(705.519226);
+    ASSERT_EQUAL(block_output[3], filter_sample.filter(702.431274));
+
+    std::cout << std::endl;
+    std::cout << "===== Fixed Butterworth Filter tests =====" << std::endl;
+    // The coefficients of the compile-time filter are constants, normalized by a1
+    static_assert(FixedButterworthFilter<20, 100>::nb1 > 0 && FixedButterworthFilter<20, 100>::na2 < 0, "coefficients must be compile-time constants");
+    FixedButterworthFilter<20, 100> filter_fixed;
+    ASSERT_EQUAL_TOL(filter_fixed.filter(690.129028), 119.3206,0.001);
+    ASSERT_EQUAL_TOL(filter_fixed.filter(697.071411), 422.4152,0.001);
+    ASSERT_EQUAL_TOL(filter_fixed.filter(702.212158), 679.2459,0.001);
+    // Same output as the runtime-configured filter up to rounding, also for a long signal
+    ButterworthFilter filter_runtime(cutoffFrequency, samplingFrequency);
+    FixedButterworthFilter<20, 100> filter_fixed_long;
+    double fixed_max_diff = 0;
+    for (int n = 0; n < 10000; n++) {
+        double sample = 400 + 100 * sin(0.05 * n) + (n % 7);
+        fixed_max_diff = std::max(fixed_max_diff, std::fabs(filter_fixed_long.filter(sample) - filter_runtime.filter(sample)));
+    }
+    ASSERT_LESS_THAN(fixed_max_diff, 1e-9);
+
+    std::cout << std::endl;
+    std::cout << "===== Butterworth Filter Bank tests =====" << std::endl;
+    // Filter the 12 marker coordinates with a bank and with 12 separate filters: every channel must match
+    const int bank_channels = 12;
+    ButterworthFilterBank filter_bank(bank_channels, cutoffFrequency, samplingFrequency);
+    std::vector<ButterworthFilter> channel_filters(bank_channels, ButterworthFilter(cutoffFrequency, samplingFrequency));
+    ASSERT_EQUAL(filter_bank.channels(), bank_channels);
+    double bank_input[bank_channels], bank_output[bank_channels];
+    double bank_max_diff = 0;
+    for (int n = 0; n < 500; n++) {
+        for (int ch = 0; ch < bank_channels; ch++) {
+            bank_input[ch] = 100 * ch + 50 * sin(0.07 * n * (ch + 1)) + ((n * 7919 + ch * 104729) % 13) * 0.1;
+        }
+        filter_bank.filter(bank_input, bank_output);
+        for (int ch = 0; ch < bank_channels; ch++) {
+            bank_max_diff = std::max(bank_max_diff, std::fabs(bank_output[ch] - channel_filters[ch].filter(bank_input[ch])));
+        }
+    }
+    ASSERT_LESS_THAN(bank_max_diff, 1e-9);
+
 	// Declare a FootStrikeDetector object to detect foot-strike events
     FootStrikeDetector left_foot;
 
@@ -91,6 +180,996 @@ int main(int argc, char **argv) {
     ASSERT_GREATER_THAN(left_foot.gait_cycle_duration, 0); // actual value depends on computer speed, hence a specific value is not used
     ASSERT_GREATER_THAN(left_foot.time_stamp_hs, 0);  // actual value depends on computer speed, hence a specific value is not used
 
+    // With a deterministic time source the time stamps and durations have exact values
+    FootStrikeDetector frame_clock_foot(TimeSource::FRAME_CLOCK, samplingFrequency);
+    FootStrikeDetector external_clock_foot;
+    const int fs_frames[] = {1, 2, 4, 5, 6, 7, 8};
+    const double fs_vert[] = {81.9513, 289.3255, 509.3614, 495.4431, 477.9329, 471.8558, 472.6185};
+    const double fs_sag[] = {39.9065, 140.2264, 240.8251, 229.5268, 216.5277, 209.2244, 205.4473};
+    bool frame_clock_strike = false, external_clock_strike = false;
+    for (int i = 0; i < 7; i++) {
+        frame_clock_strike = frame_clock_foot.FVESPA(fs_frames[i], fs_vert[i], fs_sag[i]);
+        external_clock_strike = external_clock_foot.FVESPA(fs_frames[i], fs_vert[i], fs_sag[i], 10 + fs_frames[i] * 0.01);
+    }
+    ASSERT_EQUAL(frame_clock_strike, true);
+    ASSERT_EQUAL(frame_clock_foot.last_hs_frame, 7);
+    ASSERT_LESS_THAN(std::fabs(frame_clock_foot.time_stamp_hs - 0.08), 1e-12);  // frame 8 at 100 Hz
+    ASSERT_LESS_THAN(std::fabs(frame_clock_foot.gait_cycle_duration - 0.016), 1e-12);  // (0.08 - 0) / 5
+    ASSERT_EQUAL(external_clock_strike, true);
+    ASSERT_LESS_THAN(std::fabs(external_clock_foot.time_stamp_hs - 10.08), 1e-12);
+    ASSERT_LESS_THAN(std::fabs(external_clock_foot.gait_cycle_duration - 2.016), 1e-12);
+
+
+    std::cout << std::endl;
+    std::cout << "===== Gait Cycle Duration tests =====" << std::endl;
+    // Rolling window: O(1) sum of the last values, oldest value evicted first, initial zeros included in the mean
+    RollingWindow<double, 8> durations(3);
+    ASSERT_EQUAL(durations.Length(), 3u);
+    ASSERT_EQUAL(durations.Push(1.0), 0.0);
+    ASSERT_EQUAL(durations.Push(2.0), 0.0);
+    ASSERT_LESS_THAN(std::fabs(durations.Mean() - 1.0), 1e-12);  // (0 + 1 + 2) / 3
+    ASSERT_EQUAL(durations.Push(4.0), 0.0);
+    ASSERT_EQUAL(durations.Push(8.0), 1.0);
+    ASSERT_EQUAL(durations[0], 2.0);
+    ASSERT_EQUAL(durations[2], 8.0);
+    ASSERT_LESS_THAN(std::fabs(durations.Sum() - 14.0), 1e-12);
+    ASSERT_EQUAL(durations.Median(), 4.0);
+    RollingWindow<double, 8> even_durations(4);
+    even_durations.Push(3.0);
+    even_durations.Push(1.0);
+    ASSERT_EQUAL(even_durations.Median(), 0.5);                           // median of {0, 0, 3, 1}
+    RollingWindow<double, 8> long_durations(100);
+    ASSERT_EQUAL(long_durations.Length(), 8u);                            // the window length is limited to the capacity
+
+    // Estimators of the gait cycle duration, on a synthetic heel trajectory with alternating gait cycle durations
+    FootStrikeDetector mean5_foot(TimeSource::FRAME_CLOCK, samplingFrequency);
+    FootStrikeDetector mean3_foot(TimeSource::FRAME_CLOCK, samplingFrequency, 3);
+    FootStrikeDetector median5_foot(TimeSource::FRAME_CLOCK, samplingFrequency, 5, DurationEstimator::MEDIAN);
+    FootStrikeDetector ewma_foot(TimeSource::FRAME_CLOCK, samplingFrequency, 5, DurationEstimator::EWMA, 0.5);
+    std::vector<double> strike_times;
+    double gait_phase = 0;
+    for (int frame = 1; frame <= 1500; frame++) {
+        // Alternate between 1.0 s and 1.2 s gait cycles
+        gait_phase += 2 * M_PI / samplingFrequency / ((static_cast<int>(gait_phase / (2 * M_PI)) % 2 == 0) ? 1.0 : 1.2);
+        double vert = 300 + 100 * (1 - cos(gait_phase));
+        double sag = 200 * cos(gait_phase) - 5.0 * frame / samplingFrequency;
+        if (mean5_foot.FVESPA(frame, vert, sag)) {
+            strike_times.push_back(mean5_foot.time_stamp_hs);
+        }
+        mean3_foot.FVESPA(frame, vert, sag);
+        median5_foot.FVESPA(frame, vert, sag);
+        ewma_foot.FVESPA(frame, vert, sag);
+    }
+    size_t n_strikes = strike_times.size();
+    ASSERT_GREATER_THAN(n_strikes, 10u);
+    std::vector<double> cycle_durations = {strike_times[0]};   // first duration is measured from time zero
+    for (size_t i = 1; i < n_strikes; i++) {
+        cycle_durations.push_back(strike_times[i] - strike_times[i - 1]);
+    }
+    double expected_mean5 = 0, expected_mean3 = 0, expected_ewma = cycle_durations[1];
+    for (size_t i = n_strikes - 5; i < n_strikes; i++) expected_mean5 += cycle_durations[i];
+    for (size_t i = n_strikes - 3; i < n_strikes; i++) expected_mean3 += cycle_durations[i];
+    for (size_t i = 2; i < n_strikes; i++) expected_ewma = 0.5 * cycle_durations[i] + 0.5 * expected_ewma;
+    std::vector<double> last5(cycle_durations.end() - 5, cycle_durations.end());
+    std::sort(last5.begin(), last5.end());
+    ASSERT_LESS_THAN(std::fabs(mean5_foot.gait_cycle_duration - (expected_mean5 / 5)), 1e-9);
+    ASSERT_LESS_THAN(std::fabs(mean3_foot.gait_cycle_duration - (expected_mean3 / 3)), 1e-9);
+    ASSERT_LESS_THAN(std::fabs(median5_foot.gait_cycle_duration - last5[2]), 1e-9);
+    ASSERT_LESS_THAN(std::fabs(ewma_foot.gait_cycle_duration - expected_ewma), 1e-9);
+    ASSERT_EQUAL(mean3_foot.last_hs_frame, mean5_foot.last_hs_frame);    // the estimator does not change the detection
+
+    std::cout << std::endl;
+    std::cout << "===== Latency Compensation tests =====" << std::endl;
+    ASSERT_LESS_THAN(std::fabs(ButterworthGroupDelayFrames(20, 100) - 1.1254), 1e-4);
+    // Each predictor is exact on the signals of its model, "horizon" frames ahead
+    LatencyCompensator no_compensation;
+    LatencyCompensator linear(LatencyCompensation::LINEAR, 2);
+    LatencyCompensator quadratic(LatencyCompensation::QUADRATIC, 1.5);
+    LatencyCompensator alpha_beta(LatencyCompensation::ALPHA_BETA, 2);
+    double predicted_ramp = 0, predicted_parabola = 0, tracked_ramp = 0;
+    bool uncompensated_unchanged = true;
+    for (int n = 0; n < 200; n++) {
+        uncompensated_unchanged = uncompensated_unchanged && no_compensation.compensate(3.0 * n) == 3.0 * n;
+        predicted_ramp = linear.compensate(3.0 * n);
+        predicted_parabola = quadratic.compensate(0.5 * n * n);
+        tracked_ramp = alpha_beta.compensate(3.0 * n);
+    }
+    ASSERT_EQUAL(uncompensated_unchanged, true);
+    ASSERT_LESS_THAN(std::fabs(predicted_ramp - (3.0 * 201)), 1e-9);
+    ASSERT_LESS_THAN(std::fabs(predicted_parabola - (0.5 * 200.5 * 200.5)), 1e-9);
+    ASSERT_LESS_THAN(std::fabs(tracked_ramp - (3.0 * 201)), 1e-6);  // the tracker converges to the ramp
+
+    // Detectors with and without compensation on the same trajectory: same foot-strikes, detected earlier with compensation
+    FootStrikeDetector uncompensated_foot(TimeSource::FRAME_CLOCK, samplingFrequency);
+    FootStrikeDetector compensated_foot(TimeSource::FRAME_CLOCK, samplingFrequency);
+    compensated_foot.set_latency_compensation(LatencyCompensation::LINEAR, ButterworthGroupDelayFrames(cutoffFrequency, samplingFrequency));
+    ButterworthFilter latency_filter_vert(cutoffFrequency, samplingFrequency), latency_filter_sag(cutoffFrequency, samplingFrequency);
+    int uncompensated_strikes = 0, compensated_strikes = 0, frames_gained = 0;
+    int last_uncompensated_frame = 0, last_compensated_frame = 0;
+    for (int frame = 1; frame <= 1500; frame++) {
+        double t = frame / samplingFrequency;
+        double vert = latency_filter_vert.filter(300 + 100 * (1 - cos(2 * M_PI * t / 1.1)));
+        double sag = latency_filter_sag.filter(200 * cos(2 * M_PI * t / 1.1) - 5 * t);
+        if (uncompensated_foot.FVESPA(frame, vert, sag)) {
+            uncompensated_strikes++;
+            last_uncompensated_frame = frame;
+            frames_gained += last_uncompensated_frame - last_compensated_frame;
+        }
+        if (compensated_foot.FVESPA(frame, vert, sag)) {
+            compensated_strikes++;
+            last_compensated_frame = frame;
+        }
+    }
+    ASSERT_GREATER_THAN(uncompensated_strikes, 10);
+    ASSERT_EQUAL(compensated_strikes, uncompensated_strikes);
+    ASSERT_EQUAL(frames_gained, uncompensated_strikes);                   // every foot-strike is detected one frame earlier
+
+    std::cout << std::endl;
+    std::cout << "===== Heel Kalman Tracker tests =====" << std::endl;
+    // On a constant acceleration trajectory the estimate converges to the exact position, velocity and acceleration
+    HeelKalmanTracker parabola_tracker;
+    HeelEstimate parabola_estimate = parabola_tracker.update(100);
+    ASSERT_EQUAL(parabola_estimate.position, 100.0);                     // starts at the first sample, at rest
+    ASSERT_EQUAL(parabola_estimate.velocity, 0.0);
+    for (int n = 1; n <= 300; n++) {
+        parabola_estimate = parabola_tracker.update(100 + 2.0 * n + 0.25 * n * n);
+    }
+    ASSERT_LESS_THAN(std::fabs(parabola_estimate.position - (100 + 2.0 * 300 + 0.25 * 300 * 300)), 1e-6);
+    ASSERT_LESS_THAN(std::fabs(parabola_estimate.velocity - (2.0 + 0.5 * 300)), 1e-6);     // derivative per frame
+    ASSERT_LESS_THAN(std::fabs(parabola_estimate.acceleration - 0.5), 1e-6);
+    // White measurement noise is attenuated in the position, and far more in the velocity than by first differences
+    HeelKalmanTracker noise_tracker;
+    std::mt19937 noise_generator(3);
+    std::normal_distribution<double> unit_noise(0, 1);
+    double noisy_position_var = 0, noisy_velocity_var = 0, difference_var = 0, previous_sample = 400;
+    for (int n = 0; n < 2000; n++) {
+        double sample = 400 + unit_noise(noise_generator);
+        HeelEstimate estimate = noise_tracker.update(sample);
+        if (n >= 200) {
+            noisy_position_var += (estimate.position - 400) * (estimate.position - 400) / 1800;
+            noisy_velocity_var += estimate.velocity * estimate.velocity / 1800;
+            difference_var += (sample - previous_sample) * (sample - previous_sample) / 1800;
+        }
+        previous_sample = sample;
+    }
+    ASSERT_LESS_THAN(noisy_position_var, 0.9);
+    ASSERT_LESS_THAN(noisy_velocity_var, difference_var / 2);
+
+    // Drop-in front end of the FootStrikeDetector: the same foot-strikes as the Butterworth filter, detected earlier
+    // (the first gait cycle is skipped: the start-up transient of the Butterworth filter looks like a swing phase)
+    FootStrikeDetector kalman_foot(TimeSource::FRAME_CLOCK, samplingFrequency), butterworth_foot(TimeSource::FRAME_CLOCK, samplingFrequency);
+    HeelKalmanTracker kalman_vert, kalman_sag;
+    ButterworthFilter kalman_ref_vert(cutoffFrequency, samplingFrequency), kalman_ref_sag(cutoffFrequency, samplingFrequency);
+    std::normal_distribution<double> marker_noise(0, 0.05);
+    int kalman_strikes = 0, butterworth_strikes = 0, kalman_frames_gained = 0, last_kalman_frame = 0;
+    for (int frame = 1; frame <= 1500; frame++) {
+        double t = frame / samplingFrequency;
+        double raw_vert = 300 + 100 * (1 - cos(2 * M_PI * t / 1.1)) + marker_noise(noise_generator);
+        double raw_sag = 200 * cos(2 * M_PI * t / 1.1 + 0.15) - 5 * t + marker_noise(noise_generator);   // heel already moving back at the strike
+        bool kalman_strike = kalman_foot.FVESPA(frame, kalman_vert.update(raw_vert), kalman_sag.update(raw_sag), t);
+        if (kalman_strike && frame > 165) {
+            kalman_strikes++;
+            last_kalman_frame = frame;
+        }
+        if (butterworth_foot.FVESPA(frame, kalman_ref_vert.filter(raw_vert), kalman_ref_sag.filter(raw_sag)) && frame > 165) {
+            butterworth_strikes++;
+            kalman_frames_gained += frame - last_kalman_frame;
+        }
+    }
+    ASSERT_GREATER_THAN(butterworth_strikes, 10);
+    ASSERT_EQUAL(kalman_strikes, butterworth_strikes);
+    ASSERT_GREATER_THAN(kalman_frames_gained, 0);
+    ASSERT_LESS_THAN(std::fabs(kalman_foot.gait_cycle_duration - 1.1), 0.011);
+
+    std::cout << std::endl;
+    std::cout << "===== Offline Gait Analysis tests =====" << std::endl;
+    // Zero-phase filtering: a constant is kept exactly thanks to the edge padding, and a slow sine is not delayed
+    ButterworthFilter zero_phase_filter(cutoffFrequency, samplingFrequency);
+    std::vector<double> constant_signal(50, 423.5), constant_filtered;
+    zero_phase_filter.filtfilt(constant_signal, constant_filtered);
+    double constant_max_diff = 0;
+    for (double sample : constant_filtered) constant_max_diff = std::max(constant_max_diff, std::fabs(sample - 423.5));
+    ASSERT_LESS_THAN(constant_max_diff, 1e-9);
+    std::vector<double> sine_signal(1000), sine_zero_phase, sine_causal;
+    for (size_t n = 0; n < sine_signal.size(); n++) sine_signal[n] = 300 + 100 * sin(2 * M_PI * 2.0 * n / samplingFrequency);
+    zero_phase_filter.filtfilt(sine_signal, sine_zero_phase);
+    ButterworthFilter causal_filter(cutoffFrequency, samplingFrequency);
+    causal_filter.filter(sine_signal, sine_causal);
+    double zero_phase_max_diff = 0, causal_max_diff = 0;
+    for (size_t n = 100; n < 900; n++) {
+        zero_phase_max_diff = std::max(zero_phase_max_diff, std::fabs(sine_zero_phase[n] - sine_signal[n]));
+        causal_max_diff = std::max(causal_max_diff, std::fabs(sine_causal[n] - sine_signal[n]));
+    }
+    ASSERT_LESS_THAN(zero_phase_max_diff, 0.1);
+    ASSERT_GREATER_THAN(causal_max_diff, 10 * zero_phase_max_diff);      // the causal filter lags behind
+    ASSERT_EQUAL(sine_signal[500], 300 + 100 * sin(2 * M_PI * 2.0 * 500 / samplingFrequency));   // the input is not changed
+
+    // Parallel filtering of several channels gives the same output as filtering them one by one
+    const int offline_channels = 5;
+    std::vector<std::vector<double>> channel_signals(offline_channels, std::vector<double>(777)), channel_outputs = channel_signals;
+    const double* channel_inputs[offline_channels];
+    double* channel_output_ptrs[offline_channels];
+    for (int ch = 0; ch < offline_channels; ch++) {
+        for (size_t n = 0; n < 777; n++) channel_signals[ch][n] = 100 * ch + 30 * sin(0.03 * n * (ch + 1)) + ((n * 7919 + ch) % 13) * 0.1;
+        channel_inputs[ch] = channel_signals[ch].data();
+        channel_output_ptrs[ch] = channel_outputs[ch].data();
+    }
+    FiltFiltChannels(cutoffFrequency, samplingFrequency, channel_inputs, channel_output_ptrs, offline_channels, 777, 3);
+    bool channels_match = true;
+    for (int ch = 0; ch < offline_channels; ch++) {
+        std::vector<double> expected;
+        zero_phase_filter.filtfilt(channel_signals[ch], expected);
+        channels_match = channels_match && expected == channel_outputs[ch];
+    }
+    ASSERT_EQUAL(channels_match, true);
+
+    // Offline F-VESPA finds the foot-strikes at the minima of the heel trajectory, without the lag of the causal filter
+    std::vector<int> offline_frames(1500);
+    std::vector<double> offline_vert(1500), offline_sag(1500);
+    for (int i = 0; i < 1500; i++) {
+        double t = (i + 1) / samplingFrequency;
+        offline_frames[i] = i + 1;
+        offline_vert[i] = 300 + 100 * (1 - cos(2 * M_PI * t / 1.1));
+        offline_sag[i] = 200 * cos(2 * M_PI * t / 1.1 + 0.15) - 5 * t;
+    }
+    std::vector<int> offline_strikes = OfflineFVESPA(offline_frames.data(), offline_vert.data(), offline_sag.data(), 1500);
+    ASSERT_GREATER_THAN(offline_strikes.size(), 10u);
+    int worst_strike_error = 0;
+    for (int strike : offline_strikes) {
+        int nearest_minimum = static_cast<int>(std::round(strike / 110.0)) * 110;
+        worst_strike_error = std::max(worst_strike_error, std::abs(strike - nearest_minimum));
+    }
+    ASSERT_LESS_THAN(worst_strike_error, 2);
+    std::vector<int> offline_fs_column = LastFootStrikeColumn(offline_frames.data(), 1500, offline_strikes, 1);
+    ASSERT_EQUAL(offline_fs_column[offline_strikes[0] - 1], 1);         // the column changes one frame after the foot-strike
+    ASSERT_EQUAL(offline_fs_column[offline_strikes[0]], offline_strikes[0]);
+    ASSERT_EQUAL(offline_fs_column[1499], offline_strikes.back());
+
+    std::cout << std::endl;
+    std::cout << "===== Parameter Sweep tests =====" << std::endl;
+    // The default thresholds give the same foot-strikes as a detector without parameters
+    FootStrikeDetector default_detector(TimeSource::FRAME_CLOCK), params_detector(TimeSource::FRAME_CLOCK);
+    params_detector.set_params(FVespaParams());
+    ASSERT_EQUAL(params_detector.params().max_heel_height, 500.0);
+    ASSERT_EQUAL(params_detector.params().min_swing_rise, 100.0);
+    bool params_match = true;
+    int params_strikes = 0;
+    for (int i = 0; i < 1500; i++) {
+        bool expected = default_detector.FVESPA(offline_frames[i], offline_vert[i], offline_sag[i]);
+        bool detected = params_detector.FVESPA(offline_frames[i], offline_vert[i], offline_sag[i]);
+        params_match = params_match && expected == detected && default_detector.last_hs_frame == params_detector.last_hs_frame;
+        params_strikes += detected;
+    }
+    ASSERT_EQUAL(params_match, true);
+    ASSERT_GREATER_THAN(params_strikes, 10);
+    // A height gate below the heel minima (300 mm) suppresses every foot-strike; a swing rise above the heel amplitude
+    // (200 mm) only lets the first one through, whose swing is measured from the initial unrealistic minimum
+    FVespaParams low_gate, high_rise;
+    low_gate.max_heel_height = 250;
+    high_rise.min_swing_rise = 250;
+    FootStrikeDetector low_gate_detector(TimeSource::FRAME_CLOCK), high_rise_detector(TimeSource::FRAME_CLOCK);
+    low_gate_detector.set_params(low_gate);
+    high_rise_detector.set_params(high_rise);
+    int low_gate_strikes = 0, high_rise_strikes = 0;
+    for (int i = 0; i < 1500; i++) {
+        low_gate_strikes += low_gate_detector.FVESPA(offline_frames[i], offline_vert[i], offline_sag[i]);
+        high_rise_strikes += high_rise_detector.FVESPA(offline_frames[i], offline_vert[i], offline_sag[i]);
+    }
+    ASSERT_EQUAL(low_gate_strikes, 0);
+    ASSERT_EQUAL(high_rise_strikes, 1);
+
+    // The work-stealing pool runs every index exactly once, also when the iterations have very different costs
+    WorkStealingPool pool(4);
+    ASSERT_EQUAL(pool.Threads(), 4);
+    const size_t pool_count = 1000;
+    std::vector<std::atomic<int>> pool_visits(pool_count);
+    for (std::atomic<int>& visits : pool_visits) visits.store(0);
+    std::atomic<int> pool_bad_worker(0);
+    auto pool_task = [&](size_t index, int worker) {
+        if (worker < 0 || worker >= 4) pool_bad_worker++;
+        if (index < pool_count / 4) std::this_thread::sleep_for(std::chrono::microseconds(50));   // the first range is slow
+        pool_visits[index]++;
+    };
+    pool.Run(pool_count, pool_task);
+    pool.Run(pool_count, pool_task);                    // the threads are reused by the next loop
+    bool pool_exactly_twice = true;
+    for (std::atomic<int>& visits : pool_visits) pool_exactly_twice = pool_exactly_twice && visits.load() == 2;
+    ASSERT_EQUAL(pool_exactly_twice, true);
+    ASSERT_EQUAL(pool_bad_worker.load(), 0);
+    ASSERT_GREATER_THAN(pool.Steals(), 0ull);           // the fast workers took over part of the slow range
+
+    std::cout << std::endl;
+    std::cout << "===== F-VESPA Parameters tests =====" << std::endl;
+    // The run-time and the compile-time parameters give identical results on a noisy gait, for every parameter set
+    std::mt19937 params_rng(20);
+    std::normal_distribution<double> params_noise(0.0, 0.3);
+    std::vector<double> params_vert(3000), params_sag(3000);
+    for (int i = 0; i < 3000; i++) {
+        double t = (i + 1) / samplingFrequency;
+        params_vert[i] = 300 + 100 * (1 - cos(2 * M_PI * t / 1.05)) + params_noise(params_rng);
+        params_sag[i] = 200 * cos(2 * M_PI * t / 1.05 + 0.15) + params_noise(params_rng);
+    }
+    ButterworthFilter params_filter_vert(cutoffFrequency, samplingFrequency), params_filter_sag(cutoffFrequency, samplingFrequency);
+    params_filter_vert.filter(params_vert, params_vert);
+    params_filter_sag.filter(params_sag, params_sag);
+    FootStrikeDetector runtime_healthy(kHealthyFVespaParams, TimeSource::FRAME_CLOCK), static_healthy(TimeSource::FRAME_CLOCK);
+    FootStrikeDetector runtime_prosthesis(kProsthesisFVespaParams, TimeSource::FRAME_CLOCK), static_prosthesis(TimeSource::FRAME_CLOCK);
+    FootStrikeDetector runtime_short(kShortHistoryFVespaParams, TimeSource::FRAME_CLOCK), static_short(TimeSource::FRAME_CLOCK);
+    FootStrikeDetector original_detector(TimeSource::FRAME_CLOCK);
+    bool healthy_identical = true, prosthesis_identical = true, short_identical = true, original_identical = true;
+    int healthy_strikes = 0, prosthesis_strikes = 0, short_strikes = 0;
+    for (int i = 0; i < 3000; i++) {
+        bool runtime_hs = runtime_healthy.FVESPA(i + 1, params_vert[i], params_sag[i]);
+        bool static_hs = static_healthy.FVESPA<kHealthyFVespaParams>(i + 1, params_vert[i], params_sag[i]);
+        bool original_hs = original_detector.FVESPA(i + 1, params_vert[i], params_sag[i]);
+        healthy_identical = healthy_identical && runtime_hs == static_hs && runtime_healthy.last_hs_frame == static_healthy.last_hs_frame &&
+                            runtime_healthy.gait_cycle_duration == static_healthy.gait_cycle_duration;
+        original_identical = original_identical && original_hs == runtime_hs && original_detector.last_hs_frame == runtime_healthy.last_hs_frame;
+        healthy_strikes += runtime_hs;
+        runtime_hs = runtime_prosthesis.FVESPA(i + 1, params_vert[i], params_sag[i], i * 0.01);
+        static_hs = static_prosthesis.FVESPA<kProsthesisFVespaParams>(i + 1, params_vert[i], params_sag[i], i * 0.01);
+        prosthesis_identical = prosthesis_identical && runtime_hs == static_hs && runtime_prosthesis.last_hs_frame == static_prosthesis.last_hs_frame &&
+                               runtime_prosthesis.gait_cycle == static_prosthesis.gait_cycle;
+        prosthesis_strikes += runtime_hs;
+        runtime_hs = runtime_short.FVESPA(i + 1, params_vert[i], params_sag[i]);
+        static_hs = static_short.FVESPA<kShortHistoryFVespaParams>(i + 1, params_vert[i], params_sag[i]);
+        short_identical = short_identical && runtime_hs == static_hs && runtime_short.last_hs_frame == static_short.last_hs_frame;
+        short_strikes += runtime_hs;
+    }
+    ASSERT_EQUAL(healthy_identical, true);
+    ASSERT_EQUAL(original_identical, true);
+    ASSERT_EQUAL(prosthesis_identical, true);
+    ASSERT_EQUAL(short_identical, true);
+    ASSERT_GREATER_THAN(healthy_strikes, 20);
+    ASSERT_GREATER_THAN(prosthesis_strikes, 20);
+    ASSERT_GREATER_THAN(short_strikes, 20);
+    ASSERT_EQUAL(runtime_short.last_hs_frame, runtime_healthy.last_hs_frame + 1);   // no frame offset
+    // The prosthesis variant keeps the strict sagittal test of the original code (vel_s < 6.01): a heel landing with a
+    // sagittal velocity of exactly 6.01 mm/frame is only detected at the next frame, unlike with vel_s <= 6.01
+    FVespaParams relaxed_prosthesis_params = kProsthesisFVespaParams;
+    relaxed_prosthesis_params.strike_vel_sag_strict = false;
+    FootStrikeDetector strict_prosthesis(kProsthesisFVespaParams, TimeSource::FRAME_CLOCK);
+    FootStrikeDetector relaxed_prosthesis(relaxed_prosthesis_params, TimeSource::FRAME_CLOCK);
+    const double landing_vert[] = {300, 300, 300, 420, 540, 520, 480, 440, 400, 400, 400};
+    const double landing_sag[] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 6.01, 6.01};
+    for (int i = 0; i < 11; i++) {
+        strict_prosthesis.FVESPA(i + 1, landing_vert[i], landing_sag[i]);
+        relaxed_prosthesis.FVESPA(i + 1, landing_vert[i], landing_sag[i]);
+    }
+    ASSERT_EQUAL(relaxed_prosthesis.last_hs_frame, 9);
+    ASSERT_EQUAL(strict_prosthesis.last_hs_frame, 10);
+    ASSERT_EQUAL(kHealthyFVespaParams.strike_vel_sag_strict, false);
+    // An invalid velocity history is rejected and the previous parameters are kept
+    FVespaParams invalid_params;
+    invalid_params.velocity_history = kMaxVelocityHistory + 1;
+    ASSERT_EQUAL(runtime_short.set_params(invalid_params), false);
+    ASSERT_EQUAL(runtime_short.params().velocity_history, 2);
+    ASSERT_EQUAL(runtime_short.set_params(kHealthyFVespaParams), true);
+    ASSERT_EQUAL(runtime_short.params().strike_frame_offset, -1);
+
+    std::cout << std::endl;
+    std::cout << "===== Foot-strike Detector Bank tests =====" << std::endl;
+    // Every foot of the bank must give exactly the same results as its own FootStrikeDetector. The heel trajectories are
+    // synthetic gait cycles of different durations and phases; 11 feet exercise both the vectorized loop and its tail.
+    const int bank_feet = 11;
+    const int bank_frames = 3000;
+    FootStrikeDetectorBank foot_bank(bank_feet);
+    std::vector<FootStrikeDetector> single_feet(bank_feet);
+    std::vector<double> bank_vert(bank_feet), bank_sag(bank_feet);
+    std::vector<unsigned char> bank_strike(bank_feet);
+    int bank_mismatches = 0, bank_strikes = 0;
+    for (int frame = 1; frame <= bank_frames; frame++) {
+        double t = frame / samplingFrequency;
+        for (int foot = 0; foot < bank_feet; foot++) {
+            double cycle = 0.9 + 0.04 * foot;                   // [s] gait cycle duration of this foot
+            double phase = 2 * M_PI * t / cycle + foot;
+            bank_vert[foot] = 300 + 100 * (1 - cos(phase)) + 2 * sin(7.3 * t + foot);
+            bank_sag[foot] = 200 * cos(phase) - 5 * t;
+        }
+        int strikes = foot_bank.FVESPA(frame, bank_vert.data(), bank_sag.data(), t, bank_strike.data());
+        int single_strikes = 0;
+        for (int foot = 0; foot < bank_feet; foot++) {
+            bool strike = single_feet[foot].FVESPA(frame, bank_vert[foot], bank_sag[foot], t);
+            single_strikes += strike;
+            if (strike != (bank_strike[foot] == 1) ||
+                single_feet[foot].last_hs_frame != foot_bank.last_hs_frame(foot) ||
+                single_feet[foot].gait_cycle != foot_bank.gait_cycle(foot) ||
+                single_feet[foot].gait_cycle_duration != foot_bank.gait_cycle_duration(foot) ||
+                single_feet[foot].time_stamp_hs != foot_bank.time_stamp_hs(foot)) {
+                bank_mismatches++;
+            }
+        }
+        bank_mismatches += (strikes != single_strikes);
+        bank_strikes += strikes;
+    }
+    ASSERT_EQUAL(bank_mismatches, 0);
+    ASSERT_GREATER_THAN(bank_strikes, bank_feet * 20);   // about 30 gait cycles per foot
+    ASSERT_EQUAL(foot_bank.feet(), bank_feet);
+
+    std::cout << std::endl;
+    std::cout << "===== Bilateral Gait Monitor tests =====" << std::endl;
+    // Both feet walk with gait cycles of 1.1 s, half a cycle apart. The right heel marker is smoothly raised above 500 mm
+    // around one of its foot-strikes, so that F-VESPA misses it and the fail-safe mechanism has to insert it.
+    BilateralGaitMonitor gait_monitor(cutoffFrequency, samplingFrequency);
+    ButterworthFilter left_vert_filter(cutoffFrequency, samplingFrequency), left_sag_filter(cutoffFrequency, samplingFrequency);
+    FootStrikeDetector reference_left_foot;
+    gait_monitor.start(0);
+    int left_strikes = 0, right_strikes = 0, left_missed = 0, right_missed = 0, left_mismatches = 0;
+    int missed_right_frame = 0, last_right_frame = 0;
+    bool ordered_phase = true;
+    MarkerFrame gait_frame = {};
+    for (int frame = 1; frame <= 2000; frame++) {
+        double t = frame / samplingFrequency;
+        double left_phase = 2 * M_PI * t / 1.1, right_phase = left_phase + M_PI;
+        gait_frame.frame = frame;
+        gait_frame.LHEEz = 300 + 100 * (1 - cos(left_phase));
+        gait_frame.LHEEy = 200 * cos(left_phase) - 5 * t;
+        gait_frame.RHEEz = 300 + 100 * (1 - cos(right_phase)) + ((frame > 950 && frame < 1170) ? 125 * (1 - cos(2 * M_PI * (frame - 950) / 220.0)) : 0);
+        gait_frame.RHEEy = 200 * cos(right_phase) - 5 * t;
+        BilateralGaitEvents events = gait_monitor.process(gait_frame, t);
+
+        // The left foot gives the same foot-strikes as a stand-alone filter and detector
+        bool reference_strike = reference_left_foot.FVESPA(frame, left_vert_filter.filter(gait_frame.LHEEz), left_sag_filter.filter(gait_frame.LHEEy), t);
+        left_mismatches += (reference_strike != events.left_strike);
+        left_strikes += events.left_strike;
+        right_strikes += events.right_strike;
+        left_missed += events.left_missed;
+        right_missed += events.right_missed;
+        if (events.right_strike) {
+            last_right_frame = gait_monitor.right().last_hs_frame;
+        }
+        if (events.right_missed) {
+            missed_right_frame = gait_monitor.right().last_hs_frame;
+            ordered_phase = ordered_phase && missed_right_frame > last_right_frame && gait_monitor.right().gait_cycle_pct > 0;
+        }
+        ordered_phase = ordered_phase && gait_monitor.left().gait_cycle_pct >= 0;
+    }
+    ASSERT_EQUAL(left_mismatches, 0);
+    ASSERT_EQUAL(gait_monitor.left().last_hs_frame, reference_left_foot.last_hs_frame);
+    ASSERT_EQUAL(gait_monitor.left().gait_cycle, reference_left_foot.gait_cycle);
+    ASSERT_EQUAL(gait_monitor.left().gait_cycle_duration, reference_left_foot.gait_cycle_duration);
+    ASSERT_GREATER_THAN(left_strikes, 15);
+    ASSERT_EQUAL(left_missed, 0);
+    ASSERT_EQUAL(right_missed, 1);
+    ASSERT_EQUAL(right_strikes + right_missed, left_strikes - 1);          // one right foot-strike between two left foot-strikes
+    ASSERT_EQUAL(gait_monitor.right().gait_cycle, right_strikes + right_missed + 1);
+    ASSERT_EQUAL(ordered_phase, true);
+    std::cout << "Missed right foot-strike inserted at frame " << missed_right_frame << std::endl;
+
+    std::cout << std::endl;
+    std::cout << "===== Gait Event tests =====" << std::endl;
+    // The same walk, with the events delivered to several sinks: two counting sinks, a callback and the shared memory
+    BilateralGaitMonitor sink_monitor(cutoffFrequency, samplingFrequency);
+    static SharedMemStruct event_mem;
+    int order_counter = 0, callback_strikes = 0;
+    double last_callback_pct = -1;
+    CountingGaitSink first_sink(&order_counter), second_sink(&order_counter);
+    SharedMemGaitSink shared_mem_sink(&event_mem);
+    auto count_strike = [&callback_strikes](const FootStrikeEvent&) { callback_strikes++; };
+    auto record_phase = [&last_callback_pct](const GaitPhaseEvent& event) { if (event.foot == Foot::RIGHT) last_callback_pct = event.gait_cycle_pct; };
+    CallbackSink callback_sink;
+    callback_sink.foot_strike = count_strike;
+    callback_sink.gait_phase = record_phase;
+    auto fan_out = MakeGaitEventFanOut(first_sink, second_sink, callback_sink, shared_mem_sink);
+    sink_monitor.start(0);
+    for (int frame = 1; frame <= 2000; frame++) {
+        double t = frame / samplingFrequency;
+        double left_phase = 2 * M_PI * t / 1.1, right_phase = left_phase + M_PI;
+        gait_frame.frame = frame;
+        gait_frame.LHEEz = 300 + 100 * (1 - cos(left_phase));
+        gait_frame.LHEEy = 200 * cos(left_phase) - 5 * t;
+        gait_frame.RHEEz = 300 + 100 * (1 - cos(right_phase)) + ((frame > 950 && frame < 1170) ? 125 * (1 - cos(2 * M_PI * (frame - 950) / 220.0)) : 0);
+        gait_frame.RHEEy = 200 * cos(right_phase) - 5 * t;
+        sink_monitor.process(gait_frame, t, fan_out);
+    }
+    ASSERT_EQUAL(first_sink.strikes, left_strikes + right_strikes);
+    ASSERT_EQUAL(first_sink.missed, 1);
+    ASSERT_EQUAL(first_sink.phases, 2 * 2000);                              // both feet, every frame
+    ASSERT_EQUAL(second_sink.strikes, first_sink.strikes);
+    ASSERT_EQUAL(second_sink.order, first_sink.order + 1);                  // the sinks are called in order
+    ASSERT_EQUAL(callback_strikes, first_sink.strikes + first_sink.missed);
+    ASSERT_EQUAL(last_callback_pct, sink_monitor.right().gait_cycle_pct);
+    ASSERT_EQUAL(event_mem.left_last_hs_frame, sink_monitor.left().last_hs_frame);
+    ASSERT_EQUAL(event_mem.right_gc, sink_monitor.right().gait_cycle);
+    ASSERT_EQUAL(event_mem.right_time_stamp_hs, sink_monitor.right().time_stamp_hs);
+    ASSERT_EQUAL(event_mem.left_gc_pct, sink_monitor.left().gait_cycle_pct);
+
+    // Copying a callback refers to the same callable, not to the original callback
+    EventCallback<FootStrikeEvent> copied_callback(callback_sink.foot_strike);
+    callback_sink.foot_strike = EventCallback<FootStrikeEvent>();
+    callback_strikes = 0;
+    copied_callback(FootStrikeEvent());
+    ASSERT_EQUAL(callback_strikes, 1);
+
+    // Events of a stand-alone FootStrikeDetector
+    FootStrikeEvent detector_event = MakeFootStrikeEvent(reference_left_foot, Foot::LEFT, 2000);
+    shared_mem_sink.on_foot_strike(detector_event);
+    ASSERT_EQUAL(event_mem.left_gc, reference_left_foot.gait_cycle);
+    ASSERT_EQUAL(event_mem.left_gc_dur, reference_left_foot.gait_cycle_duration);
+
+    std::cout << std::endl;
+    std::cout << "===== Shared Memory tests =====" << std::endl;
+    // A writer thread publishes frames in which every marker coordinate equals the frame number,
+    // so a torn read shows up as a snapshot whose coordinates do not match its frame number
+    MemManager writer_mem(L"GaitMonitor_unit_tests_SharedMemory");
+    ASSERT_EQUAL(writer_mem.Create(), true);
+    MemManager reader_mem(L"GaitMonitor_unit_tests_SharedMemory");
+    ASSERT_EQUAL(reader_mem.Connect(), true);
+    // A second Create takes over the existing object (e.g. one left behind by a process that crashed) and
+    // reinitializes it; the processes connected to it keep the same object
+    writer_mem.data->left_gc = 12345;
+    {
+        MemManager second_writer_mem(L"GaitMonitor_unit_tests_SharedMemory");
+        ASSERT_EQUAL(second_writer_mem.Create(), true);
+        ASSERT_EQUAL(reader_mem.data->left_gc, 0);
+        second_writer_mem.data->left_gc = 678;
+        ASSERT_EQUAL(reader_mem.data->left_gc, 678);
+        second_writer_mem.data->left_gc = 0;
+    }
+
+    const int seqlock_frames = 200000;
+    std::thread writer([&writer_mem, seqlock_frames]() {
+        MarkerFrame frame;
+        for (int i = 1; i <= seqlock_frames; i++) {
+            frame.RHEEx = frame.RHEEy = frame.RHEEz = i;
+            frame.LHEEx = frame.LHEEy = frame.LHEEz = i;
+            frame.RTOEx = frame.RTOEy = frame.RTOEz = i;
+            frame.LTOEx = frame.LTOEy = frame.LTOEz = i;
+            frame.frame = i;
+            writer_mem.WriteMarkers(frame);
+        }
+    });
+
+    MarkerFrame snapshot;
+    int torn_reads = 0;
+    do {
+        reader_mem.ReadMarkers(snapshot);
+        if (snapshot.RHEEx != snapshot.frame || snapshot.LHEEz != snapshot.frame || snapshot.LTOEz != snapshot.frame) {
+            torn_reads++;
+        }
+    } while (snapshot.frame != seqlock_frames);
+    writer.join();
+
+    ASSERT_EQUAL(torn_reads, 0);
+    ASSERT_EQUAL(reader_mem.ReadMarkers(snapshot), 2u * seqlock_frames); // sequence number advances by 2 per frame
+
+    // The marker ring keeps the oldest kMarkerRingCapacity frames that were not consumed and counts the rest as overruns
+    ASSERT_EQUAL(reader_mem.MarkerOverruns(), (unsigned long long)(seqlock_frames - kMarkerRingCapacity));
+    ASSERT_EQUAL(reader_mem.PopMarkers(snapshot), true);
+    ASSERT_EQUAL(snapshot.frame, 1);
+    MarkerFrame backlog[kMarkerRingCapacity];
+    ASSERT_EQUAL(reader_mem.PopMarkers(backlog, kMarkerRingCapacity), kMarkerRingCapacity - 1);
+    ASSERT_EQUAL(backlog[0].frame, 2);
+    ASSERT_EQUAL(backlog[kMarkerRingCapacity - 2].frame, (int)kMarkerRingCapacity);
+    ASSERT_EQUAL(reader_mem.PopMarkers(snapshot), false);   // ring drained
+
+    // Once there is space again, every new frame is delivered in order, with the latency reported by Vicon
+    for (int i = 1; i <= 3; i++) {
+        snapshot.frame = seqlock_frames + i;
+        snapshot.vicon_latency = i * 0.004;
+        writer_mem.WriteMarkers(snapshot);
+    }
+    ASSERT_EQUAL(reader_mem.PopMarkers(backlog, kMarkerRingCapacity), 3u);
+    ASSERT_EQUAL(backlog[2].frame, seqlock_frames + 3);
+    ASSERT_EQUAL(backlog[2].vicon_latency, 3 * 0.004);
+
+    // Consumers block until a frame is published instead of spinning
+    unsigned int notify_seen = reader_mem.MarkerNotifyCount();
+    auto timeout_start = std::chrono::steady_clock::now();
+    ASSERT_EQUAL(reader_mem.WaitForMarkers(notify_seen, 5), false);   // nothing published: times out
+    double timeout_waited_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - timeout_start).count();
+    ASSERT_GREATER_THAN(timeout_waited_ms, 5.0 - 1e-9);                 // not before the timeout
+    std::thread late_writer([&writer_mem, &snapshot]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        writer_mem.WriteMarkers(snapshot);
+    });
+    ASSERT_EQUAL(reader_mem.WaitForMarkers(notify_seen, 1000), true);
+    late_writer.join();
+    ASSERT_EQUAL(notify_seen, reader_mem.MarkerNotifyCount());
+    ASSERT_EQUAL(reader_mem.GetWakeupStats().blocked_wakeups, 1ull);
+    ASSERT_EQUAL(reader_mem.GetWakeupStats().timeouts, 1ull);
+    std::cout << "Marker wakeups: " << reader_mem.GetWakeupStats() << std::endl;
+
+    std::cout << std::endl;
+    std::cout << "===== Heel-strike Log tests =====" << std::endl;
+    // Every subscribed consumer receives every foot-strike published after it subscribed, in order
+    int early_consumer = reader_mem.SubscribeHeelStrikes();
+    ASSERT_EQUAL(early_consumer, 0);
+    HeelStrikeRecord hs_record = {0, 0, 0, 0, 0, 1};
+    ASSERT_EQUAL(reader_mem.PollHeelStrike(early_consumer, hs_record), false);
+    for (int i = 1; i <= 3; i++) {
+        hs_record.frame = i;
+        writer_mem.PublishHeelStrike(hs_record);
+    }
+    int late_consumer = reader_mem.SubscribeHeelStrikes();
+    ASSERT_EQUAL(late_consumer, 1);
+    hs_record.frame = 4;
+    hs_record.foot = 1;
+    writer_mem.PublishHeelStrike(hs_record);
+    int early_frames = 0, late_frames = 0;
+    while (reader_mem.PollHeelStrike(early_consumer, hs_record)) {
+        early_frames = early_frames * 10 + hs_record.frame;
+    }
+    while (reader_mem.PollHeelStrike(late_consumer, hs_record)) {
+        late_frames = late_frames * 10 + hs_record.frame;
+    }
+    ASSERT_EQUAL(early_frames, 1234);
+    ASSERT_EQUAL(late_frames, 4);
+    ASSERT_EQUAL(hs_record.foot, 1);
+
+    // A consumer that falls more than kHeelStrikeLogCapacity foot-strikes behind skips to the oldest one still in the log
+    for (int i = 5; i < 5 + (int)kHeelStrikeLogCapacity + 10; i++) {
+        hs_record.frame = i;
+        writer_mem.PublishHeelStrike(hs_record);
+    }
+    ASSERT_EQUAL(reader_mem.PollHeelStrike(early_consumer, hs_record), true);
+    ASSERT_EQUAL(hs_record.frame, 15);
+    ASSERT_EQUAL(reader_mem.HeelStrikesLost(early_consumer), 10ull);
+    reader_mem.UnsubscribeHeelStrikes(early_consumer);
+    reader_mem.UnsubscribeHeelStrikes(late_consumer);
+
+    // All cursors can be taken, and released cursors are reused
+    int consumers[kMaxHeelStrikeConsumers];
+    for (size_t c = 0; c < kMaxHeelStrikeConsumers; c++) {
+        consumers[c] = reader_mem.SubscribeHeelStrikes();
+    }
+    ASSERT_EQUAL(consumers[kMaxHeelStrikeConsumers - 1], (int)kMaxHeelStrikeConsumers - 1);
+    ASSERT_EQUAL(reader_mem.SubscribeHeelStrikes(), -1);
+    reader_mem.UnsubscribeHeelStrikes(consumers[2]);
+    ASSERT_EQUAL(reader_mem.SubscribeHeelStrikes(), 2);
+    for (size_t c = 0; c < kMaxHeelStrikeConsumers; c++) {
+        reader_mem.UnsubscribeHeelStrikes(consumers[c]);
+    }
+
+    // Concurrent consumers: none of them sees a foot-strike twice or out of order, and the foot-strikes a consumer
+    // did not receive are exactly those counted as lost
+    const int hs_published = 200000;
+    int hs_consumers[2] = {reader_mem.SubscribeHeelStrikes(), reader_mem.SubscribeHeelStrikes()};
+    std::atomic<bool> hs_done(false);
+    int hs_received[2] = {0, 0}, hs_disorders[2] = {0, 0}, hs_torn[2] = {0, 0};
+    std::thread hs_readers[2];
+    for (int c = 0; c < 2; c++) {
+        hs_readers[c] = std::thread([&, c]() {
+            HeelStrikeRecord record;
+            int last_frame = 0;
+            while (true) {
+                bool done = hs_done.load();
+                while (reader_mem.PollHeelStrike(hs_consumers[c], record)) {
+                    hs_received[c]++;
+                    hs_disorders[c] += record.frame <= last_frame;
+                    hs_torn[c] += record.gait_cycle != record.frame || record.time_stamp != record.frame;
+                    last_frame = record.frame;
+                }
+                if (done) {
+                    break;
+                }
+            }
+        });
+    }
+    for (int i = 1; i <= hs_published; i++) {
+        HeelStrikeRecord record = {i & 1, i, i, 0, (double)i, 1.0};
+        writer_mem.PublishHeelStrike(record);
+    }
+    hs_done.store(true);
+    for (int c = 0; c < 2; c++) {
+        hs_readers[c].join();
+        ASSERT_EQUAL(hs_disorders[c], 0);
+        ASSERT_EQUAL(hs_torn[c], 0);
+        ASSERT_EQUAL(hs_received[c] + reader_mem.HeelStrikesLost(hs_consumers[c]), (unsigned long long)hs_published);
+        std::cout << "Consumer " << c << " received " << hs_received[c] << " foot-strikes, lost " << reader_mem.HeelStrikesLost(hs_consumers[c]) << std::endl;
+        reader_mem.UnsubscribeHeelStrikes(hs_consumers[c]);
+    }
+
+    std::cout << std::endl;
+    std::cout << "===== Latency Histogram tests =====" << std::endl;
+    // Intervals between frames at 100 Hz with jitter: 0.25 ms bins up to 50 ms, values outside are clipped to the edge bins
+    LatencyHistogram<200> arrival_histogram(0.25);
+    for (int i = 0; i < 97; i++) arrival_histogram.Add(10.0 + 0.1 * (i % 3));     // 10.0, 10.1 and 10.2 ms
+    arrival_histogram.Add(19.9);
+    arrival_histogram.Add(-1);
+    arrival_histogram.Add(75);
+    ASSERT_EQUAL(arrival_histogram.Count(), 100ull);
+    ASSERT_EQUAL(arrival_histogram.BinCount(40), 97ull);                    // [10, 10.25) ms
+    ASSERT_EQUAL(arrival_histogram.BinCount(79), 1ull);                     // [19.75, 20) ms
+    ASSERT_EQUAL(arrival_histogram.BinCount(0), 1ull);                      // clipped below
+    ASSERT_EQUAL(arrival_histogram.BinCount(199), 1ull);                    // clipped above
+    ASSERT_EQUAL(arrival_histogram.Min(), -1.0);
+    ASSERT_EQUAL(arrival_histogram.Max(), 75.0);
+    ASSERT_EQUAL(arrival_histogram.Percentile(0.5), 10.25);
+    ASSERT_EQUAL(arrival_histogram.Percentile(0.985), 20.0);
+    ASSERT_EQUAL(arrival_histogram.Percentile(1.0), 50.0);
+    arrival_histogram.Reset();
+    ASSERT_EQUAL(arrival_histogram.Count(), 0ull);
+    ASSERT_EQUAL(arrival_histogram.Percentile(0.99), 0.0);
+
+    std::cout << std::endl;
+    std::cout << "===== Replay Scheduler tests =====" << std::endl;
+    // 100 Hz at 10x speed: the frames are released every millisecond, never before their deadline
+    {
+        ReplayScheduler scheduler(100, 10);
+        ASSERT_LESS_THAN(std::fabs(scheduler.TargetRate() - 1000.0), 1e-9);
+        bool early = false;
+        for (int i = 0; i < 50; i++) {
+            early = early || scheduler.WaitNext() < 0;
+        }
+        ASSERT_EQUAL(early, false);
+        ASSERT_EQUAL(scheduler.Frames(), 50ull);
+        ASSERT_EQUAL(scheduler.Lateness().Count(), 50ull);
+        ASSERT_LESS_THAN(std::fabs(scheduler.Elapsed() - 0.049), 0.01);
+    }
+    // Absolute deadlines: a stall of 20 ms is caught up by releasing the late frames at once, so the replay ends at
+    // its nominal time instead of 20 ms later, and the late frames are counted as deadline misses
+    {
+        ReplayScheduler scheduler(1000, 1);
+        scheduler.WaitNext();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        for (int i = 1; i < 40; i++) {
+            scheduler.WaitNext();
+        }
+        ASSERT_LESS_THAN(std::fabs(scheduler.Elapsed() - 0.039), 0.01);
+        ASSERT_GREATER_THAN(scheduler.DeadlineMisses(), 10ull);
+        ASSERT_GREATER_THAN(scheduler.Lateness().Max(), 15000.0);     // [us]
+    }
+    // Unthrottled: no waiting and no lateness
+    {
+        ReplayScheduler scheduler(100, 0);
+        for (int i = 0; i < 1000; i++) {
+            scheduler.WaitNext();
+        }
+        ASSERT_EQUAL(scheduler.TargetRate(), 0.0);
+        ASSERT_LESS_THAN(scheduler.Elapsed(), 0.05);
+        ASSERT_EQUAL(scheduler.Lateness().Count(), 0ull);
+        ASSERT_EQUAL(scheduler.DeadlineMisses(), 0ull);
+    }
+
+    std::cout << std::endl;
+    std::cout << "===== Gait Generator tests =====" << std::endl;
+    // The same seed gives the same frames, and a gait cycle of 1.1 s gives 182 foot-strikes of each foot in 200 s
+    {
+        const size_t gait_frames = 20000;
+        std::vector<MarkerFrame> gait(gait_frames), gait_again(gait_frames);
+        std::vector<unsigned char> gait_truth(gait_frames);
+        GaitGenerator generator;
+        generator.Generate(gait.data(), gait_truth.data(), gait_frames);
+        GaitGenerator same_generator;
+        same_generator.Generate(gait_again.data(), nullptr, gait_frames);
+        bool gait_same = true;
+        for (size_t i = 0; i < gait_frames; i++) {
+            gait_same = gait_same && SameMarkerFrame(gait[i], gait_again[i]);
+        }
+        ASSERT_EQUAL(gait_same, true);
+        ASSERT_EQUAL(gait[0].frame, 1);
+        ASSERT_EQUAL(generator.frame(), 20000);
+        int gait_left = 0, gait_right = 0, first_left = 0, first_right = 0;
+        for (size_t i = 0; i < gait_frames; i++) {
+            if (gait_truth[i] & kGaitLeftStrike) {
+                gait_left++;
+                first_left = first_left == 0 ? gait[i].frame : first_left;
+            }
+            if (gait_truth[i] & kGaitRightStrike) {
+                gait_right++;
+                first_right = first_right == 0 ? gait[i].frame : first_right;
+            }
+        }
+        ASSERT_EQUAL(gait_left, 182);
+        ASSERT_EQUAL(gait_right, 182);
+        ASSERT_EQUAL(first_left, 89);                                  // 0.8 gait cycles after the start
+        ASSERT_EQUAL(first_right, 34);                                 // half a gait cycle before the next left one
+
+        // The GaitMonitor pipeline detects every true foot-strike within 3 frames (30 ms) of the truth; the first gait
+        // cycle is left out, as the start-up transient of the filters gives a spurious detection
+        BilateralGaitMonitor gait_monitor(cutoffFrequency, samplingFrequency);
+        int last_truth[2] = {0, 0}, gait_detected = 0, gait_late = 0;
+        for (size_t i = 0; i < gait_frames; i++) {
+            if (gait_truth[i] & kGaitLeftStrike) last_truth[0] = gait[i].frame;
+            if (gait_truth[i] & kGaitRightStrike) last_truth[1] = gait[i].frame;
+            BilateralGaitEvents events = gait_monitor.process(gait[i], gait[i].frame / samplingFrequency);
+            if (gait[i].frame < 200) {
+                continue;
+            }
+            if (events.left_strike) {
+                gait_detected++;
+                gait_late += std::abs(gait_monitor.left().last_hs_frame - last_truth[0]) > 3;
+            }
+            if (events.right_strike) {
+                gait_detected++;
+                gait_late += std::abs(gait_monitor.right().last_hs_frame - last_truth[1]) > 3;
+            }
+        }
+        ASSERT_EQUAL(gait_detected, 2 * 182 - 4);                      // 3 before frame 200, the last one after the end
+        ASSERT_EQUAL(gait_late, 0);
+    }
+
+    // Step asymmetry delays the right foot-strikes; gait cycle variability changes the durations but not the seed's
+    // sequence of the left and right feet; dropouts set the coordinates of the marker to 0
+    {
+        GaitGeneratorParams gait_params;
+        gait_params.step_asymmetry = 0.1;
+        gait_params.cycle_variability = 0.05;
+        gait_params.dropout_rate = 0.01;
+        GaitGenerator generator(gait_params);
+        MarkerFrame gait_frame;
+        int left_frame = 0, step_frames = 0, steps = 0, heel_dropouts = 0;
+        const int gait_frames = 20000;
+        for (int i = 0; i < gait_frames; i++) {
+            int truth = generator.Next(gait_frame);
+            if (truth & kGaitLeftStrike) left_frame = gait_frame.frame;
+            if ((truth & kGaitRightStrike) && left_frame > 0) {
+                step_frames += gait_frame.frame - left_frame;
+                steps++;
+            }
+            heel_dropouts += gait_frame.LHEEx == 0 && gait_frame.LHEEy == 0 && gait_frame.LHEEz == 0;
+        }
+        ASSERT_LESS_THAN(std::fabs(static_cast<double>(step_frames) / steps - 66.0), 1.5);  // 0.6 gait cycles of 1.1 s
+        ASSERT_LESS_THAN(std::fabs(static_cast<double>(heel_dropouts) / gait_frames - 0.048), 0.01);
+        GaitGenerator restarted(gait_params);
+        MarkerFrame restarted_frame;
+        restarted.Next(restarted_frame);
+        generator.Reset();
+        generator.Next(gait_frame);
+        ASSERT_EQUAL(SameMarkerFrame(gait_frame, restarted_frame), true);
+    }
+
+    // Reduced clearance: a right swing of 40 % (86 mm) stays below the minimum swing rise of F-VESPA, so the right
+    // foot-strikes are not detected and have to be inserted by the fail-safe mechanism
+    {
+        GaitGeneratorParams gait_params;
+        gait_params.right_swing_scale = 0.4;
+        GaitGenerator generator(gait_params);
+        BilateralGaitMonitor gait_monitor(cutoffFrequency, samplingFrequency);
+        MarkerFrame gait_frame;
+        int gait_strikes[2] = {0, 0}, gait_missed[2] = {0, 0};
+        for (int i = 0; i < 5000; i++) {
+            generator.Next(gait_frame);
+            BilateralGaitEvents events = gait_monitor.process(gait_frame, gait_frame.frame / samplingFrequency);
+            gait_strikes[0] += events.left_strike;
+            gait_strikes[1] += events.right_strike;
+            gait_missed[0] += events.left_missed;
+            gait_missed[1] += events.right_missed;
+        }
+        ASSERT_EQUAL(gait_missed[0], 0);
+        ASSERT_GREATER_THAN(gait_missed[1], 30);
+        ASSERT_GREATER_THAN(gait_strikes[0], 40);
+    }
+
+    std::cout << std::endl;
+    std::cout << "===== Frame Source tests =====" << std::endl;
+    // Replay of a trial in two passes: the recorded coordinates are copied, the others are 0, and the frame numbers of
+    // the second pass continue those of the first one
+    std::vector<int32_t> source_frames = {11, 12, 13};
+    std::vector<double> source_lhee_z = {450.0, 449.5, 449.0};
+    std::vector<TrialColumn> source_columns = {
+        {"frame", TrialColumnType::INT32, source_frames.data()},
+        {"LHEEz", TrialColumnType::FLOAT64, source_lhee_z.data()}
+    };
+    const char* source_path = "unit_test_source.fvt";
+    ASSERT_EQUAL(WriteTrialFile(source_path, 200.0, source_frames.size(), source_columns), true);
+    {
+        TrialFrameSource trial_source;
+        ASSERT_EQUAL(trial_source.Open(source_path, 2), true);
+        ASSERT_EQUAL(trial_source.SampleRate(), 200.0);
+        MarkerFrame source_block[4];
+        ASSERT_EQUAL(trial_source.Read(source_block, 4, 0), 4u);
+        ASSERT_EQUAL(source_block[0].frame, 11);
+        ASSERT_EQUAL(source_block[3].frame, 14);
+        ASSERT_EQUAL(source_block[3].LHEEz, 450.0);
+        ASSERT_EQUAL(source_block[1].RHEEz, 0.0);
+        ASSERT_EQUAL(trial_source.Finished(), false);
+        ASSERT_EQUAL(trial_source.Read(source_block, 4, 0), 2u);
+        ASSERT_EQUAL(source_block[1].frame, 16);
+        ASSERT_EQUAL(trial_source.Finished(), true);
+        ASSERT_EQUAL(trial_source.Read(source_block, 4, 0), 0u);
+    }
+    std::remove(source_path);
+    ASSERT_EQUAL(static_cast<bool>(MakeFrameSource("trial:unit_test_missing.fvt")), false);
+    ASSERT_EQUAL(static_cast<bool>(MakeFrameSource("camera:0")), false);
+    ASSERT_EQUAL(static_cast<bool>(MakeFrameSource("synthetic:100:0")), false);
+    ASSERT_EQUAL(MakeFrameSource("synthetic:100:1000")->SampleRate(), 1000.0);
+    ASSERT_EQUAL(TrialFrameSource().GroundTruth(nullptr), false);
+
+    // Synthetic gait: every gait cycle of both feet is detected by the GaitMonitor pipeline, none has to be inserted
+    {
+        std::unique_ptr<FrameSource> synthetic_source = MakeFrameSource("synthetic:20000");
+        ASSERT_EQUAL(static_cast<bool>(synthetic_source), true);
+        BilateralGaitMonitor source_monitor(cutoffFrequency, synthetic_source->SampleRate());
+        MarkerFrame source_block[64];
+        int source_strikes[2] = {0, 0}, source_missed = 0;
+        size_t source_count, source_total = 0;
+        while ((source_count = synthetic_source->Read(source_block, 64, 0)) > 0) {
+            for (size_t i = 0; i < source_count; i++) {
+                BilateralGaitEvents events = source_monitor.process(source_block[i], source_block[i].frame / samplingFrequency);
+                source_strikes[0] += events.left_strike;
+                source_strikes[1] += events.right_strike;
+                source_missed += events.left_missed + events.right_missed;
+            }
+            source_total += source_count;
+        }
+        ASSERT_EQUAL(source_total, 20000u);
+        ASSERT_EQUAL(synthetic_source->Finished(), true);
+        ASSERT_EQUAL(source_strikes[0], 182);                 // 200 s of gait cycles of 1.1 s
+        ASSERT_EQUAL(source_strikes[1], 182);
+        ASSERT_EQUAL(source_missed, 0);
+        unsigned long long source_truth[2];
+        ASSERT_EQUAL(synthetic_source->GroundTruth(source_truth), true);
+        ASSERT_EQUAL(source_truth[0], 182ull);
+        ASSERT_EQUAL(source_truth[1], 182ull);
+    }
+
+    // UDP loopback: the frames arrive in order and unchanged, a frame left out by the sender is counted as dropped, and
+    // the end of the stream finishes the source
+    {
+        UdpFrameSource udp_source;
+        UdpFrameSender udp_sender;
+        const unsigned short udp_port = 47291;
+        ASSERT_EQUAL(udp_source.Open(udp_port), true);
+        ASSERT_EQUAL(udp_sender.Open("127.0.0.1", udp_port), true);
+        ASSERT_EQUAL(udp_sender.Open("localhost", udp_port), false);     // IPv4 addresses only
+        ASSERT_EQUAL(udp_sender.Open("127.0.0.1", udp_port), true);
+        SyntheticFrameSource udp_frames(40);
+        MarkerFrame sent[40], received[40];
+        udp_frames.Read(sent, 40, 0);
+        ASSERT_EQUAL(udp_sender.Send(sent, 20), true);                  // two datagrams
+        ASSERT_EQUAL(udp_sender.Send(sent + 21, 19), true);             // frame 21 is lost
+        ASSERT_EQUAL(udp_sender.SendEnd(), true);
+        size_t udp_count = 0;
+        for (int attempt = 0; attempt < 100 && !udp_source.Finished(); attempt++) {
+            udp_count += udp_source.Read(received + udp_count, 40 - udp_count, 100);
+        }
+        ASSERT_EQUAL(udp_count, 39u);
+        ASSERT_EQUAL(udp_source.Finished(), true);
+        ASSERT_EQUAL(udp_source.Dropped(), 1ull);
+        ASSERT_EQUAL(received[19].frame, 20);
+        ASSERT_EQUAL(received[20].frame, 22);
+        ASSERT_EQUAL(received[38].LHEEz, sent[39].LHEEz);
+        ASSERT_EQUAL(udp_source.Read(received, 40, 0), 0u);
+    }
+
+    std::cout << std::endl;
+    std::cout << "===== Trial File tests =====" << std::endl;
+
+    // Write a small trial and map it back: the columns are read in place with their names, types and values
+    std::vector<int32_t> trial_frames = {1, 2, 3, 4, 5};
+    std::vector<double> trial_lhee_z = {458.2, 458.1, 457.9, 0.0, -1.5};
+    std::vector<float> trial_lhee_y = {333.5f, 333.25f, 333.0f, 332.75f, 332.5f};
+    std::vector<TrialColumn> trial_columns = {
+        {"frame", TrialColumnType::INT32, trial_frames.data()},
+        {"LHEEz", TrialColumnType::FLOAT64, trial_lhee_z.data()},
+        {"LHEEy", TrialColumnType::FLOAT32, trial_lhee_y.data()}
+    };
+    const char* trial_path = "unit_test_trial.fvt";
+    ASSERT_EQUAL(WriteTrialFile(trial_path, 100.0, trial_frames.size(), trial_columns), true);
+    {
+        TrialFile trial;
+        ASSERT_EQUAL(trial.Open(trial_path), true);
+        ASSERT_EQUAL(trial.NumFrames(), trial_frames.size());
+        ASSERT_EQUAL(trial.NumColumns(), 3);
+        ASSERT_EQUAL(trial.SampleRate(), 100.0);
+        ASSERT_EQUAL(std::string(trial.ColumnName(1)), std::string("LHEEz"));
+        ASSERT_EQUAL(trial.FindColumn("LHEEy"), 2);
+        ASSERT_EQUAL(trial.FindColumn("RHEEz"), -1);
+        TrialSpan<double> lhee_z_col = trial.Column<double>("LHEEz");
+        ASSERT_EQUAL(std::equal(lhee_z_col.begin(), lhee_z_col.end(), trial_lhee_z.begin()), true);
+        ASSERT_EQUAL(reinterpret_cast<uintptr_t>(lhee_z_col.data) % 64, 0u);   // columns are cache-line aligned
+        TrialSpan<int32_t> frame_col = trial.Column<int32_t>("frame");
+        ASSERT_EQUAL(frame_col[4], 5);
+        ASSERT_EQUAL(trial.Column<float>("LHEEy")[1], 333.25f);
+        ASSERT_EQUAL(trial.Column<double>("LHEEy").empty(), true);          // wrong element type
+        ASSERT_EQUAL(trial.Value(2, 3), 332.75);
+        ASSERT_EQUAL(trial.Value(0, 2), 3.0);
+    }
+    std::remove(trial_path);
+
+    // Files that are not trial files are rejected
+    std::ofstream not_a_trial(trial_path);
+    not_a_trial << "1 333.385101 458.215424 1" << std::endl;
+    not_a_trial.close();
+    {
+        TrialFile trial;
+        ASSERT_EQUAL(trial.Open(trial_path), false);
+        ASSERT_EQUAL(trial.IsOpen(), false);
+    }
+    std::remove(trial_path);
+
     return 0;
 }
 
@@ -0,0 +1,109 @@
+// Bilateral Gait Monitor interface
+
+#ifndef COMP_BILATERAL_GAIT_MONITOR_H
+#define COMP_BILATERAL_GAIT_MONITOR_H
+
+#include "components/Comp_GaitMonitor.h"
+#include "components/Comp_GaitEvents.h"
+#include "util/SharedMemStruct.h"
+
+// Gait state of one foot, as published to the shared memory (left_gc, left_last_hs_frame, left_gc_dur, ...)
+struct FootGaitState {
+    int gait_cycle;                 // Gait cycle counter
+    int last_hs_frame;              // Frame number of the last foot-strike
+    double gait_cycle_duration;     // [s] Estimated gait cycle duration
+    double time_stamp_hs;           // [s] Time stamp of the last foot-strike
+    double gait_cycle_pct;          // Gait phase: time since the last foot-strike over the gait cycle duration (> 1 if a foot-strike is late)
+};
+
+// Events of one processed frame
+struct BilateralGaitEvents {
+    bool left_strike, right_strike;     // Foot-strike detected by the F-VESPA algorithm
+    bool left_missed, right_missed;     // Missed foot-strike inserted by the fail-safe mechanism
+};
+
+// Define a class monitoring the gait of both feet: it filters the heel markers of every new frame, detects the
+// foot-strikes of the left and right foot with the F-VESPA algorithm, keeps the gait phase of both feet, and runs the
+// fail-safe mechanism for missed foot-strikes: when two foot-strikes of the same foot are detected without a foot-strike
+// of the other foot in between, the missed foot-strike is assumed to have happened when the gait phase of the other foot
+// last exceeded 1. The time stamps are provided by the caller, so the processing of a frame is O(1) and does no I/O.
+class BilateralGaitMonitor {
+public:
+    // params: parameters of the F-VESPA detection conditions of both feet (e.g. kProsthesisFVespaParams)
+    BilateralGaitMonitor(double cutoffFreq = 20, double sampleFreq = 100, const FVespaParams& params = FVespaParams());
+
+    // Start monitoring at time "start_time" [s]: both feet are at the beginning of a gait cycle of 1 s
+    void start(double start_time);
+    // Process one marker frame with time stamp "frame_time_stamp" [s] (e.g. the time it was received, or frame / sampling frequency)
+    BilateralGaitEvents process(const MarkerFrame& markers, double frame_time_stamp);
+    // Update the gait phase of both feet at time "current_time" [s] (called by process for every frame)
+    void update_phase(double current_time);
+
+    // Same as above, also delivering the foot-strikes and the gait phase of both feet to "sink" (see Comp_GaitEvents.h)
+    template <typename Sink>
+    BilateralGaitEvents process(const MarkerFrame& markers, double frame_time_stamp, Sink& sink);
+    template <typename Sink>
+    void update_phase(double current_time, Sink& sink);
+
+    // Select the latency compensation of the heel trajectory of one foot (see FootStrikeDetector::set_latency_compensation)
+    void set_latency_compensation(Foot foot, LatencyCompensation mode, double horizonFrames, double alpha = 0.8, double beta = 0.5);
+
+    const FootGaitState& state(Foot foot) const;
+    const FootGaitState& left() const;
+    const FootGaitState& right() const;
+
+private:
+    // Filtered channels of the heel markers
+    enum HeelChannel { LEFT_VERT = 0, LEFT_SAG, RIGHT_VERT, RIGHT_SAG, NUM_HEEL_CHANNELS };
+
+    ButterworthFilterBank heel_filters;         // Filters of the vertical (z) and sagittal (y) position of both heel markers
+    FootStrikeDetector detectors[2];            // F-VESPA foot-strike detectors (indexed by Foot)
+    FootGaitState states[2];                    // Published gait state of both feet (indexed by Foot)
+    int fail_safe_hs_frame[2];                  // Frame at which the gait phase of each foot last exceeded 1
+    double fail_safe_ts[2];                     // [s] Time at which the gait phase of each foot last exceeded 1
+    int last_strike_foot;                       // Foot of the last foot-strike (-1 before the first foot-strike)
+    int last_frame;                             // Frame number of the last processed frame
+    double phase_time;                          // [s] Time of the last update of the gait phase
+
+    void foot_strike(int foot, BilateralGaitEvents& events);
+    FootStrikeEvent foot_strike_event(Foot foot, bool missed) const;
+    template <typename Sink>
+    void publish_phase(Sink& sink) const;
+};
+
+// Template member functions of BilateralGaitMonitor class delivering the events to a sink
+// (the events are reported in the order: left foot-strike, missed right, right foot-strike, missed left)
+template <typename Sink>
+BilateralGaitEvents BilateralGaitMonitor::process(const MarkerFrame& markers, double frame_time_stamp, Sink& sink) {
+    BilateralGaitEvents events = process(markers, frame_time_stamp);
+    if (events.left_strike) {
+        sink.on_foot_strike(foot_strike_event(Foot::LEFT, false));
+    }
+    if (events.right_missed) {
+        sink.on_foot_strike(foot_strike_event(Foot::RIGHT, true));
+    }
+    if (events.right_strike) {
+        sink.on_foot_strike(foot_strike_event(Foot::RIGHT, false));
+    }
+    if (events.left_missed) {
+        sink.on_foot_strike(foot_strike_event(Foot::LEFT, true));
+    }
+    publish_phase(sink);
+    return events;
+}
+
+template <typename Sink>
+void BilateralGaitMonitor::update_phase(double current_time, Sink& sink) {
+    update_phase(current_time);
+    publish_phase(sink);
+}
+
+template <typename Sink>
+void BilateralGaitMonitor::publish_phase(Sink& sink) const {
+    GaitPhaseEvent left_phase = {Foot::LEFT, last_frame, phase_time, states[static_cast<int>(Foot::LEFT)].gait_cycle_pct};
+    GaitPhaseEvent right_phase = {Foot::RIGHT, last_frame, phase_time, states[static_cast<int>(Foot::RIGHT)].gait_cycle_pct};
+    sink.on_gait_phase(left_phase);
+    sink.on_gait_phase(right_phase);
+}
+
+#endif
@@ -0,0 +1,179 @@
+// Frame source interface
+
+#ifndef COMP_FRAME_SOURCE_H
+#define COMP_FRAME_SOURCE_H
+
+#include "util/GaitGenerator.h"
+#include "util/SharedMemStruct.h"
+#include "util/TrialFile.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*  A frame source delivers the marker frames processed by the GaitMonitor pipeline, so the same detector code runs on
+*   data streamed by Vicon Nexus (ViconFrameSource, Comp_ViconHandler.h), on a recorded trial (TrialFrameSource), on
+*   synthetic gait (SyntheticFrameSource) or on frames received over UDP from another process or machine
+*   (UdpFrameSource, fed by UdpFrameSender). The pipeline selects its source at run time, so frames are read in blocks:
+*   one virtual call delivers all the frames available (usually one for a live stream, up to the block size for a
+*   replay), and the per-frame processing stays free of virtual calls. None of the sources allocates memory per frame.
+*   The replay and synthetic sources deliver their frames as fast as they are read; pacing is left to the caller.
+*/
+
+class FrameSource {
+public:
+    virtual ~FrameSource() {}
+
+    // Read up to "maxFrames" of the next frames into "frames", waiting at most "timeoutMs" milliseconds for the first
+    // one (live sources only). Returns the number of frames read: 0 after a timeout, or once Finished() is true.
+    virtual size_t Read(MarkerFrame* frames, size_t maxFrames, int timeoutMs) = 0;
+    // Whether the source has delivered its last frame (a recording at its end, or a stream that was closed)
+    virtual bool Finished() const = 0;
+    // [Hz] Nominal sampling rate of the frames
+    virtual double SampleRate() const = 0;
+    // Frames lost by the source itself (e.g. gaps in the frame numbers of a stream)
+    virtual unsigned long long Dropped() const { return 0; }
+    // Number of true foot-strikes of the left and right foot in the frames read so far, for sources that know them
+    // (synthetic gait); returns false if the source has no ground truth
+    virtual bool GroundTruth(unsigned long long strikes[2]) const { (void)strikes; return false; }
+    // Short description of the source for the console output
+    virtual std::string Describe() const = 0;
+};
+
+// Define a class replaying a recorded trial: a binary trial file (.fvt, memory-mapped, see util/TrialFile.h) or a .txt
+// recording with the columns frame, LHEEy, LHEEz and offline foot-strike. Every marker coordinate found in the trial
+// (columns named after the MarkerFrame fields, e.g. "LHEEz") is copied, the others are 0. The trial can be replayed
+// several times in a row; the frame numbers then keep increasing, as in one long recording.
+class TrialFrameSource : public FrameSource {
+public:
+    TrialFrameSource();
+
+    // Open a trial file and replay it "repeat" times. Returns false (and prints the reason) on failure.
+    bool Open(const std::string& path, int repeat = 1);
+
+    size_t Read(MarkerFrame* frames, size_t maxFrames, int timeoutMs);
+    bool Finished() const;
+    double SampleRate() const;
+    std::string Describe() const;
+    size_t NumFrames() const;
+
+private:
+    static const int kNumCoordinates = 12;
+
+    TrialFile trial;                                    // Mapped binary trial (.fvt)
+    std::vector<int32_t> text_frames;                   // Columns of a .txt recording, read into memory
+    std::vector<double> text_columns[kNumCoordinates];
+    TrialSpan<int32_t> frame_column;
+    TrialSpan<double> columns[kNumCoordinates];         // Column of every marker coordinate (empty if not recorded)
+    double sample_rate;
+    std::string path;
+    size_t index;                                       // Next frame of the current pass
+    int pass, passes;                                   // Current pass and number of passes
+    int frame_stride;                                   // Frame number offset between two passes
+
+    void init();
+};
+
+// Define a class delivering the synthetic gait of util/GaitGenerator.h (cadence, stride variability, noise, marker
+// dropouts, asymmetry), an endless source of frames for stress tests at any rate, with the ground-truth foot-strikes
+class SyntheticFrameSource : public FrameSource {
+public:
+    // numFrames: frames to generate (0: endless)
+    explicit SyntheticFrameSource(unsigned long long numFrames = 0, const GaitGeneratorParams& params = GaitGeneratorParams());
+
+    size_t Read(MarkerFrame* frames, size_t maxFrames, int timeoutMs);
+    bool Finished() const;
+    double SampleRate() const;
+    bool GroundTruth(unsigned long long strikes[2]) const;
+    std::string Describe() const;
+
+private:
+    unsigned long long num_frames, generated;
+    GaitGenerator generator;
+    unsigned long long true_strikes[2];
+};
+
+// Wire format of the frames sent over UDP: one datagram holds a UdpFrameHeader followed by "count" MarkerFrames in the
+// byte order of the sender (both ends are expected to run on little endian machines, as for the trial files).
+// A datagram with count 0 marks the end of the stream.
+struct UdpFrameHeader {
+    char magic[4];                      // "FVMF"
+    uint32_t count;                     // Number of MarkerFrames following the header
+};
+
+// Largest number of frames in one datagram (kept below the 1500 byte Ethernet MTU)
+const size_t kMaxUdpFrames = (1472 - sizeof(UdpFrameHeader)) / sizeof(MarkerFrame);
+
+#ifdef _WIN32
+typedef uintptr_t UdpSocketHandle;      // SOCKET
+#else
+typedef int UdpSocketHandle;
+#endif
+
+// Define a class receiving the frames sent by a UdpFrameSender (e.g. another process replaying a trial, or a bridge from
+// the Vicon PC). Frames missing in the sequence of frame numbers (lost datagrams) are counted as dropped.
+class UdpFrameSource : public FrameSource {
+public:
+    explicit UdpFrameSource(double sampleFreq = 100);
+    ~UdpFrameSource();
+
+    // Bind to a UDP port on all interfaces. Returns false (and prints the reason) on failure.
+    bool Open(unsigned short port);
+    void Close();
+
+    size_t Read(MarkerFrame* frames, size_t maxFrames, int timeoutMs);
+    bool Finished() const;
+    double SampleRate() const;
+    unsigned long long Dropped() const;
+    std::string Describe() const;
+
+    UdpFrameSource(const UdpFrameSource&) = delete;
+    UdpFrameSource& operator=(const UdpFrameSource&) = delete;
+
+private:
+    UdpSocketHandle socket_handle;
+    bool open, finished;
+    unsigned short bound_port;
+    double sample_rate;
+    MarkerFrame pending[kMaxUdpFrames];                 // Frames of the last datagram not yet read
+    size_t pending_begin, pending_end;
+    int last_frame_number;
+    bool has_last_frame;
+    unsigned long long dropped_frames;
+
+    void receive(int timeoutMs);
+};
+
+// Define a class sending frames to a UdpFrameSource
+class UdpFrameSender {
+public:
+    UdpFrameSender();
+    ~UdpFrameSender();
+
+    // Send to "host" (IPv4 address, e.g. "127.0.0.1") and "port". Returns false (and prints the reason) on failure.
+    bool Open(const std::string& host, unsigned short port);
+    void Close();
+    // Send frames (split into datagrams of at most kMaxUdpFrames frames). Returns false if a datagram could not be sent.
+    bool Send(const MarkerFrame* frames, size_t count);
+    // Send the end of the stream
+    bool SendEnd();
+
+    UdpFrameSender(const UdpFrameSender&) = delete;
+    UdpFrameSender& operator=(const UdpFrameSender&) = delete;
+
+private:
+    UdpSocketHandle socket_handle;
+    bool open;
+    unsigned char destination[16];                      // sockaddr_in of the receiver
+    char buffer[sizeof(UdpFrameHeader) + kMaxUdpFrames * sizeof(MarkerFrame)];
+};
+
+// Create a frame source from a description given on the command line:
+//      "trial:<path>[:<repeat>]"     recorded trial (.fvt or .txt), replayed <repeat> times
+//      "synthetic[:<frames>[:<rate>]]"  synthetic gait (endless if <frames> is omitted or 0) captured at <rate> Hz (default 100)
+//      "udp:<port>"                  frames received on a UDP port
+// (the Vicon source needs the DataStream SDK and is created by the Vicon test itself, see ViconFrameSource).
+// Returns an empty pointer (and prints the reason) if the description is invalid or the source cannot be opened.
+std::unique_ptr<FrameSource> MakeFrameSource(const std::string& description);
+
+#endif
@@ -0,0 +1,158 @@
+// Gait event interface
+
+#ifndef COMP_GAIT_EVENTS_H
+#define COMP_GAIT_EVENTS_H
+
+#include "components/Comp_GaitMonitor.h"
+#include "util/SharedMemStruct.h"
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/*  Foot-strike and gait phase events are delivered to "sinks": any object with the two member functions
+*       void on_foot_strike(const FootStrikeEvent& event);
+*       void on_gait_phase(const GaitPhaseEvent& event);
+*   The producers (e.g. BilateralGaitMonitor::process) are templates on the sink type, so the calls are resolved at
+*   compile time and inlined: there is no virtual dispatch and no allocation per event. A sink that is only interested
+*   in one kind of event derives from GaitEventSink and defines the other member function only.
+*   Several sinks are combined with MakeGaitEventFanOut, and callables (e.g. lambdas) are subscribed with CallbackSink.
+*/
+
+// Enum defining the two feet
+enum class Foot {
+    LEFT = 0,
+    RIGHT
+};
+
+// New foot-strike of one foot (detected by F-VESPA, or inserted by the fail-safe mechanism)
+struct FootStrikeEvent {
+    Foot foot;
+    int frame;                      // Frame in which the foot-strike was reported
+    int gait_cycle;                 // Gait cycle counter after the foot-strike
+    int last_hs_frame;              // Frame number of the foot-strike
+    double gait_cycle_duration;     // [s] Estimated gait cycle duration
+    double time_stamp_hs;           // [s] Time stamp of the foot-strike
+    bool missed;                    // true if the foot-strike was missed by F-VESPA and inserted by the fail-safe mechanism
+};
+
+// New gait phase of one foot
+struct GaitPhaseEvent {
+    Foot foot;
+    int frame;                      // Last processed frame
+    double time_stamp;              // [s] Time at which the gait phase was calculated
+    double gait_cycle_pct;          // Time since the last foot-strike over the gait cycle duration
+};
+
+// Build the foot-strike event of a FootStrikeDetector after FVESPA returned true
+inline FootStrikeEvent MakeFootStrikeEvent(const FootStrikeDetector& detector, Foot foot, int frame, bool missed = false) {
+    FootStrikeEvent event = {foot, frame, detector.gait_cycle, detector.last_hs_frame, detector.gait_cycle_duration, detector.time_stamp_hs, missed};
+    return event;
+}
+
+// Sink ignoring all events (base of sinks interested in one kind of event only)
+struct GaitEventSink {
+    void on_foot_strike(const FootStrikeEvent&) {}
+    void on_gait_phase(const GaitPhaseEvent&) {}
+};
+
+// Non-owning reference to a callable taking an event (a minimal function_ref): one indirect call, no allocation.
+// The callable must outlive the reference; an empty reference ignores the events.
+template <typename Event>
+class EventCallback {
+public:
+    EventCallback() : object(nullptr), invoke(nullptr) {}
+
+    // Not a candidate for EventCallback itself, so that copying a non-const reference copies it instead of wrapping it
+    template <typename Callable,
+              typename = typename std::enable_if<!std::is_same<typename std::decay<Callable>::type, EventCallback>::value>::type>
+    EventCallback(Callable& callable)
+        : object(&callable), invoke([](void* obj, const Event& event) { (*static_cast<Callable*>(obj))(event); }) {}
+
+    void operator()(const Event& event) const {
+        if (invoke != nullptr) {
+            invoke(object, event);
+        }
+    }
+
+private:
+    void* object;
+    void (*invoke)(void*, const Event&);
+};
+
+// Sink forwarding the events to callables, e.g. lambdas of a controller or a logger
+struct CallbackSink {
+    EventCallback<FootStrikeEvent> foot_strike;
+    EventCallback<GaitPhaseEvent> gait_phase;
+
+    void on_foot_strike(const FootStrikeEvent& event) { foot_strike(event); }
+    void on_gait_phase(const GaitPhaseEvent& event) { gait_phase(event); }
+};
+
+// Sink forwarding every event to several sinks, in the order in which they were given
+template <typename... Sinks>
+class GaitEventFanOut {
+public:
+    explicit GaitEventFanOut(Sinks&... sinks) : sinks_(sinks...) {}
+
+    void on_foot_strike(const FootStrikeEvent& event) { foot_strike(event, std::index_sequence_for<Sinks...>()); }
+    void on_gait_phase(const GaitPhaseEvent& event) { gait_phase(event, std::index_sequence_for<Sinks...>()); }
+
+private:
+    std::tuple<Sinks&...> sinks_;
+
+    template <size_t... I>
+    void foot_strike(const FootStrikeEvent& event, std::index_sequence<I...>) {
+        int expand[] = {0, (std::get<I>(sinks_).on_foot_strike(event), 0)...};
+        (void)expand;
+    }
+
+    template <size_t... I>
+    void gait_phase(const GaitPhaseEvent& event, std::index_sequence<I...>) {
+        int expand[] = {0, (std::get<I>(sinks_).on_gait_phase(event), 0)...};
+        (void)expand;
+    }
+};
+
+template <typename... Sinks>
+GaitEventFanOut<Sinks...> MakeGaitEventFanOut(Sinks&... sinks) {
+    return GaitEventFanOut<Sinks...>(sinks...);
+}
+
+// Sink publishing the events to the gait fields of the shared memory (left_gc, left_last_hs_frame, ..., right_gc_pct)
+// and broadcasting every foot-strike to the heel-strike log (see MemManager::PollHeelStrike)
+class SharedMemGaitSink {
+public:
+    explicit SharedMemGaitSink(SharedMemStruct* data) : data(data) {}
+
+    void on_foot_strike(const FootStrikeEvent& event) {
+        if (event.foot == Foot::LEFT) {
+            data->left_gc = event.gait_cycle;
+            data->left_last_hs_frame = event.last_hs_frame;
+            data->left_gc_dur = event.gait_cycle_duration;
+            data->left_time_stamp_hs = event.time_stamp_hs;
+        }
+        else {
+            data->right_gc = event.gait_cycle;
+            data->right_last_hs_frame = event.last_hs_frame;
+            data->right_gc_dur = event.gait_cycle_duration;
+            data->right_time_stamp_hs = event.time_stamp_hs;
+        }
+        HeelStrikeRecord record = {static_cast<int>(event.foot), event.last_hs_frame, event.gait_cycle, event.missed ? 1 : 0,
+                                   event.time_stamp_hs, event.gait_cycle_duration};
+        data->heel_strike_log.Publish(record);
+    }
+
+    void on_gait_phase(const GaitPhaseEvent& event) {
+        if (event.foot == Foot::LEFT) {
+            data->left_gc_pct = event.gait_cycle_pct;
+        }
+        else {
+            data->right_gc_pct = event.gait_cycle_pct;
+        }
+    }
+
+private:
+    SharedMemStruct* data;
+};
+
+#endif
@@ -4,12 +4,26 @@
 #define COMP_GAIT_MONITOR_H
 
 #include <vector>
+#include <cstddef>
+#include <cmath>
+#include "util/RollingWindow.h"
 
 // Define a class implementing a second order Butterworth filter
 class ButterworthFilter {
 public:
     ButterworthFilter(double cutoffFreq, double sampleFreq);
     double filter(double input);
+    // Block versions: filter n consecutive samples (e.g. a recorded trial or a backlog of frames) in one call.
+    // The output is identical to calling filter(double) once per sample, and "output" may be the same array as "input".
+    void filter(const double* input, double* output, size_t n);
+    void filter(const std::vector<double>& input, std::vector<double>& output);
+    // Zero-phase version for recorded signals (offline analysis only): the signal is filtered forwards and backwards with
+    // the same coefficients, after odd reflection of kFiltFiltPadding samples at both ends and with the state of each pass
+    // started at the steady state of its first sample, like MATLAB's filtfilt. The state of the real-time filter is not used or changed.
+    void filtfilt(const double* input, double* output, size_t n) const;
+    void filtfilt(const std::vector<double>& input, std::vector<double>& output) const;
+
+    static const size_t kFiltFiltPadding = 6;   // 3 * filter order, as in MATLAB's filtfilt
 
 private:
     double fc;                              // [Hz] Cutoff frequency
@@ -23,31 +37,398 @@ private:
     double y_n_minus_1, y_n_minus_2;        // Previous outputs
 
     void init();
+    void set_steady_state(double input);
+};
+
+
+// Define a class template implementing a second order Butterworth filter whose cutoff and sampling frequencies [Hz]
+// are fixed at build time (e.g. FixedButterworthFilter<20, 100>). The coefficients are computed and normalized by a1
+// at compile time, so the per-sample difference equation is only multiply-adds. Use ButterworthFilter when the
+// frequencies are only known at runtime. The output matches ButterworthFilter up to floating-point rounding.
+template <int CutoffHz, int SampleHz>
+class FixedButterworthFilter {
+public:
+    static_assert(CutoffHz > 0 && 2 * CutoffHz < SampleHz, "The cutoff frequency must be positive and below the Nyquist frequency");
+
+    // Filter coefficients, computed exactly like ButterworthFilter::init()
+    static constexpr double kPi = 3.14159265358979323846;
+    static constexpr double omega_c_T = (2 * kPi * CutoffHz) * (1.0 / SampleHz);     // [rad] Cutoff frequency times sampling period
+    static constexpr double kSqrt2 = 1.4142135623730951;
+    static constexpr double b1 = omega_c_T * omega_c_T;
+    static constexpr double a1 = 4 + 2 * kSqrt2 * omega_c_T + b1;
+    static constexpr double a2 = -8 + 2 * b1;
+    static constexpr double a3 = 4 - 2 * kSqrt2 * omega_c_T + b1;
+    // Coefficients normalized by a1
+    static constexpr double nb1 = b1 / a1;
+    static constexpr double nb2 = 2 * b1 / a1;
+    static constexpr double nb3 = b1 / a1;
+    static constexpr double na2 = a2 / a1;
+    static constexpr double na3 = a3 / a1;
+
+    FixedButterworthFilter() : x_n_minus_1(0), x_n_minus_2(0), y_n_minus_1(0), y_n_minus_2(0) {}
+
+    // Filter one new sample of the signal
+    double filter(double input) {
+        double output = nb1 * input + nb2 * x_n_minus_1 + nb3 * x_n_minus_2 - na2 * y_n_minus_1 - na3 * y_n_minus_2;
+
+        // Update the state variables (previous inputs and outputs)
+        x_n_minus_2 = x_n_minus_1;
+        x_n_minus_1 = input;
+        y_n_minus_2 = y_n_minus_1;
+        y_n_minus_1 = output;
+        return output;
+    }
+
+    // Filter n consecutive samples in one call ("output" may be the same array as "input")
+    void filter(const double* input, double* output, size_t n) {
+        double x1 = x_n_minus_1, x2 = x_n_minus_2;
+        double y1 = y_n_minus_1, y2 = y_n_minus_2;
+        for (size_t i = 0; i < n; i++) {
+            double in = input[i];
+            double out = nb1 * in + nb2 * x1 + nb3 * x2 - na2 * y1 - na3 * y2;
+            x2 = x1;
+            x1 = in;
+            y2 = y1;
+            y1 = out;
+            output[i] = out;
+        }
+        x_n_minus_1 = x1;
+        x_n_minus_2 = x2;
+        y_n_minus_1 = y1;
+        y_n_minus_2 = y2;
+    }
+
+private:
+    // State variables for the filter
+    double x_n_minus_1, x_n_minus_2;        // Previous inputs
+    double y_n_minus_1, y_n_minus_2;        // Previous outputs
+};
+
+
+// Define a class implementing a bank of second order Butterworth filters of the same cutoff and sampling frequencies,
+// one per channel (e.g. the x/y/z coordinates of all heel and toe markers), that are stepped together once per frame.
+// The state of all channels is stored in structure-of-arrays form, so that the difference equation is evaluated for
+// 4 (AVX) or 2 (NEON) channels per instruction. Every channel gives the same output as a ButterworthFilter.
+class ButterworthFilterBank {
+public:
+    ButterworthFilterBank(int numChannels, double cutoffFreq, double sampleFreq);
+    void filter(const double* input, double* output);  // one new sample per channel in, one filtered sample per channel out
+    int channels() const;
+
+private:
+    int num_channels;                       // Number of filtered channels
+    double fc;                              // [Hz] Cutoff frequency
+    double Fs;                              // [Hz] Sampling frequency
+    double a1, a2, a3, b1, b2, b3;          // Filter coefficients (shared by all channels)
+
+    // State variables of all channels (one element per channel)
+    std::vector<double> x_n_minus_1, x_n_minus_2;   // Previous inputs
+    std::vector<double> y_n_minus_1, y_n_minus_2;   // Previous outputs
+
+    void init();
+};
+
+
+// Position, velocity and acceleration of a heel marker coordinate estimated by a HeelKalmanTracker
+// (the velocity is per frame, i.e. in the units of the position differences used by the F-VESPA algorithm)
+struct HeelEstimate {
+    double position;                        // [mm]
+    double velocity;                        // [mm/frame]
+    double acceleration;                    // [mm/frame^2]
+};
+
+// Define a class implementing a constant-acceleration Kalman filter for one coordinate of a heel marker. It replaces
+// the Butterworth filter and the first difference of the F-VESPA algorithm: every raw sample gives the filtered
+// position and velocity in one pass, with less lag than the Butterworth filter for the same noise rejection.
+// The state (3 elements) and its symmetric covariance (6 elements) are plain members and the predict and update steps
+// are written out element by element, so a step is a few dozen multiply-adds without loops or allocations.
+class HeelKalmanTracker {
+public:
+    // processNoise: spectral density of the jerk [mm^2/frame^5]; measurementNoise: variance of the marker position [mm^2]
+    HeelKalmanTracker(double processNoise = 0.5, double measurementNoise = 1);
+    HeelEstimate update(double measurement);    // one new raw sample in, the estimate at this sample out
+    void reset();
+
+private:
+    double q, r;                            // Process and measurement noise
+    double q00, q01, q02, q11, q12, q22;    // Process noise covariance of one frame (white-noise jerk model)
+    bool initialized;                       // False until the first sample has been received
+    double p, v, a;                         // State: position, velocity and acceleration
+    double p00, p01, p02, p11, p12, p22;    // State covariance (upper triangle)
+};
+
+
+// Enum defining the possible latency-compensation stages between the Butterworth filter and the F-VESPA algorithm
+enum class LatencyCompensation {
+    NONE = 0,           // the filtered samples are used as they are (original behaviour)
+    LINEAR,             // linear extrapolation of the last two filtered samples
+    QUADRATIC,          // quadratic extrapolation of the last three filtered samples
+    ALPHA_BETA          // alpha-beta tracker (constant velocity model), extrapolated with its velocity estimate
+};
+
+// Group delay [frames] of the second order Butterworth filter at low frequencies (sqrt(2) / omega_c), i.e. the lag
+// of the slow heel trajectory behind the raw marker data. Use it as the horizon of a LatencyCompensator.
+double ButterworthGroupDelayFrames(double cutoffFreq, double sampleFreq);
+
+// Define a class implementing a causal predictor that extrapolates a filtered signal "horizon" frames ahead, to remove
+// the phase lag that the Butterworth filter adds in front of the F-VESPA algorithm. The prediction of every sample only
+// uses the current and past samples, so it can run in real time; with LatencyCompensation::NONE the input is returned unchanged.
+class LatencyCompensator {
+public:
+    LatencyCompensator(LatencyCompensation mode = LatencyCompensation::NONE, double horizonFrames = 0, double alpha = 0.8, double beta = 0.5);
+    double compensate(double input);        // one new filtered sample in, one predicted sample out
+    void reset();
+    LatencyCompensation mode() const;
+    double horizon() const;
+
+private:
+    LatencyCompensation compensation;       // Prediction model
+    double h;                               // [frames] Prediction horizon
+    double alpha, beta;                     // Gains of the alpha-beta tracker (position and velocity)
+    int num_samples;                        // Number of samples received (the predictors start once they have enough history)
+    double x_n_minus_1, x_n_minus_2;        // Previous inputs
+    double position, velocity;              // State of the alpha-beta tracker ([frames] is the time unit of the velocity)
 };
 
 
 // Define a class implementing a foot-strike detector algorithm
+// Enum defining the possible time sources of the foot-strike time stamps
+enum class TimeSource {
+    WALL_CLOCK = 0,     // system clock at the moment of detection (real-time use)
+    FRAME_CLOCK         // frame number divided by the sampling frequency (deterministic, e.g. replays faster than real time)
+};
+
+// Enum defining the possible estimators of the gait cycle duration from the durations of the last gait cycles
+enum class DurationEstimator {
+    MEAN = 0,           // mean of the last "durationWindow" gait cycles (including the initial zeros of the window)
+    EWMA,               // exponentially weighted moving average, seeded with the first duration between two foot-strikes
+    MEDIAN              // median of the last "durationWindow" gait cycles (robust to single missed or spurious foot-strikes)
+};
+
+// Structure holding the parameters of the F-VESPA detection conditions, so that one build serves several populations.
+// The default values are those of the original algorithm for healthy subjects (kHealthyFVespaParams); the variant for
+// prosthesis users is kProsthesisFVespaParams. Tuned values can be searched with offline_GaitMonitor_tests/Sweep_FVESPA.
+struct FVespaParams {
+    double max_heel_height = 500;       // [mm] A foot-strike is only detected below this vertical heel position
+    double min_swing_rise = 100;        // [mm] Rise of the heel above the last foot-strike that marks the swing phase
+    double strike_vel_vert_min = 0;     // [mm/frame] Vertical velocity at or above which the descending heel has stopped
+    double strike_vel_sag_max = 0;      // [mm/frame] Sagittal velocity at or below which the heel has stopped moving forward
+    int velocity_history = 3;           // Number of previous vertical velocities checked by the conditions (1 to kMaxVelocityHistory)
+    int strike_frame_offset = -1;       // Foot-strike frame relative to the frame of the detection
+    bool strike_vel_sag_strict = false; // Sagittal velocity test strictly below strike_vel_sag_max instead of at or below
+};
+
+const int kMaxVelocityHistory = 8;      // Maximum number of previous vertical velocities kept by a FootStrikeDetector
+
+// Parameters of the original algorithm (healthy subjects)
+constexpr FVespaParams kHealthyFVespaParams = {500, 100, 0, 0, 3, -1};
+// Parameters of the variant for prosthesis users: vel_z >= -0.01 and vel_s < 6.01 (strict, as in the original code);
+// its "search_flag == 0" test is not kept, since the search flag is set at the first swing phase and would then block
+// every later foot-strike.
+constexpr FVespaParams kProsthesisFVespaParams = {500, 100, -0.01, 6.01, 3, -1, true};
+
 class FootStrikeDetector {
 public:
-    FootStrikeDetector();
+    static const int kMaxDurationWindow = 16;  // Maximum number of gait cycles in the duration window
+
+    // The default arguments give the original behaviour: mean duration of the last five gait cycles
+    FootStrikeDetector(TimeSource timeSource = TimeSource::WALL_CLOCK, double sampleFreq = 100, int durationWindow = 5,
+                       DurationEstimator durationEstimator = DurationEstimator::MEAN, double ewmaAlpha = 0.3);
+    // same, with the parameters of the detection conditions (e.g. kProsthesisFVespaParams)
+    explicit FootStrikeDetector(const FVespaParams& params, TimeSource timeSource = TimeSource::WALL_CLOCK, double sampleFreq = 100,
+                                int durationWindow = 5, DurationEstimator durationEstimator = DurationEstimator::MEAN, double ewmaAlpha = 0.3);
 
     // define protorype of public member fuction responsible for implementing the F-VESPA algorithm
+    // (the time stamp of a foot-strike is taken from the time source of the detector)
     bool FVESPA(int frame,double heel_vert_new_f, double heel_sag_new_f);
+    // same, with the time stamp [s] of the frame provided by the frame source (e.g. Vicon or a recording)
+    bool FVESPA(int frame,double heel_vert_new_f, double heel_sag_new_f, double frame_time_stamp);
+    // same, with the positions and velocities estimated by a HeelKalmanTracker per coordinate instead of the filtered
+    // positions (the velocities are then used as they are instead of the first differences of the positions)
+    bool FVESPA(int frame, const HeelEstimate& heel_vert, const HeelEstimate& heel_sag);
+    bool FVESPA(int frame, const HeelEstimate& heel_vert, const HeelEstimate& heel_sag, double frame_time_stamp);
+    // same as the first two, with the parameters of the detection conditions fixed at compile time instead of those of the
+    // detector (e.g. FVESPA<kHealthyFVespaParams>(...)): the compiler folds the constants into the comparisons and unrolls
+    // the velocity history. The results are identical to those of a detector constructed with the same parameters.
+    template <const FVespaParams& Params>
+    bool FVESPA(int frame, double heel_vert_new_f, double heel_sag_new_f);
+    template <const FVespaParams& Params>
+    bool FVESPA(int frame, double heel_vert_new_f, double heel_sag_new_f, double frame_time_stamp);
+
+    // Enable a latency-compensation stage applied to the filtered samples before the detection conditions
+    // (e.g. LatencyCompensation::LINEAR with ButterworthGroupDelayFrames(20, 100) as horizon); NONE disables it again
+    void set_latency_compensation(LatencyCompensation mode, double horizonFrames, double alpha = 0.8, double beta = 0.5);
+
+    // Replace the parameters of the detection conditions (the defaults give the original behaviour); returns false and
+    // keeps the current parameters if the velocity history is not between 1 and kMaxVelocityHistory
+    bool set_params(const FVespaParams& params);
+    const FVespaParams& params() const;
 
     // Define the variables of interest that will be propagated to the shared memory
     int last_hs_frame, gait_cycle;
     double gait_cycle_duration,time_stamp_hs;
 
 private:
+    TimeSource time_source;
+    double Fs;                              // [Hz] Sampling frequency (used by the frame clock)
 	int search_flag;
     bool foot_strike_flag;
-	double min_heel,vel_prev_1,vel_prev_2,vel_prev_3;
+	double min_heel;
+    double vel_prev[kMaxVelocityHistory];   // Previous vertical velocities, newest first
 	double heel_vert_new_f,heel_sag_new_f,vel_z,vel_s;
 	double heel_vert_filt_one_sample_ago,heel_vert_filt_two_samples_ago;
 	double heel_sag_filt_one_sample_ago;  
-	double temp_sum,new_duration;
+	double new_duration;
 	double time_stamp_hs_prev;
-    std::vector<double> gait_cycle_duration_vector;
+    DurationEstimator duration_estimator;
+    double ewma_alpha;                      // Weight of the newest gait cycle in the EWMA estimator
+    RollingWindow<double, kMaxDurationWindow> gait_cycle_duration_window;   // Durations of the last gait cycles
+    LatencyCompensator vert_compensator, sag_compensator;                   // Predictors of the vertical and sagittal position
+    FVespaParams fvespa_params;                                             // Parameters of the detection conditions
+    bool detect(int frame,double heel_vert_new_f, double heel_sag_new_f);
+    bool detect(int frame,double heel_vert_new_f, double heel_sag_new_f, double heel_vert_vel, double heel_sag_vel);
+    inline bool detect(const FVespaParams& params, int frame, double heel_vert_new_f, double heel_sag_new_f,
+                       double heel_vert_vel, double heel_sag_vel);
+    void update_time_stamp(int frame);
+    void update_duration(double new_time_stamp_hs);
+    void init();
+};
+
+
+// Private member function of FootStrikeDetector class implementing the detection conditions of the F-VESPA algorithm
+// for given velocities of the heel marker in the vertical and sagittal directions. It is shared by the run-time and the
+// compile-time parameters, so both give identical results; with a constexpr "params" inlined, the loops over the
+// velocity history are unrolled and the thresholds become immediate operands.
+// Returns true if a foot-strike was detected (the time stamp and gait cycle duration are then updated by the caller)
+inline bool FootStrikeDetector::detect(const FVespaParams& params, int frame, double heel_vert_new_f, double heel_sag_new_f,
+                                       double heel_vert_vel, double heel_sag_vel){
+
+        vel_z = heel_vert_vel;
+        vel_s = heel_sag_vel;
+
+        // Set flag showing whether a foot-strike took place to false by default (will be set to true if a foot-strike is detected)
+        foot_strike_flag = false;
+
+        // The heel descended during the whole velocity history; at the apex it descended in the last frame only
+        bool descending = true, rising_before = true;
+        for (int i = 0; i < params.velocity_history; i++) {
+            descending = descending && vel_prev[i] <= 0;
+            rising_before = rising_before && (i == 0 ? vel_prev[i] <= 0 : vel_prev[i] >= 0);
+        }
+
+        // Condition for detecting a foot-strike
+        // Necessary for Vicon F.S. and extra check that foot-strikes are not detected in swing phase
+        if (vel_z>=params.strike_vel_vert_min && descending && search_flag == true &&
+            (params.strike_vel_sag_strict ? vel_s<params.strike_vel_sag_max : vel_s<=params.strike_vel_sag_max) &&
+            heel_vert_new_f<params.max_heel_height){
+
+            // Update the minimum value of the vertical position of the heel marker
+            min_heel = heel_vert_filt_one_sample_ago;
+
+            // Register the frame number of the foot-strike
+            last_hs_frame = frame+params.strike_frame_offset;
+
+            // Increase the counter of the gait cycles
+            gait_cycle = gait_cycle+1;
+
+            // Set the flag showing whether a foot-strike took place to true
+            foot_strike_flag = true;
+
+            // Set the search flag to false to avoid detecting a new foot-strike in the same gait cycle
+            search_flag = false;
+        }
+        else if (frame>params.velocity_history-1 && vel_z<0 && rising_before && ((heel_vert_filt_two_samples_ago-min_heel)>params.min_swing_rise)){
+            // Condition for detecting the frame where the heel marker reaches its maximum vertical position
+
+            // Enable the search for a new foot-strike (this avoid detecting a new foot-strike during swing phase)
+            search_flag = true;
+        }
+
+        // Update the previous velocity values
+        for (int i = params.velocity_history - 1; i > 0; i--) {
+            vel_prev[i] = vel_prev[i - 1];
+        }
+        vel_prev[0] = vel_z;
+
+        // Update the previous filtered position values
+        heel_vert_filt_two_samples_ago = heel_vert_filt_one_sample_ago;
+        heel_vert_filt_one_sample_ago = heel_vert_new_f;
+        heel_sag_filt_one_sample_ago = heel_sag_new_f;
+
+        // Return the flag showing whether a foot-strike took place
+        return foot_strike_flag;
+}
+
+// Public member function of FootStrikeDetector class implementing the F-VESPA algorithm with compile-time parameters
+// Inputs: Vicon Nexus frame number, new filtered sample of the vertical and sagittal position of the heel marker (left or right)
+template <const FVespaParams& Params>
+bool FootStrikeDetector::FVESPA(int frame, double heel_vert_new_f, double heel_sag_new_f){
+        static_assert(Params.velocity_history >= 1 && Params.velocity_history <= kMaxVelocityHistory,
+                      "The velocity history must be between 1 and kMaxVelocityHistory");
+        heel_vert_new_f = vert_compensator.compensate(heel_vert_new_f);
+        heel_sag_new_f = sag_compensator.compensate(heel_sag_new_f);
+        if (!detect(Params, frame, heel_vert_new_f, heel_sag_new_f, heel_vert_new_f - heel_vert_filt_one_sample_ago,
+                    heel_sag_new_f - heel_sag_filt_one_sample_ago)) {
+            return false;
+        }
+
+        update_time_stamp(frame);
+        return true;
+}
+
+// Public member function of FootStrikeDetector class implementing the F-VESPA algorithm with compile-time parameters
+// Inputs: Vicon Nexus frame number, new filtered sample of the vertical and sagittal position of the heel marker (left or right),
+// time stamp of the frame in seconds provided by the frame source
+template <const FVespaParams& Params>
+bool FootStrikeDetector::FVESPA(int frame, double heel_vert_new_f, double heel_sag_new_f, double frame_time_stamp){
+        static_assert(Params.velocity_history >= 1 && Params.velocity_history <= kMaxVelocityHistory,
+                      "The velocity history must be between 1 and kMaxVelocityHistory");
+        heel_vert_new_f = vert_compensator.compensate(heel_vert_new_f);
+        heel_sag_new_f = sag_compensator.compensate(heel_sag_new_f);
+        if (!detect(Params, frame, heel_vert_new_f, heel_sag_new_f, heel_vert_new_f - heel_vert_filt_one_sample_ago,
+                    heel_sag_new_f - heel_sag_filt_one_sample_ago)) {
+            return false;
+        }
+
+        update_duration(frame_time_stamp);
+        return true;
+}
+
+// Define a class implementing a bank of foot-strike detectors, one per foot (e.g. both feet of several subjects
+// walking in the same capture volume), that are stepped together once per frame. The state of all feet is stored in
+// structure-of-arrays form and the F-VESPA conditions are evaluated without branches, so that the compiler vectorizes
+// the loop over the feet. Every foot gives exactly the same results as a FootStrikeDetector whose FVESPA is called
+// with the same time stamps (pass frame / sampling frequency as time stamp to reproduce the frame clock).
+class FootStrikeDetectorBank {
+public:
+    FootStrikeDetectorBank(int numFeet);
+
+    // Process one frame for all feet: one new filtered sample of the vertical and sagittal position of every heel marker,
+    // and the time stamp [s] of the frame. "foot_strike" (optional) receives 1 for every foot with a foot-strike and 0 otherwise.
+    // Returns the number of feet with a foot-strike at this frame.
+    int FVESPA(int frame, const double* heel_vert_new_f, const double* heel_sag_new_f, double frame_time_stamp, unsigned char* foot_strike = nullptr);
+    int feet() const;
+
+    // Variables of interest of each foot (same meaning as the public members of FootStrikeDetector)
+    int last_hs_frame(int foot) const;
+    int gait_cycle(int foot) const;
+    double gait_cycle_duration(int foot) const;
+    double time_stamp_hs(int foot) const;
+
+private:
+    static const int kDurationWindow = 5;   // Number of gait cycles averaged in the gait cycle duration
+    int num_feet;
+
+    // State of all feet (one element per foot). Counters, frame numbers and flags are stored as doubles, which
+    // represent them exactly and keep every array of the vectorized loop the same element width.
+    std::vector<double> search_flag, min_heel;
+    std::vector<double> vel_prev_1, vel_prev_2, vel_prev_3;
+    std::vector<double> heel_vert_filt_one_sample_ago, heel_vert_filt_two_samples_ago, heel_sag_filt_one_sample_ago;
+    std::vector<double> last_hs_frame_, gait_cycle_, gait_cycle_duration_, time_stamp_hs_;
+    std::vector<double> temp_sum;
+    std::vector<double> gait_cycle_duration_window[kDurationWindow];   // Durations of the last gait cycles, oldest first
+    std::vector<unsigned char> foot_strike_flags;                       // Scratch output when the caller passes no array
+
     void init();
 };
 
@@ -0,0 +1,31 @@
+// Offline Gait Analysis interface
+
+#ifndef COMP_OFFLINE_GAIT_ANALYSIS_H
+#define COMP_OFFLINE_GAIT_ANALYSIS_H
+
+#include "components/Comp_GaitMonitor.h"
+#include <vector>
+
+/*  Post-hoc processing of whole recorded trials (e.g. the columns of a memory-mapped trial file, util/TrialFile.h).
+*   Unlike the real-time classes of Comp_GaitMonitor.h, these functions see the whole signal at once, so they use the
+*   zero-phase (forward-backward) Butterworth filter and may run on several threads. They are meant for generating
+*   the offline ground truth of the F-VESPA algorithm and must not be used in the real-time loops.
+*/
+
+// Zero-phase filter several channels of a recorded trial with the same Butterworth filter, one channel per task on up to
+// "numThreads" threads (0: one per hardware thread). inputs[c] and outputs[c] hold the n samples of channel c and
+// may be the same array. Every channel gives the same output as ButterworthFilter::filtfilt.
+void FiltFiltChannels(double cutoffFreq, double sampleFreq, const double* const* inputs, double* const* outputs,
+                      int numChannels, size_t n, int numThreads = 0);
+
+// Offline F-VESPA: detect the foot-strikes of one foot in a whole recorded trial. The raw vertical and sagittal positions
+// of the heel marker are zero-phase filtered and passed to a FootStrikeDetector frame by frame.
+// Returns the frame numbers of the foot-strikes (FootStrikeDetector::last_hs_frame), in order.
+std::vector<int> OfflineFVESPA(const int* frames, const double* heel_vert, const double* heel_sag, size_t n,
+                               double cutoffFreq = 20, double sampleFreq = 100);
+
+// Expand foot-strike frames to one value per frame, holding the last foot-strike frame before each frame (the layout of
+// the 4th column of the recorded trials, which changes one frame after the foot-strike). Earlier frames hold "initial".
+std::vector<int> LastFootStrikeColumn(const int* frames, size_t n, const std::vector<int>& foot_strikes, int initial = 1);
+
+#endif
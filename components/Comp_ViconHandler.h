@@ -1,13 +1,132 @@
 // Vicon low level component interface
 
-// #include <iostream>
-// #include<Windows.h>
-
-// class ViconHandler {
-// public:
-//   double getRHEEx() {
-//     std::cout << "1" << " dot h" << std::endl;
-//     //double RHEEx_test = 1;
-//     return 1;
-//   }
-// }; 
\ No newline at end of file
+#ifndef COMP_VICON_HANDLER_H
+#define COMP_VICON_HANDLER_H
+
+#include "include/Vicon/inc/DataStreamClient.h"
+#include "components/Comp_FrameSource.h"
+#include "util/LatencyHistogram.h"
+#include "util/SharedMemStruct.h"
+#include <chrono>
+#include <string>
+
+// Enum defining the markers read from the Vicon DataStream (the heel and toe markers of both feet)
+enum class ViconMarker {
+    RHEE = 0,
+    LHEE,
+    RTOE,
+    LTOE,
+    NUM_MARKERS
+};
+
+// Structure holding the timing of the ingest of the frames (time from the first to the last marker of a frame)
+struct ViconIngestStats {
+    unsigned long long frames = 0;          // Frames read
+    unsigned long long resolutions = 0;     // Scans of the subjects and markers for the wanted marker names
+    unsigned long long missing = 0;         // Wanted markers that could not be read (not found, renamed or removed)
+    unsigned long long occluded = 0;        // Wanted markers reported as occluded
+    double last_us = 0;                     // [us] Ingest time of the last frame
+    double total_us = 0;                    // [us] Sum of the ingest times (mean = total_us / frames)
+    double max_us = 0;                      // [us] Longest ingest time
+    unsigned long long failed_gets = 0;     // GetFrame calls that returned no frame
+    unsigned long long backoffs = 0;        // Sleeps of the bounded backoff after a failed GetFrame
+    unsigned long long dropped_frames = 0;  // Frame numbers skipped between two frames read
+    unsigned long long latency_alarms = 0;  // Frames whose latency exceeded the latency budget
+    double last_latency_s = 0;              // [s] Latency of the last frame (SDK latency + time since its arrival)
+    double max_latency_s = 0;               // [s] Largest latency of a frame
+};
+
+// Histogram of the intervals between the arrivals of two frames [ms]: 0.25 ms bins up to 50 ms
+typedef LatencyHistogram<200> ViconArrivalHistogram;
+
+// Define a class reading the heel and toe markers of every new frame from a connected Vicon DataStream client into a
+// MarkerFrame. The subjects and markers are scanned for the wanted marker names only when the subject set changes
+// (different subject count, or a wanted marker can no longer be read); the subject and marker names found are cached,
+// and every frame then fetches the four wanted markers directly. The SDK addresses markers by name only, so the cached
+// names are passed to GetMarkerGlobalTranslation without copying: no std::string is created and no memory is allocated
+// per frame. ScanFrame keeps the original per-frame scan of all subjects and markers, to measure the difference.
+//
+// WaitForFrame gets the next frame with the blocking GetFrame of the SDK (ServerPush or ClientPullPreFetch stream mode:
+// the call returns when the next frame arrives). A failed call is retried with a bounded backoff (a few immediate
+// retries, then sleeps of 1, 2, 4 and at most 8 ms, shorter than a frame period at 100 Hz) instead of a fixed sleep that
+// would stall the pipeline for several frames. The intervals between the arrivals of the frames are collected in a
+// histogram, and the latency of every frame (latency reported by the SDK plus the time from its arrival to the end of
+// ReadFrame) is stored in the MarkerFrame and compared with a latency budget.
+class ViconHandler {
+public:
+    // client: connected client with marker data enabled; GetFrame must have succeeded before every ReadFrame
+    ViconHandler(ViconDataStreamSDK::CPP::Client& client);
+
+    // Get the next frame from the DataStream; returns false if no frame arrived within "timeoutMs" milliseconds
+    bool WaitForFrame(int timeoutMs = 1000);
+    // Raise an alarm (counted, and reported on the console once per excursion) for every frame whose latency exceeds
+    // "budgetSeconds" (0 disables the alarm; default 20 ms, two frames at 100 Hz)
+    void set_latency_budget(double budgetSeconds);
+
+    // Read the wanted markers of the current frame and its frame number into "frame" (markers that cannot be read keep
+    // their previous values). Returns false if a wanted marker was missing.
+    bool ReadFrame(MarkerFrame& frame);
+    // Same result with the original scan of every subject and marker by name (allocates strings for every marker)
+    bool ScanFrame(MarkerFrame& frame);
+    // Scan the subjects and markers for the wanted marker names now (done automatically when the subject set changes)
+    bool resolve();
+
+    const ViconIngestStats& stats() const;
+    const ViconArrivalHistogram& arrival_histogram() const;
+    bool resolved(ViconMarker marker) const;
+    const std::string& subject_name(ViconMarker marker) const;
+
+    ViconHandler(const ViconHandler&) = delete;
+    ViconHandler& operator=(const ViconHandler&) = delete;
+
+private:
+    static const int kNumMarkers = static_cast<int>(ViconMarker::NUM_MARKERS);
+    static const int kResolveRetryFrames = 100;     // Frames between two scans while a wanted marker is not found
+    static const int kImmediateRetries = 3;         // Failed GetFrame calls retried without sleeping
+    static const int kMaxBackoffMs = 8;             // Longest sleep between two GetFrame calls
+
+    ViconDataStreamSDK::CPP::Client& client;
+    std::string subject_names[kNumMarkers];         // Subject of every wanted marker (cached by resolve)
+    std::string marker_names[kNumMarkers];          // Name of every wanted marker
+    bool found[kNumMarkers];                        // Whether the wanted marker was found by the last scan
+    unsigned int subject_count;                     // Number of subjects at the last scan
+    bool stale;                                     // A wanted marker could not be read: scan again
+    int frames_since_resolve;
+    ViconIngestStats ingest_stats;
+    ViconArrivalHistogram arrival_intervals;
+    std::chrono::steady_clock::time_point last_arrival;     // Arrival of the last frame got by WaitForFrame
+    bool arrival_valid;                             // Whether the current frame was got by WaitForFrame
+    bool has_previous_arrival;
+    unsigned int last_frame_number;                 // Frame number of the last frame read (0: none yet)
+    double latency_budget;                          // [s] Latency budget (0: disabled)
+    bool over_budget;                               // Whether the last frame exceeded the latency budget
+
+    void store(ViconMarker marker, const double translation[3], MarkerFrame& frame) const;
+    void record_time(double elapsed_us);
+    void finish_frame(MarkerFrame& frame, std::chrono::steady_clock::time_point start);
+    void init();
+};
+
+// Define a class delivering the frames streamed by Vicon Nexus to the GaitMonitor pipeline (see Comp_FrameSource.h):
+// every Read waits for the next frame with ViconHandler::WaitForFrame and returns it, so a live stream is read one
+// frame at a time. The stream is finished when the client is disconnected.
+class ViconFrameSource : public FrameSource {
+public:
+    // client: connected client with marker data enabled (ServerPush or ClientPullPreFetch stream mode)
+    explicit ViconFrameSource(ViconDataStreamSDK::CPP::Client& client);
+
+    size_t Read(MarkerFrame* frames, size_t maxFrames, int timeoutMs);
+    bool Finished() const;
+    double SampleRate() const;
+    unsigned long long Dropped() const;
+    std::string Describe() const;
+
+    ViconHandler& handler();
+
+private:
+    ViconDataStreamSDK::CPP::Client& client;
+    ViconHandler marker_handler;
+    MarkerFrame last_frame;                         // Markers that cannot be read keep their values of the last frame
+};
+
+#endif
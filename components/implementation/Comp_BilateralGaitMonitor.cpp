@@ -0,0 +1,121 @@
+// Definition and analysis of the member functions of the BilateralGaitMonitor class
+
+#include "components/Comp_BilateralGaitMonitor.h"
+
+// Constructor for BilateralGaitMonitor class
+BilateralGaitMonitor::BilateralGaitMonitor(double cutoffFreq, double sampleFreq, const FVespaParams& params)
+    : heel_filters(NUM_HEEL_CHANNELS, cutoffFreq, sampleFreq), detectors{FootStrikeDetector(params), FootStrikeDetector(params)} {
+    this->start(0);
+}
+
+// Public member function of BilateralGaitMonitor class resetting the gait state of both feet
+// Input: time stamp of the start of the monitoring in seconds
+void BilateralGaitMonitor::start(double start_time) {
+    for (int foot = 0; foot < 2; foot++) {
+        states[foot].gait_cycle = 0;
+        states[foot].last_hs_frame = 0;
+        states[foot].gait_cycle_duration = 1;   // assume a gait cycle of 1 s until the first foot-strikes have been detected
+        states[foot].time_stamp_hs = start_time;
+        states[foot].gait_cycle_pct = 0;
+        fail_safe_hs_frame[foot] = 0;
+        fail_safe_ts[foot] = start_time;
+    }
+    last_strike_foot = -1;
+    last_frame = 0;
+    phase_time = start_time;
+}
+
+// Public member function of BilateralGaitMonitor class responsible for processing one new marker frame
+// Inputs: marker frame (only the heel markers are used), time stamp of the frame in seconds
+// Output: foot-strikes detected and inserted by the fail-safe mechanism in this frame
+BilateralGaitEvents BilateralGaitMonitor::process(const MarkerFrame& markers, double frame_time_stamp) {
+    BilateralGaitEvents events = {false, false, false, false};
+    last_frame = markers.frame;
+
+    // (1) Filter the new samples of the vertical and sagittal position of both heel markers
+    double heel[NUM_HEEL_CHANNELS] = {markers.LHEEz, markers.LHEEy, markers.RHEEz, markers.RHEEy};
+    heel_filters.filter(heel, heel);
+
+    // (2) Detect the foot-strikes of the left and the right foot, and run the fail-safe mechanism
+    if (detectors[static_cast<int>(Foot::LEFT)].FVESPA(markers.frame, heel[LEFT_VERT], heel[LEFT_SAG], frame_time_stamp)) {
+        events.left_strike = true;
+        foot_strike(static_cast<int>(Foot::LEFT), events);
+    }
+    if (detectors[static_cast<int>(Foot::RIGHT)].FVESPA(markers.frame, heel[RIGHT_VERT], heel[RIGHT_SAG], frame_time_stamp)) {
+        events.right_strike = true;
+        foot_strike(static_cast<int>(Foot::RIGHT), events);
+    }
+
+    // (3) Update the gait phase of both feet
+    update_phase(frame_time_stamp);
+    return events;
+}
+
+// Private member function of BilateralGaitMonitor class publishing a new foot-strike and handling missed foot-strikes of the other foot
+void BilateralGaitMonitor::foot_strike(int foot, BilateralGaitEvents& events) {
+    FootStrikeDetector& detector = detectors[foot];
+    states[foot].gait_cycle = detector.gait_cycle;
+    states[foot].last_hs_frame = detector.last_hs_frame;
+    states[foot].gait_cycle_duration = detector.gait_cycle_duration;
+    states[foot].time_stamp_hs = detector.time_stamp_hs;
+
+    int other = 1 - foot;
+    if (last_strike_foot == foot) {
+        // Two consecutive foot-strikes of this foot without a foot-strike of the other foot in between:
+        // the foot-strike of the other foot is assumed to have been missed when its gait phase exceeded 1
+        FootStrikeDetector& other_detector = detectors[other];
+        other_detector.gait_cycle = other_detector.gait_cycle + 1;
+        other_detector.last_hs_frame = fail_safe_hs_frame[other];
+        other_detector.time_stamp_hs = fail_safe_ts[other];
+        // The gait cycle duration is not affected and is assumed to be the same as the previous gait cycle
+        states[other].gait_cycle = other_detector.gait_cycle;
+        states[other].last_hs_frame = other_detector.last_hs_frame;
+        states[other].time_stamp_hs = other_detector.time_stamp_hs;
+        if (other == static_cast<int>(Foot::LEFT)) {
+            events.left_missed = true;
+        }
+        else {
+            events.right_missed = true;
+        }
+    }
+    last_strike_foot = foot;
+}
+
+// Public member function of BilateralGaitMonitor class updating the gait cycle percentage of both feet
+// Input: current time stamp in seconds
+void BilateralGaitMonitor::update_phase(double current_time) {
+    phase_time = current_time;
+    for (int foot = 0; foot < 2; foot++) {
+        // Time passed since the last foot-strike divided over the average gait cycle duration
+        states[foot].gait_cycle_pct = (current_time - states[foot].time_stamp_hs) / states[foot].gait_cycle_duration;
+        // Whenever the gait cycle percentage is greater than 1, store the frame number and time stamp for the fail-safe mechanism
+        if (states[foot].gait_cycle_pct > 1) {
+            fail_safe_hs_frame[foot] = last_frame;
+            fail_safe_ts[foot] = current_time;
+        }
+    }
+}
+
+// Private member function of BilateralGaitMonitor class building the foot-strike event of one foot from its published state
+FootStrikeEvent BilateralGaitMonitor::foot_strike_event(Foot foot, bool missed) const {
+    const FootGaitState& foot_state = states[static_cast<int>(foot)];
+    FootStrikeEvent event = {foot, last_frame, foot_state.gait_cycle, foot_state.last_hs_frame, foot_state.gait_cycle_duration, foot_state.time_stamp_hs, missed};
+    return event;
+}
+
+// Public member function of BilateralGaitMonitor class selecting the latency compensation of the detector of one foot
+void BilateralGaitMonitor::set_latency_compensation(Foot foot, LatencyCompensation mode, double horizonFrames, double alpha, double beta) {
+    detectors[static_cast<int>(foot)].set_latency_compensation(mode, horizonFrames, alpha, beta);
+}
+
+const FootGaitState& BilateralGaitMonitor::state(Foot foot) const {
+    return states[static_cast<int>(foot)];
+}
+
+const FootGaitState& BilateralGaitMonitor::left() const {
+    return states[static_cast<int>(Foot::LEFT)];
+}
+
+const FootGaitState& BilateralGaitMonitor::right() const {
+    return states[static_cast<int>(Foot::RIGHT)];
+}
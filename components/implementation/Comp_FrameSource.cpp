@@ -0,0 +1,501 @@
+// Definition and analysis of the member functions of the frame source classes
+
+// Winsock must be included before windows.h (included by util/TrialFile.h)
+#ifdef _WIN32
+  #include <winsock2.h>
+  #include <ws2tcpip.h>
+#endif
+#include "components/Comp_FrameSource.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifndef _WIN32
+  #include <arpa/inet.h>    // For inet_pton()
+  #include <cerrno>
+  #include <netinet/in.h>   // For sockaddr_in
+  #include <sys/select.h>   // For select()
+  #include <sys/socket.h>   // For socket(), bind(), recv(), sendto()
+  #include <unistd.h>       // For close()
+#endif
+
+using namespace std;
+
+// Names of the marker coordinates in the trial files and their fields in MarkerFrame
+static const char* const kCoordinateNames[] = {"RHEEx", "RHEEy", "RHEEz", "LHEEx", "LHEEy", "LHEEz",
+                                               "RTOEx", "RTOEy", "RTOEz", "LTOEx", "LTOEy", "LTOEz"};
+static double MarkerFrame::* const kCoordinateFields[] = {
+    &MarkerFrame::RHEEx, &MarkerFrame::RHEEy, &MarkerFrame::RHEEz, &MarkerFrame::LHEEx, &MarkerFrame::LHEEy, &MarkerFrame::LHEEz,
+    &MarkerFrame::RTOEx, &MarkerFrame::RTOEy, &MarkerFrame::RTOEz, &MarkerFrame::LTOEx, &MarkerFrame::LTOEy, &MarkerFrame::LTOEz
+};
+
+// Platform specific socket helpers
+#ifdef _WIN32
+static const UdpSocketHandle kInvalidSocket = static_cast<UdpSocketHandle>(INVALID_SOCKET);
+static int SocketError() { return WSAGetLastError(); }
+static void CloseSocket(UdpSocketHandle handle) { closesocket(static_cast<SOCKET>(handle)); }
+#else
+static const UdpSocketHandle kInvalidSocket = -1;
+static int SocketError() { return errno; }
+static void CloseSocket(UdpSocketHandle handle) { close(handle); }
+#endif
+
+// Open a UDP socket (starting Winsock on Windows). Returns kInvalidSocket (and prints the reason) on failure.
+static UdpSocketHandle OpenUdpSocket() {
+#ifdef _WIN32
+    WSADATA wsa_data;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {
+        cerr << "WSAStartup failed: " << SocketError() << endl;
+        return kInvalidSocket;
+    }
+    UdpSocketHandle handle = static_cast<UdpSocketHandle>(socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP));
+    if (handle == kInvalidSocket) {
+        cerr << "socket failed: " << SocketError() << endl;
+        WSACleanup();
+    }
+#else
+    UdpSocketHandle handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (handle == kInvalidSocket) {
+        cerr << "socket failed: " << strerror(errno) << endl;
+    }
+#endif
+    return handle;
+}
+
+static void CloseUdpSocket(UdpSocketHandle handle) {
+    CloseSocket(handle);
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+
+// Constructor for TrialFrameSource class
+TrialFrameSource::TrialFrameSource() {
+    this->init();
+}
+
+// Public member function of TrialFrameSource class responsible for opening a recorded trial
+// Inputs: path of the trial (.fvt binary trial file, or .txt recording), number of passes over the trial
+// Returns false if the trial cannot be read or holds no frame numbers
+bool TrialFrameSource::Open(const std::string& trialPath, int repeat) {
+    init();
+    trial.Close();
+    path = trialPath;
+    passes = repeat > 0 ? repeat : 1;
+    bool binary = path.size() > 4 && path.compare(path.size() - 4, 4, ".fvt") == 0;
+
+    if (binary) {
+        if (!trial.Open(path)) {
+            return false;
+        }
+        sample_rate = trial.SampleRate();
+        frame_column = trial.Column<int32_t>("frame");
+        for (int c = 0; c < kNumCoordinates; c++) {
+            columns[c] = trial.Column<double>(kCoordinateNames[c]);
+        }
+    }
+    else {
+        // Columns of the .txt recordings: frame, LHEEy, LHEEz, offline foot-strike (ignored)
+        ifstream infile(path);
+        if (!infile.is_open()) {
+            cerr << "Error opening the file " << path << endl;
+            return false;
+        }
+        int frame, offline_fs;
+        double lhee_y, lhee_z;
+        while (infile >> frame >> lhee_y >> lhee_z >> offline_fs) {
+            text_frames.push_back(frame);
+            text_columns[4].push_back(lhee_y);
+            text_columns[5].push_back(lhee_z);
+        }
+        frame_column.data = text_frames.data();
+        frame_column.size = text_frames.size();
+        for (int c = 0; c < kNumCoordinates; c++) {
+            columns[c].data = text_columns[c].empty() ? nullptr : text_columns[c].data();
+            columns[c].size = text_columns[c].size();
+        }
+    }
+
+    if (frame_column.empty()) {
+        cerr << "The trial " << path << " contains no frame numbers." << endl;
+        trial.Close();
+        return false;
+    }
+    frame_stride = frame_column[frame_column.size - 1] - frame_column[0] + 1;
+    return true;
+}
+
+// Public member function of TrialFrameSource class responsible for reading the next frames of the trial
+// Inputs: array receiving the frames, its capacity, timeout (not used: the frames of a trial are always available)
+// Returns the number of frames read
+size_t TrialFrameSource::Read(MarkerFrame* frames, size_t maxFrames, int) {
+    size_t count = 0;
+    while (count < maxFrames && !Finished()) {
+        MarkerFrame& frame = frames[count++];
+        for (int c = 0; c < kNumCoordinates; c++) {
+            frame.*kCoordinateFields[c] = columns[c].empty() ? 0 : columns[c][index];
+        }
+        frame.frame = frame_column[index] + pass * frame_stride;
+        frame.vicon_latency = 0;
+        if (++index == frame_column.size) {
+            index = 0;
+            pass++;
+        }
+    }
+    return count;
+}
+
+// Public member function of TrialFrameSource class returning whether every pass over the trial has been read
+bool TrialFrameSource::Finished() const {
+    return frame_column.empty() || pass >= passes;
+}
+
+// Public member function of TrialFrameSource class returning the sampling rate of the trial (100 Hz for .txt recordings)
+double TrialFrameSource::SampleRate() const {
+    return sample_rate;
+}
+
+// Public member function of TrialFrameSource class describing the source
+std::string TrialFrameSource::Describe() const {
+    ostringstream description;
+    description << "trial " << path << " (" << frame_column.size << " frames";
+    if (passes > 1) {
+        description << ", " << passes << " passes";
+    }
+    description << ")";
+    return description.str();
+}
+
+// Public member function of TrialFrameSource class returning the number of frames of one pass over the trial
+size_t TrialFrameSource::NumFrames() const {
+    return frame_column.size;
+}
+
+// Initialization function of TrialFrameSource class
+void TrialFrameSource::init() {
+    text_frames.clear();
+    for (int c = 0; c < kNumCoordinates; c++) {
+        text_columns[c].clear();
+        columns[c].data = nullptr;
+        columns[c].size = 0;
+    }
+    frame_column.data = nullptr;
+    frame_column.size = 0;
+    sample_rate = 100;                          // sampling rate of Vicon
+    index = 0;
+    pass = 0;
+    passes = 1;
+    frame_stride = 0;
+}
+
+
+// Constructor for SyntheticFrameSource class
+// Inputs: number of frames to generate (0: endless), parameters of the synthetic gait
+SyntheticFrameSource::SyntheticFrameSource(unsigned long long numFrames, const GaitGeneratorParams& params)
+    : num_frames(numFrames), generated(0), generator(params) {
+    true_strikes[0] = true_strikes[1] = 0;
+}
+
+// Public member function of SyntheticFrameSource class responsible for generating the next frames
+// Inputs: array receiving the frames, its capacity, timeout (not used)
+// Returns the number of frames generated
+size_t SyntheticFrameSource::Read(MarkerFrame* frames, size_t maxFrames, int) {
+    size_t count = 0;
+    while (count < maxFrames && !Finished()) {
+        int truth = generator.Next(frames[count++]);
+        true_strikes[0] += (truth & kGaitLeftStrike) != 0;
+        true_strikes[1] += (truth & kGaitRightStrike) != 0;
+        generated++;
+    }
+    return count;
+}
+
+// Public member function of SyntheticFrameSource class returning whether all frames have been generated
+bool SyntheticFrameSource::Finished() const {
+    return num_frames > 0 && generated >= num_frames;
+}
+
+// Public member function of SyntheticFrameSource class returning the sampling rate of the generated frames
+double SyntheticFrameSource::SampleRate() const {
+    return generator.params().sample_rate;
+}
+
+// Public member function of SyntheticFrameSource class returning the true foot-strikes of the frames generated so far
+bool SyntheticFrameSource::GroundTruth(unsigned long long strikes[2]) const {
+    strikes[0] = true_strikes[0];
+    strikes[1] = true_strikes[1];
+    return true;
+}
+
+// Public member function of SyntheticFrameSource class describing the source
+std::string SyntheticFrameSource::Describe() const {
+    const GaitGeneratorParams& params = generator.params();
+    ostringstream description;
+    description << "synthetic gait (" << (num_frames > 0 ? to_string(num_frames) : string("endless")) << " frames, "
+                << params.sample_rate << " Hz, gait cycle " << params.cycle_seconds << " s, noise " << params.noise_mm << " mm)";
+    return description.str();
+}
+
+
+// Constructor for UdpFrameSource class
+// Input: nominal sampling rate of the frames sent
+UdpFrameSource::UdpFrameSource(double sampleFreq)
+    : socket_handle(kInvalidSocket), open(false), finished(false), bound_port(0), sample_rate(sampleFreq),
+      pending_begin(0), pending_end(0), last_frame_number(0), has_last_frame(false), dropped_frames(0) {
+}
+
+UdpFrameSource::~UdpFrameSource() {
+    Close();
+}
+
+// Public member function of UdpFrameSource class responsible for binding to a UDP port
+// Input: port number
+// Returns false if the socket cannot be created or bound
+bool UdpFrameSource::Open(unsigned short port) {
+    Close();
+    socket_handle = OpenUdpSocket();
+    if (socket_handle == kInvalidSocket) {
+        return false;
+    }
+    // Large receive buffer, so that a burst of datagrams (e.g. an unthrottled replay) is not lost while the
+    // GaitMonitor is busy
+    int buffer_size = 4 * 1024 * 1024;
+    setsockopt(socket_handle, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&buffer_size), sizeof(buffer_size));
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (::bind(socket_handle, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        cerr << "Binding to UDP port " << port << " failed: " << SocketError() << endl;
+        CloseUdpSocket(socket_handle);
+        socket_handle = kInvalidSocket;
+        return false;
+    }
+    open = true;
+    finished = false;
+    bound_port = port;
+    pending_begin = pending_end = 0;
+    has_last_frame = false;
+    dropped_frames = 0;
+    return true;
+}
+
+// Public member function of UdpFrameSource class closing the socket
+void UdpFrameSource::Close() {
+    if (open) {
+        CloseUdpSocket(socket_handle);
+        socket_handle = kInvalidSocket;
+        open = false;
+    }
+}
+
+// Public member function of UdpFrameSource class responsible for reading the next frames received
+// Inputs: array receiving the frames, its capacity, longest time to wait for the first frame in milliseconds
+// Returns the number of frames read (the datagrams already received are read without waiting)
+size_t UdpFrameSource::Read(MarkerFrame* frames, size_t maxFrames, int timeoutMs) {
+    size_t count = 0;
+    while (count < maxFrames) {
+        if (pending_begin == pending_end) {
+            if (finished || !open) {
+                break;
+            }
+            receive(count == 0 ? timeoutMs : 0);
+            if (pending_begin == pending_end) {
+                break;
+            }
+        }
+        frames[count++] = pending[pending_begin++];
+    }
+    return count;
+}
+
+// Public member function of UdpFrameSource class returning whether the end of the stream has been received
+bool UdpFrameSource::Finished() const {
+    return (finished || !open) && pending_begin == pending_end;
+}
+
+// Public member function of UdpFrameSource class returning the nominal sampling rate of the stream
+double UdpFrameSource::SampleRate() const {
+    return sample_rate;
+}
+
+// Public member function of UdpFrameSource class returning the frames missing in the sequence of frame numbers
+unsigned long long UdpFrameSource::Dropped() const {
+    return dropped_frames;
+}
+
+// Public member function of UdpFrameSource class describing the source
+std::string UdpFrameSource::Describe() const {
+    return "UDP port " + to_string(bound_port);
+}
+
+// Private member function of UdpFrameSource class receiving one datagram into the pending frames
+// Input: longest time to wait for the datagram in milliseconds (datagrams that are not frame datagrams are skipped)
+void UdpFrameSource::receive(int timeoutMs) {
+    const chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+    char datagram[sizeof(UdpFrameHeader) + kMaxUdpFrames * sizeof(MarkerFrame)];
+    UdpFrameHeader header;
+    while (true) {
+        long long remaining_us = chrono::duration_cast<chrono::microseconds>(deadline - chrono::steady_clock::now()).count();
+        remaining_us = remaining_us > 0 ? remaining_us : 0;
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(socket_handle, &readable);
+        timeval timeout;
+        timeout.tv_sec = static_cast<long>(remaining_us / 1000000);
+        timeout.tv_usec = static_cast<long>(remaining_us % 1000000);
+        if (select(static_cast<int>(socket_handle) + 1, &readable, nullptr, nullptr, &timeout) <= 0) {
+            return;
+        }
+
+        int received = static_cast<int>(recv(socket_handle, datagram, sizeof(datagram), 0));
+        if (received < static_cast<int>(sizeof(UdpFrameHeader))) {
+            continue;
+        }
+        memcpy(&header, datagram, sizeof(header));
+        if (memcmp(header.magic, "FVMF", 4) == 0 && header.count <= kMaxUdpFrames &&
+            static_cast<size_t>(received) == sizeof(UdpFrameHeader) + header.count * sizeof(MarkerFrame)) {
+            break;
+        }
+        // Not a frame datagram: wait for the next one until the deadline
+    }
+    if (header.count == 0) {
+        finished = true;
+        return;
+    }
+    memcpy(pending, datagram + sizeof(UdpFrameHeader), header.count * sizeof(MarkerFrame));
+    pending_begin = 0;
+    pending_end = header.count;
+
+    // Count the frames missing between the last frame received and the first frame of this datagram
+    int first_frame = pending[0].frame;
+    if (has_last_frame && first_frame > last_frame_number + 1) {
+        dropped_frames += first_frame - last_frame_number - 1;
+    }
+    last_frame_number = pending[pending_end - 1].frame;
+    has_last_frame = true;
+}
+
+
+// Constructor for UdpFrameSender class
+UdpFrameSender::UdpFrameSender() : socket_handle(kInvalidSocket), open(false) {
+    memset(destination, 0, sizeof(destination));
+}
+
+UdpFrameSender::~UdpFrameSender() {
+    Close();
+}
+
+// Public member function of UdpFrameSender class responsible for opening a socket to the receiver
+// Inputs: IPv4 address and UDP port of the receiver
+// Returns false if the address is invalid or the socket cannot be created
+bool UdpFrameSender::Open(const std::string& host, unsigned short port) {
+    Close();
+    sockaddr_in address;
+    static_assert(sizeof(address) <= sizeof(destination), "destination is too small for a sockaddr_in");
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1) {
+        cerr << "Invalid IPv4 address: " << host << endl;
+        return false;
+    }
+    socket_handle = OpenUdpSocket();
+    if (socket_handle == kInvalidSocket) {
+        return false;
+    }
+    memcpy(destination, &address, sizeof(address));
+    memcpy(buffer, "FVMF", 4);
+    open = true;
+    return true;
+}
+
+// Public member function of UdpFrameSender class closing the socket
+void UdpFrameSender::Close() {
+    if (open) {
+        CloseUdpSocket(socket_handle);
+        socket_handle = kInvalidSocket;
+        open = false;
+    }
+}
+
+// Public member function of UdpFrameSender class responsible for sending frames
+// Inputs: frames, number of frames
+// Returns false if a datagram could not be sent
+bool UdpFrameSender::Send(const MarkerFrame* frames, size_t count) {
+    if (!open) {
+        return false;
+    }
+    bool ok = true;
+    do {
+        uint32_t block = static_cast<uint32_t>(count < kMaxUdpFrames ? count : kMaxUdpFrames);
+        memcpy(buffer + 4, &block, sizeof(block));
+        memcpy(buffer + sizeof(UdpFrameHeader), frames, block * sizeof(MarkerFrame));
+        int length = static_cast<int>(sizeof(UdpFrameHeader) + block * sizeof(MarkerFrame));
+        if (sendto(socket_handle, buffer, length, 0, reinterpret_cast<const sockaddr*>(destination), sizeof(sockaddr_in)) != length) {
+            ok = false;
+        }
+        frames += block;
+        count -= block;
+    } while (count > 0);
+    return ok;
+}
+
+// Public member function of UdpFrameSender class responsible for sending the end of the stream
+bool UdpFrameSender::SendEnd() {
+    return Send(nullptr, 0);
+}
+
+
+// Create a frame source from its description
+// Input: description of the source ("trial:<path>[:<repeat>]", "synthetic[:<frames>[:<rate>]]" or "udp:<port>")
+// Returns the opened source, or an empty pointer if the description is invalid or the source cannot be opened
+std::unique_ptr<FrameSource> MakeFrameSource(const std::string& description) {
+    size_t colon = description.find(':');
+    string kind = description.substr(0, colon);
+    string argument = colon == string::npos ? string() : description.substr(colon + 1);
+
+    if (kind == "trial" && !argument.empty()) {
+        // An optional number of passes follows the last colon (Windows paths may contain a colon themselves)
+        int repeat = 1;
+        size_t last_colon = argument.rfind(':');
+        if (last_colon != string::npos && last_colon + 1 < argument.size() &&
+            argument.find_first_not_of("0123456789", last_colon + 1) == string::npos) {
+            repeat = atoi(argument.c_str() + last_colon + 1);
+            argument.erase(last_colon);
+        }
+        unique_ptr<TrialFrameSource> source(new TrialFrameSource());
+        if (source->Open(argument, repeat)) {
+            return unique_ptr<FrameSource>(std::move(source));
+        }
+    }
+    else if (kind == "synthetic") {
+        // Optional number of frames and capture rate
+        char* rate_text = nullptr;
+        unsigned long long frames = argument.empty() ? 0 : strtoull(argument.c_str(), &rate_text, 10);
+        GaitGeneratorParams params;
+        if (rate_text != nullptr && *rate_text == ':') {
+            params.sample_rate = atof(rate_text + 1);
+        }
+        if (params.sample_rate > 0) {
+            return unique_ptr<FrameSource>(new SyntheticFrameSource(frames, params));
+        }
+        cerr << "Invalid capture rate of the synthetic gait: " << description << endl;
+    }
+    else if (kind == "udp" && !argument.empty()) {
+        unique_ptr<UdpFrameSource> source(new UdpFrameSource());
+        if (source->Open(static_cast<unsigned short>(atoi(argument.c_str())))) {
+            return unique_ptr<FrameSource>(std::move(source));
+        }
+    }
+    else {
+        cerr << "Invalid frame source: " << description << " (expected trial:<path>[:<repeat>], synthetic[:<frames>[:<rate>]] or udp:<port>)" << endl;
+    }
+    return unique_ptr<FrameSource>();
+}
@@ -3,14 +3,19 @@
 #include "components/Comp_GaitMonitor.h"
 #include <iostream>
 #include <chrono>
+#include <cmath>
+#include <algorithm>
 
-// Define constants
-#ifndef M_PI 
-#define M_PI 3.14159
+#if defined(__AVX__)
+  #include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  #include <arm_neon.h>
 #endif
 
 using namespace std; 
 
+const double kPi = 3.14159265358979323846;
+
 // Constructor for Butterworth Filter class invoked automatically when a "ButterworthFilter" object is created
 ButterworthFilter::ButterworthFilter(double cutoffFreq, double sampleFreq) {
     this->fc = cutoffFreq;          // set the cutoff frequency
@@ -33,9 +38,85 @@ double ButterworthFilter::filter(double input) {
     return output;
 }
 
+// Public member function of ButterworthFilter class responsible for filtering a block of samples
+// Inputs: array of n new samples of the signal to be filtered, number of samples n
+// Output: array of n filtered samples of the signal
+void ButterworthFilter::filter(const double* input, double* output, size_t n) {
+    // Keep the state variables in local variables (registers) for the whole block
+    double x1 = x_n_minus_1, x2 = x_n_minus_2;
+    double y1 = y_n_minus_1, y2 = y_n_minus_2;
+    for (size_t i = 0; i < n; i++) {
+        double in = input[i];
+        double out = (b1 * in + b2 * x1 + b3 * x2 - a2 * y1 - a3 * y2) / a1;
+        x2 = x1;
+        x1 = in;
+        y2 = y1;
+        y1 = out;
+        output[i] = out;
+    }
+    // Store the state variables back, so that filtering can continue with the next sample or block
+    x_n_minus_1 = x1;
+    x_n_minus_2 = x2;
+    y_n_minus_1 = y1;
+    y_n_minus_2 = y2;
+}
+
+// Public member function of ButterworthFilter class responsible for filtering a whole signal stored in a vector
+// Input: vector of new samples of the signal to be filtered
+// Output: vector of filtered samples (resized to the size of the input)
+void ButterworthFilter::filter(const vector<double>& input, vector<double>& output) {
+    output.resize(input.size());
+    filter(input.data(), output.data(), input.size());
+}
+
+// Public member function of ButterworthFilter class responsible for zero-phase filtering of a recorded signal
+// Inputs: array of the n samples of the whole signal, number of samples n
+// Output: array of n zero-phase filtered samples (may be the same array as the input)
+void ButterworthFilter::filtfilt(const double* input, double* output, size_t n) const {
+    if (n == 0) {
+        return;
+    }
+    // (1) Extend the signal at both ends by odd reflection around the first and last sample, so that the
+    // start-up transients of the two passes fall on the padding and not on the signal
+    size_t pad = (n - 1 < kFiltFiltPadding) ? n - 1 : kFiltFiltPadding;
+    vector<double> padded(n + 2 * pad);
+    for (size_t i = 0; i < pad; i++) {
+        padded[pad - 1 - i] = 2 * input[0] - input[i + 1];
+        padded[pad + n + i] = 2 * input[n - 1] - input[n - 2 - i];
+    }
+    std::copy(input, input + n, padded.begin() + pad);
+
+    // (2) Forward pass, then backward pass on the reversed output, each started at the steady state of its first sample
+    ButterworthFilter pass(*this);
+    pass.set_steady_state(padded.front());
+    pass.filter(padded.data(), padded.data(), padded.size());
+    std::reverse(padded.begin(), padded.end());
+    pass.set_steady_state(padded.front());
+    pass.filter(padded.data(), padded.data(), padded.size());
+    std::reverse(padded.begin(), padded.end());
+
+    // (3) Drop the padding
+    std::copy(padded.begin() + pad, padded.begin() + pad + n, output);
+}
+
+// Public member function of ButterworthFilter class responsible for zero-phase filtering of a recorded signal stored in a vector
+void ButterworthFilter::filtfilt(const vector<double>& input, vector<double>& output) const {
+    output.resize(input.size());
+    filtfilt(input.data(), output.data(), input.size());
+}
+
+// Private member function of ButterworthFilter class setting the state to the steady state of a constant input
+// (the gain of the low-pass filter at zero frequency is 1, so all previous inputs and outputs equal the input)
+void ButterworthFilter::set_steady_state(double input) {
+    x_n_minus_1 = input;
+    x_n_minus_2 = input;
+    y_n_minus_1 = input;
+    y_n_minus_2 = input;
+}
+
 // Initialization function of ButterworthFilter class
 void ButterworthFilter::init() {
-    omega_c = 2 * M_PI * fc;                    // Calculate the cutoff frequency in rad/s
+    omega_c = 2 * kPi * fc;                     // Calculate the cutoff frequency in rad/s
     T = 1 / Fs;                                 // Calculate the sampling period
     // Calculate the filter coefficients
     b1 = pow(omega_c * T, 2);
@@ -44,106 +125,697 @@ void ButterworthFilter::init() {
     a1 = 4 + 2 * sqrt(2) * omega_c * T + b1;
     a2 = -8 + 2 * b1;
     a3 = 4 - 2 * sqrt(2) * omega_c * T + b1;
+    // Initialize the state variables (previous inputs and outputs) to zero
+    x_n_minus_1 = 0;
+    x_n_minus_2 = 0;
+    y_n_minus_1 = 0;
+    y_n_minus_2 = 0;
+}
+
+//---------------------------------------------------------------------------------
+// Butterworth Filter Bank Functions
+
+// Constructor for ButterworthFilterBank class invoked automatically when a "ButterworthFilterBank" object is created
+ButterworthFilterBank::ButterworthFilterBank(int numChannels, double cutoffFreq, double sampleFreq) {
+    this->num_channels = numChannels;   // set the number of channels
+    this->fc = cutoffFreq;              // set the cutoff frequency
+    this->Fs = sampleFreq;              // set the sampling frequency
+    this->init();                       // call the initializing function
+}
+
+// Public member function of ButterworthFilterBank class responsible for filtering one new sample of every channel
+// Input: array with one new sample per channel
+// Output: array with one filtered sample per channel (may be the same array as the input)
+void ButterworthFilterBank::filter(const double* input, double* output) {
+    double* x1 = x_n_minus_1.data();
+    double* x2 = x_n_minus_2.data();
+    double* y1 = y_n_minus_1.data();
+    double* y2 = y_n_minus_2.data();
+    int ch = 0;
+
+    // The vectorized difference equation performs the operations in the same order as ButterworthFilter::filter
+#if defined(__AVX__)
+    const __m256d vb1 = _mm256_set1_pd(b1), vb2 = _mm256_set1_pd(b2), vb3 = _mm256_set1_pd(b3);
+    const __m256d va1 = _mm256_set1_pd(a1), va2 = _mm256_set1_pd(a2), va3 = _mm256_set1_pd(a3);
+    for (; ch + 4 <= num_channels; ch += 4) {
+        __m256d in = _mm256_loadu_pd(input + ch);
+        __m256d px1 = _mm256_loadu_pd(x1 + ch), px2 = _mm256_loadu_pd(x2 + ch);
+        __m256d py1 = _mm256_loadu_pd(y1 + ch), py2 = _mm256_loadu_pd(y2 + ch);
+        __m256d acc = _mm256_add_pd(_mm256_mul_pd(vb1, in), _mm256_mul_pd(vb2, px1));
+        acc = _mm256_add_pd(acc, _mm256_mul_pd(vb3, px2));
+        acc = _mm256_sub_pd(acc, _mm256_mul_pd(va2, py1));
+        acc = _mm256_sub_pd(acc, _mm256_mul_pd(va3, py2));
+        __m256d out = _mm256_div_pd(acc, va1);
+        // Update the state variables (previous inputs and outputs)
+        _mm256_storeu_pd(x2 + ch, px1);
+        _mm256_storeu_pd(x1 + ch, in);
+        _mm256_storeu_pd(y2 + ch, py1);
+        _mm256_storeu_pd(y1 + ch, out);
+        _mm256_storeu_pd(output + ch, out);
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const float64x2_t vb1 = vdupq_n_f64(b1), vb2 = vdupq_n_f64(b2), vb3 = vdupq_n_f64(b3);
+    const float64x2_t va1 = vdupq_n_f64(a1), va2 = vdupq_n_f64(a2), va3 = vdupq_n_f64(a3);
+    for (; ch + 2 <= num_channels; ch += 2) {
+        float64x2_t in = vld1q_f64(input + ch);
+        float64x2_t px1 = vld1q_f64(x1 + ch), px2 = vld1q_f64(x2 + ch);
+        float64x2_t py1 = vld1q_f64(y1 + ch), py2 = vld1q_f64(y2 + ch);
+        float64x2_t acc = vaddq_f64(vmulq_f64(vb1, in), vmulq_f64(vb2, px1));
+        acc = vaddq_f64(acc, vmulq_f64(vb3, px2));
+        acc = vsubq_f64(acc, vmulq_f64(va2, py1));
+        acc = vsubq_f64(acc, vmulq_f64(va3, py2));
+        float64x2_t out = vdivq_f64(acc, va1);
+        // Update the state variables (previous inputs and outputs)
+        vst1q_f64(x2 + ch, px1);
+        vst1q_f64(x1 + ch, in);
+        vst1q_f64(y2 + ch, py1);
+        vst1q_f64(y1 + ch, out);
+        vst1q_f64(output + ch, out);
+    }
+#endif
+
+    // Remaining channels (all channels if no vector instructions are available)
+    for (; ch < num_channels; ch++) {
+        double in = input[ch];
+        double out = (b1 * in + b2 * x1[ch] + b3 * x2[ch] - a2 * y1[ch] - a3 * y2[ch]) / a1;
+        x2[ch] = x1[ch];
+        x1[ch] = in;
+        y2[ch] = y1[ch];
+        y1[ch] = out;
+        output[ch] = out;
+    }
+}
+
+// Public member function of ButterworthFilterBank class returning the number of filtered channels
+int ButterworthFilterBank::channels() const {
+    return num_channels;
+}
+
+// Initialization function of ButterworthFilterBank class
+void ButterworthFilterBank::init() {
+    double omega_c = 2 * kPi * fc;              // Calculate the cutoff frequency in rad/s
+    double T = 1 / Fs;                          // Calculate the sampling period
+    // Calculate the filter coefficients (identical to the ones of ButterworthFilter)
+    b1 = pow(omega_c * T, 2);
+    b2 = 2 * b1;
+    b3 = b1;
+    a1 = 4 + 2 * sqrt(2) * omega_c * T + b1;
+    a2 = -8 + 2 * b1;
+    a3 = 4 - 2 * sqrt(2) * omega_c * T + b1;
+    // Initialize the state variables of all channels to zero
+    x_n_minus_1.assign(num_channels, 0);
+    x_n_minus_2.assign(num_channels, 0);
+    y_n_minus_1.assign(num_channels, 0);
+    y_n_minus_2.assign(num_channels, 0);
+}
+
+//---------------------------------------------------------------------------------
+// Heel Kalman Tracker Functions
+
+// Constructor for HeelKalmanTracker class
+// Inputs: spectral density of the jerk [mm^2/frame^5], variance of the measured marker position [mm^2]
+HeelKalmanTracker::HeelKalmanTracker(double processNoise, double measurementNoise) {
+    this->q = processNoise;             // set the process noise
+    this->r = measurementNoise;         // set the measurement noise
+    // Process noise covariance of one frame (T = 1) for a white-noise jerk of spectral density q
+    q00 = q / 20;
+    q01 = q / 8;
+    q02 = q / 6;
+    q11 = q / 3;
+    q12 = q / 2;
+    q22 = q;
+    this->reset();
+}
+
+// Public member function of HeelKalmanTracker class responsible for implementing the Kalman filter
+// Input: new raw sample of the marker coordinate
+// Output: estimated position, velocity and acceleration at this sample
+HeelEstimate HeelKalmanTracker::update(double measurement) {
+    if (!initialized) {
+        // Start at the first sample, at rest, with an uncertain velocity and acceleration
+        p = measurement;
+        v = 0;
+        a = 0;
+        p00 = r;
+        p01 = p02 = p12 = 0;
+        p11 = p22 = 1e4;
+        initialized = true;
+        HeelEstimate estimate = {p, v, a};
+        return estimate;
+    }
+
+    // (1) Predict one frame ahead with the constant acceleration model F = [1 1 1/2; 0 1 1; 0 0 1]
+    p = p + v + 0.5 * a;
+    v = v + a;
+    // Covariance F P F' + Q, with the rows of F P written out
+    double fp00 = p00 + p01 + 0.5 * p02, fp01 = p01 + p11 + 0.5 * p12, fp02 = p02 + p12 + 0.5 * p22;
+    double fp11 = p11 + p12, fp12 = p12 + p22;
+    double m00 = fp00 + fp01 + 0.5 * fp02 + q00;
+    double m01 = fp01 + fp02 + q01;
+    double m02 = fp02 + q02;
+    double m11 = fp11 + fp12 + q11;
+    double m12 = fp12 + q12;
+    double m22 = p22 + q22;
+
+    // (2) Update with the measured position (H = [1 0 0])
+    double s = m00 + r;
+    double k0 = m00 / s, k1 = m01 / s, k2 = m02 / s;
+    double residual = measurement - p;
+    p += k0 * residual;
+    v += k1 * residual;
+    a += k2 * residual;
+    // Covariance (I - K H) M
+    p00 = m00 - k0 * m00;
+    p01 = m01 - k0 * m01;
+    p02 = m02 - k0 * m02;
+    p11 = m11 - k1 * m01;
+    p12 = m12 - k1 * m02;
+    p22 = m22 - k2 * m02;
+
+    HeelEstimate estimate = {p, v, a};
+    return estimate;
+}
+
+// Public member function of HeelKalmanTracker class forgetting the past samples
+void HeelKalmanTracker::reset() {
+    initialized = false;
+    p = v = a = 0;
+    p00 = p01 = p02 = p11 = p12 = p22 = 0;
+}
+
+//---------------------------------------------------------------------------------
+// Latency Compensation Functions
+
+// Group delay of the second order Butterworth filter at low frequencies in frames
+// (the bilinear transform keeps the group delay of the analog filter at zero frequency)
+double ButterworthGroupDelayFrames(double cutoffFreq, double sampleFreq) {
+    return sqrt(2) / (2 * kPi * cutoffFreq) * sampleFreq;
+}
+
+// Constructor for LatencyCompensator class
+// Inputs: prediction model, prediction horizon in frames, gains of the alpha-beta tracker
+LatencyCompensator::LatencyCompensator(LatencyCompensation mode, double horizonFrames, double alpha, double beta) {
+    this->compensation = mode;      // set the prediction model
+    this->h = horizonFrames;        // set the prediction horizon
+    this->alpha = alpha;            // set the position gain of the alpha-beta tracker
+    this->beta = beta;              // set the velocity gain of the alpha-beta tracker
+    this->reset();
+}
+
+// Public member function of LatencyCompensator class responsible for predicting the signal "horizon" frames ahead
+// Input: new filtered sample of the signal
+// Output: predicted sample of the signal (the input itself until enough samples have been received)
+double LatencyCompensator::compensate(double input) {
+    double output = input;
+    switch (compensation) {
+        case LatencyCompensation::LINEAR:
+            // Line through the last two samples
+            if (num_samples >= 1) {
+                output = input + h * (input - x_n_minus_1);
+            }
+            break;
+        case LatencyCompensation::QUADRATIC:
+            // Parabola through the last three samples
+            if (num_samples >= 2) {
+                double slope = (3 * input - 4 * x_n_minus_1 + x_n_minus_2) / 2;
+                double curvature = (input - 2 * x_n_minus_1 + x_n_minus_2) / 2;
+                output = input + h * slope + h * h * curvature;
+            }
+            else if (num_samples == 1) {
+                output = input + h * (input - x_n_minus_1);
+            }
+            break;
+        case LatencyCompensation::ALPHA_BETA:
+            if (num_samples == 0) {
+                position = input;
+                velocity = 0;
+            }
+            else {
+                // Predict one frame ahead with the constant velocity model and correct with the residual
+                double predicted = position + velocity;
+                double residual = input - predicted;
+                position = predicted + alpha * residual;
+                velocity = velocity + beta * residual;
+            }
+            output = position + h * velocity;
+            break;
+        default:
+            return input;
+    }
+    x_n_minus_2 = x_n_minus_1;
+    x_n_minus_1 = input;
+    num_samples++;
+    return output;
+}
+
+// Public member function of LatencyCompensator class forgetting the past samples
+void LatencyCompensator::reset() {
+    num_samples = 0;
+    x_n_minus_1 = 0;
+    x_n_minus_2 = 0;
+    position = 0;
+    velocity = 0;
+}
+
+LatencyCompensation LatencyCompensator::mode() const {
+    return compensation;
+}
+
+double LatencyCompensator::horizon() const {
+    return h;
 }
 
 //---------------------------------------------------------------------------------
 // Foot Strike Detection Functions
 
 // Constructor for FootStrikeDetector class invoked automatically when a "FootStrikeDetector" object is created
-FootStrikeDetector::FootStrikeDetector() {
+// Inputs: time source of the foot-strike time stamps, sampling frequency (used by the frame clock)
+FootStrikeDetector::FootStrikeDetector(TimeSource timeSource, double sampleFreq, int durationWindow,
+                                       DurationEstimator durationEstimator, double ewmaAlpha)
+    : gait_cycle_duration_window(static_cast<size_t>(std::max(durationWindow, 1))) {
+    this->time_source = timeSource;                 // set the time source
+    this->Fs = sampleFreq;                          // set the sampling frequency
+    this->duration_estimator = durationEstimator;   // set the estimator of the gait cycle duration
+    this->ewma_alpha = ewmaAlpha;                   // set the weight of the newest gait cycle in the EWMA estimator
     // Initialize the variables of interest
     this->init();
 }
 
+// Constructor for FootStrikeDetector class with the parameters of the detection conditions
+// Inputs: parameters of the F-VESPA algorithm (e.g. kProsthesisFVespaParams), then the same inputs as the constructor above
+FootStrikeDetector::FootStrikeDetector(const FVespaParams& params, TimeSource timeSource, double sampleFreq, int durationWindow,
+                                       DurationEstimator durationEstimator, double ewmaAlpha)
+    : FootStrikeDetector(timeSource, sampleFreq, durationWindow, durationEstimator, ewmaAlpha) {
+    this->set_params(params);                       // set the parameters of the detection conditions
+}
+
 // Public member function of FootStrikeDetector class responsible for implementing the F-VESPA algorithm
 // Inputs: Vicon Nexus frame number, new filtered sample of the vertical and sagittal position of the heel marker (left or right)
 bool FootStrikeDetector::FVESPA(int frame,double heel_vert_new_f, double heel_sag_new_f){
+        if (!detect(frame, heel_vert_new_f, heel_sag_new_f)) {
+            return false;
+        }
 
-        // Calculate velocity of the heel marker in the vertical and sagittal directions
-        vel_z = heel_vert_new_f - heel_vert_filt_one_sample_ago;
-        vel_s = heel_sag_new_f - heel_sag_filt_one_sample_ago;
+        update_time_stamp(frame);
+        return true;
+}
 
-        // Set flag showing whether a foot-strike took place to false by default (will be set to true if a foot-strike is detected)
-        foot_strike_flag = false;
+// Public member function of FootStrikeDetector class responsible for implementing the F-VESPA algorithm
+// Inputs: Vicon Nexus frame number, new filtered sample of the vertical and sagittal position of the heel marker (left or right),
+// time stamp of the frame in seconds provided by the frame source
+bool FootStrikeDetector::FVESPA(int frame,double heel_vert_new_f, double heel_sag_new_f, double frame_time_stamp){
+        if (!detect(frame, heel_vert_new_f, heel_sag_new_f)) {
+            return false;
+        }
 
-        // Condition for detecting a foot-strike
-        // Necessary for Vicon F.S. and extra check that foot-strikes are not detected in swing phase
-        // if (vel_z>=-0.01 && vel_prev_1<=0 && vel_prev_2<=0 && vel_prev_3<=0 && search_flag == 0 && vel_s < 6.01 && heel_vert_new_f < 500){ //for prosthesis
-        if (vel_z>=0 && vel_prev_1<=0 && vel_prev_2<=0 && vel_prev_3<=0 && search_flag == true && vel_s<=0 && heel_vert_new_f<500){
-            
-            // Update the minimum value of the vertical position of the heel marker
-            min_heel = heel_vert_filt_one_sample_ago;
+        update_duration(frame_time_stamp);
+        return true;
+}
 
-            // Register the frame number of the foot-strike
-            last_hs_frame = frame-1;
+// Public member function of FootStrikeDetector class responsible for implementing the F-VESPA algorithm
+// Inputs: Vicon Nexus frame number, position and velocity of the vertical and sagittal coordinates of the heel marker
+// estimated by a HeelKalmanTracker
+bool FootStrikeDetector::FVESPA(int frame, const HeelEstimate& heel_vert, const HeelEstimate& heel_sag){
+        if (!detect(frame, heel_vert.position, heel_sag.position, heel_vert.velocity, heel_sag.velocity)) {
+            return false;
+        }
 
-            // Ensure the time stemp of the previous foot-strike is updated (necessary for fail-safe mechanism of the gait monitor)
-            time_stamp_hs_prev = time_stamp_hs;
-            // Calculate the time stamp of the foot-strike
+        update_time_stamp(frame);
+        return true;
+}
+
+// Public member function of FootStrikeDetector class responsible for implementing the F-VESPA algorithm
+// Inputs: Vicon Nexus frame number, position and velocity of the vertical and sagittal coordinates of the heel marker
+// estimated by a HeelKalmanTracker, time stamp of the frame in seconds provided by the frame source
+bool FootStrikeDetector::FVESPA(int frame, const HeelEstimate& heel_vert, const HeelEstimate& heel_sag, double frame_time_stamp){
+        if (!detect(frame, heel_vert.position, heel_sag.position, heel_vert.velocity, heel_sag.velocity)) {
+            return false;
+        }
+
+        update_duration(frame_time_stamp);
+        return true;
+}
+
+// Private member function of FootStrikeDetector class updating the time stamp of a new foot-strike from the time source of the detector
+void FootStrikeDetector::update_time_stamp(int frame){
+        if (time_source == TimeSource::FRAME_CLOCK) {
+            update_duration(frame / Fs);
+        }
+        else {
             auto current_time = chrono::high_resolution_clock::now();
-            time_stamp_hs = chrono::duration_cast<chrono::microseconds>(current_time.time_since_epoch()).count() / 1e6;
-            // Calculate the duration of the last gait cycle in seconds
-            new_duration = time_stamp_hs - time_stamp_hs_prev; 
+            update_duration(chrono::duration_cast<chrono::microseconds>(current_time.time_since_epoch()).count() / 1e6);
+        }
+}
 
-            // Update the rolling sum and gait_cycle_duration_vector elements
-            temp_sum = temp_sum - gait_cycle_duration_vector[0] + new_duration;
+// Public member function of FootStrikeDetector class selecting the latency-compensation stage of the filtered samples
+// Inputs: prediction model, prediction horizon in frames, gains of the alpha-beta tracker (only used by LatencyCompensation::ALPHA_BETA)
+void FootStrikeDetector::set_latency_compensation(LatencyCompensation mode, double horizonFrames, double alpha, double beta){
+        vert_compensator = LatencyCompensator(mode, horizonFrames, alpha, beta);
+        sag_compensator = LatencyCompensator(mode, horizonFrames, alpha, beta);
+}
 
-            // Use std::rotate to update gait_cycle_duration_vector
-            rotate(gait_cycle_duration_vector.begin(), gait_cycle_duration_vector.begin() + 1, gait_cycle_duration_vector.end());
-            gait_cycle_duration_vector[4] = new_duration;
+// Public member function of FootStrikeDetector class replacing the parameters of the detection conditions
+// Input: parameters of the F-VESPA algorithm (e.g. kProsthesisFVespaParams or tuned for a population with Sweep_FVESPA)
+bool FootStrikeDetector::set_params(const FVespaParams& params){
+        if (params.velocity_history < 1 || params.velocity_history > kMaxVelocityHistory) {
+            cerr << "Invalid F-VESPA velocity history " << params.velocity_history << " (must be between 1 and " << kMaxVelocityHistory << ")" << endl;
+            return false;
+        }
+        fvespa_params = params;
+        return true;
+}
 
-            // Calculate the average duration of the last five gait cycles
-            gait_cycle_duration = ( temp_sum )/5; 
-            // Update the time stamp of the previous foot-strike
-            time_stamp_hs_prev = time_stamp_hs;
+// Public member function of FootStrikeDetector class returning the parameters of the detection conditions
+const FVespaParams& FootStrikeDetector::params() const{
+        return fvespa_params;
+}
 
-            // Increase the counter of the gait cycles
-            gait_cycle = gait_cycle+1; 
+// Private member function of FootStrikeDetector class implementing the detection conditions of the F-VESPA algorithm
+// on the first differences of the filtered positions
+// Returns true if a foot-strike was detected (the time stamp and gait cycle duration are then updated by the caller)
+bool FootStrikeDetector::detect(int frame,double heel_vert_new_f, double heel_sag_new_f){
 
-            // // Print the frame number of the foot-strike
-            // cout << "Heel-strike at Frame: "<< frame-1 << endl;
-            
-            // Set the flag showing whether a foot-strike took place to true
-            foot_strike_flag = true;
+        // Predict the filtered positions ahead to compensate for the lag of the filter (unchanged without compensation)
+        heel_vert_new_f = vert_compensator.compensate(heel_vert_new_f);
+        heel_sag_new_f = sag_compensator.compensate(heel_sag_new_f);
 
-            // Set the search flag to false to avoid detecting a new foot-strike in the same gait cycle
-            search_flag = false;
-        }
-        else if (frame>2 && vel_z<0 && vel_prev_1<=0 && vel_prev_2>=0 && vel_prev_3>=0 && ((heel_vert_filt_two_samples_ago-min_heel)>100)){
-            // Condition for detecting the frame where the heel marker reaches its maximum vertical position
-            
-            // Enable the search for a new foot-strike (this avoid detecting a new foot-strike during swing phase)
-            search_flag = true;
-        }
+        // Calculate velocity of the heel marker in the vertical and sagittal directions
+        return detect(frame, heel_vert_new_f, heel_sag_new_f, heel_vert_new_f - heel_vert_filt_one_sample_ago,
+                      heel_sag_new_f - heel_sag_filt_one_sample_ago);
+}
 
-        // Update the previous velocity values
-        vel_prev_3 = vel_prev_2;
-        vel_prev_2 = vel_prev_1;
-        vel_prev_1 = vel_z;
+// Private member function of FootStrikeDetector class implementing the detection conditions of the F-VESPA algorithm
+// for given velocities of the heel marker in the vertical and sagittal directions, with the parameters of the detector
+bool FootStrikeDetector::detect(int frame,double heel_vert_new_f, double heel_sag_new_f, double heel_vert_vel, double heel_sag_vel){
+        return detect(fvespa_params, frame, heel_vert_new_f, heel_sag_new_f, heel_vert_vel, heel_sag_vel);
+}
 
-        // Update the previous filtered position values
-        heel_vert_filt_two_samples_ago = heel_vert_filt_one_sample_ago;
-        heel_vert_filt_one_sample_ago = heel_vert_new_f;
-        heel_sag_filt_one_sample_ago = heel_sag_new_f;
+// Private member function of FootStrikeDetector class updating the time stamp of the last foot-strike and the average gait cycle duration
+// Input: time stamp of the new foot-strike in seconds
+void FootStrikeDetector::update_duration(double new_time_stamp_hs){
+            // Ensure the time stemp of the previous foot-strike is updated (necessary for fail-safe mechanism of the gait monitor)
+            time_stamp_hs_prev = time_stamp_hs;
+            // Register the time stamp of the foot-strike
+            time_stamp_hs = new_time_stamp_hs;
+            // Calculate the duration of the last gait cycle in seconds
+            new_duration = time_stamp_hs - time_stamp_hs_prev; 
 
-        // Return the flag showing whether a foot-strike took place
-        return foot_strike_flag;
+            // Replace the oldest duration of the window (the rolling sum is updated in O(1), without allocations)
+            gait_cycle_duration_window.Push(new_duration);
+
+            // Estimate the gait cycle duration from the last gait cycles
+            switch (duration_estimator) {
+                case DurationEstimator::EWMA:
+                    // The first duration is measured from time zero and is not a gait cycle: the average starts at the second foot-strike
+                    if (gait_cycle == 3) {
+                        gait_cycle_duration = new_duration;
+                    }
+                    else if (gait_cycle > 3) {
+                        gait_cycle_duration = ewma_alpha * new_duration + (1 - ewma_alpha) * gait_cycle_duration;
+                    }
+                    break;
+                case DurationEstimator::MEDIAN:
+                    gait_cycle_duration = gait_cycle_duration_window.Median();
+                    break;
+                default:
+                    // Calculate the average duration of the last gait cycles
+                    gait_cycle_duration = gait_cycle_duration_window.Mean();
+                    break;
+            }
+            // Update the time stamp of the previous foot-strike
+            time_stamp_hs_prev = time_stamp_hs;
 }
 
 // Initialization function of FootStrikeDetector class
 void FootStrikeDetector::init() {
     min_heel = -1000;                           // initialize the minimum value of the vertical position of the heel marker to an non-realistic negative value
     search_flag = false;                        // initialize the search flag to false
-    vel_prev_1 = 0;                             // initialize the previous velocity values to zero
-    vel_prev_2 = 0;                             // initialize the previous velocity values to zero
-    vel_prev_3 = 0;                             // initialize the previous velocity values to zero
+    for (double& vel : vel_prev) vel = 0;       // initialize the previous velocity values to zero
     heel_vert_filt_one_sample_ago = 0;          // initialize the filtered position of the heel marker in the vertical direction one sample ago to zero
     heel_vert_filt_two_samples_ago = 0;         // initialize the filtered position of the heel marker in the vertical direction two samples ago to zero
     heel_sag_filt_one_sample_ago = 0;           // initialize the filtered position of the heel marker in the sagittal direction one sample ago to zero
-    temp_sum = 0;                               // initialize the rolling sum to zero
     new_duration = 0;                           // initialize the duration of the last gait cycle to zero
     last_hs_frame = 0;                          // initialize the frame number of the previous foot-strike to zero
     time_stamp_hs_prev = 0;                     // initialize the time stamp of the previous foot-strike to zero
+    time_stamp_hs = 0;                          // initialize the time stamp of the last foot-strike to zero
+    gait_cycle_duration = 0;                    // initialize the average duration of the gait cycles to zero
     gait_cycle = 1;                             // initialize the counter of the gait cycles to 1
-    gait_cycle_duration_vector = {0,0,0,0,0};   // initialize the vector storing the duration of the last five gait cycles with zeros
-}
\ No newline at end of file
+    gait_cycle_duration_window.Reset();         // initialize the durations of the last gait cycles with zeros
+}
+
+
+FootStrikeDetectorBank::FootStrikeDetectorBank(int numFeet) {
+    this->num_feet = numFeet;   // set the number of feet
+    // Initialize the variables of interest of all feet
+    this->init();
+}
+
+// Public member function of FootStrikeDetectorBank class responsible for implementing the F-VESPA algorithm for all feet
+// Inputs: Vicon Nexus frame number, new filtered sample of the vertical and sagittal position of every heel marker,
+// time stamp of the frame in seconds
+// Output: foot-strike flag of every foot (optional); returns the number of foot-strikes at this frame
+int FootStrikeDetectorBank::FVESPA(int frame, const double* heel_vert_new_f, const double* heel_sag_new_f, double frame_time_stamp, unsigned char* foot_strike) {
+    if (foot_strike == nullptr) {
+        foot_strike = foot_strike_flags.data();
+    }
+
+    // Restrict-qualified views of the state (the arrays never overlap)
+    double* __restrict search = search_flag.data();
+    double* __restrict min_h = min_heel.data();
+    double* __restrict v1 = vel_prev_1.data();
+    double* __restrict v2 = vel_prev_2.data();
+    double* __restrict v3 = vel_prev_3.data();
+    double* __restrict vert1 = heel_vert_filt_one_sample_ago.data();
+    double* __restrict vert2 = heel_vert_filt_two_samples_ago.data();
+    double* __restrict sag1 = heel_sag_filt_one_sample_ago.data();
+    double* __restrict hs_frame = last_hs_frame_.data();
+    double* __restrict gc = gait_cycle_.data();
+    double* __restrict gc_dur = gait_cycle_duration_.data();
+    double* __restrict ts_hs = time_stamp_hs_.data();
+    double* __restrict sum = temp_sum.data();
+    double* __restrict w0 = gait_cycle_duration_window[0].data();
+    double* __restrict w1 = gait_cycle_duration_window[1].data();
+    double* __restrict w2 = gait_cycle_duration_window[2].data();
+    double* __restrict w3 = gait_cycle_duration_window[3].data();
+    double* __restrict w4 = gait_cycle_duration_window[4].data();
+    const double* __restrict vert_in = heel_vert_new_f;
+    const double* __restrict sag_in = heel_sag_new_f;
+    unsigned char* __restrict strike_out = foot_strike;
+
+    const bool past_second_frame = frame > 2;
+    const double hs_frame_new = frame - 1;
+    int strikes = 0;
+    int i = 0;
+
+    // Same conditions and arithmetic as FootStrikeDetector::detect and FootStrikeDetector::update_duration,
+    // with every "if" replaced by a selection between the updated and the unchanged value
+#if defined(__AVX__)
+    const __m256d zero = _mm256_setzero_pd(), one = _mm256_set1_pd(1.0);
+    const __m256d v500 = _mm256_set1_pd(500.0), v100 = _mm256_set1_pd(100.0), window = _mm256_set1_pd(kDurationWindow);
+    const __m256d t_new = _mm256_set1_pd(frame_time_stamp), hs_new = _mm256_set1_pd(hs_frame_new);
+    const __m256d past_second = _mm256_castsi256_pd(_mm256_set1_epi64x(past_second_frame ? -1 : 0));
+    for (; i + 4 <= num_feet; i += 4) {
+        __m256d vert = _mm256_loadu_pd(vert_in + i), sag = _mm256_loadu_pd(sag_in + i);
+        __m256d vert_1 = _mm256_loadu_pd(vert1 + i);
+        __m256d p1 = _mm256_loadu_pd(v1 + i), p2 = _mm256_loadu_pd(v2 + i), p3 = _mm256_loadu_pd(v3 + i);
+        __m256d vel_z = _mm256_sub_pd(vert, vert_1);
+        __m256d vel_s = _mm256_sub_pd(sag, _mm256_loadu_pd(sag1 + i));
+        __m256d srch = _mm256_loadu_pd(search + i), minh = _mm256_loadu_pd(min_h + i);
+
+        // Condition for detecting a foot-strike, and for detecting the maximum vertical position of the heel marker
+        __m256d p1_le = _mm256_cmp_pd(p1, zero, _CMP_LE_OQ);
+        __m256d strike = _mm256_and_pd(_mm256_cmp_pd(vel_z, zero, _CMP_GE_OQ), p1_le);
+        strike = _mm256_and_pd(strike, _mm256_cmp_pd(p2, zero, _CMP_LE_OQ));
+        strike = _mm256_and_pd(strike, _mm256_cmp_pd(p3, zero, _CMP_LE_OQ));
+        strike = _mm256_and_pd(strike, _mm256_cmp_pd(srch, zero, _CMP_NEQ_OQ));
+        strike = _mm256_and_pd(strike, _mm256_cmp_pd(vel_s, zero, _CMP_LE_OQ));
+        strike = _mm256_and_pd(strike, _mm256_cmp_pd(vert, v500, _CMP_LT_OQ));
+        __m256d apex = _mm256_and_pd(past_second, _mm256_cmp_pd(vel_z, zero, _CMP_LT_OQ));
+        apex = _mm256_and_pd(apex, p1_le);
+        apex = _mm256_and_pd(apex, _mm256_cmp_pd(p2, zero, _CMP_GE_OQ));
+        apex = _mm256_and_pd(apex, _mm256_cmp_pd(p3, zero, _CMP_GE_OQ));
+        apex = _mm256_and_pd(apex, _mm256_cmp_pd(_mm256_sub_pd(_mm256_loadu_pd(vert2 + i), minh), v100, _CMP_GT_OQ));
+
+        _mm256_storeu_pd(search + i, _mm256_blendv_pd(_mm256_blendv_pd(srch, one, apex), zero, strike));
+        _mm256_storeu_pd(min_h + i, _mm256_blendv_pd(minh, vert_1, strike));
+        _mm256_storeu_pd(hs_frame + i, _mm256_blendv_pd(_mm256_loadu_pd(hs_frame + i), hs_new, strike));
+        _mm256_storeu_pd(gc + i, _mm256_add_pd(_mm256_loadu_pd(gc + i), _mm256_and_pd(strike, one)));
+
+        // Time stamp, duration window and average duration of the gait cycles
+        __m256d ts_prev = _mm256_loadu_pd(ts_hs + i);
+        __m256d new_duration = _mm256_sub_pd(t_new, ts_prev);
+        __m256d d0 = _mm256_loadu_pd(w0 + i), d1 = _mm256_loadu_pd(w1 + i), d2 = _mm256_loadu_pd(w2 + i);
+        __m256d d3 = _mm256_loadu_pd(w3 + i), d4 = _mm256_loadu_pd(w4 + i);
+        __m256d new_sum = _mm256_add_pd(_mm256_sub_pd(_mm256_loadu_pd(sum + i), d0), new_duration);
+        _mm256_storeu_pd(ts_hs + i, _mm256_blendv_pd(ts_prev, t_new, strike));
+        _mm256_storeu_pd(sum + i, _mm256_blendv_pd(_mm256_loadu_pd(sum + i), new_sum, strike));
+        _mm256_storeu_pd(gc_dur + i, _mm256_blendv_pd(_mm256_loadu_pd(gc_dur + i), _mm256_div_pd(new_sum, window), strike));
+        _mm256_storeu_pd(w0 + i, _mm256_blendv_pd(d0, d1, strike));
+        _mm256_storeu_pd(w1 + i, _mm256_blendv_pd(d1, d2, strike));
+        _mm256_storeu_pd(w2 + i, _mm256_blendv_pd(d2, d3, strike));
+        _mm256_storeu_pd(w3 + i, _mm256_blendv_pd(d3, d4, strike));
+        _mm256_storeu_pd(w4 + i, _mm256_blendv_pd(d4, new_duration, strike));
+
+        // Update the previous velocity and filtered position values
+        _mm256_storeu_pd(v3 + i, p2);
+        _mm256_storeu_pd(v2 + i, p1);
+        _mm256_storeu_pd(v1 + i, vel_z);
+        _mm256_storeu_pd(vert2 + i, vert_1);
+        _mm256_storeu_pd(vert1 + i, vert);
+        _mm256_storeu_pd(sag1 + i, sag);
+
+        int mask = _mm256_movemask_pd(strike);
+        strike_out[i] = mask & 1;
+        strike_out[i + 1] = (mask >> 1) & 1;
+        strike_out[i + 2] = (mask >> 2) & 1;
+        strike_out[i + 3] = (mask >> 3) & 1;
+        strikes += (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const float64x2_t zero = vdupq_n_f64(0.0), one = vdupq_n_f64(1.0);
+    const float64x2_t v500 = vdupq_n_f64(500.0), v100 = vdupq_n_f64(100.0), window = vdupq_n_f64(kDurationWindow);
+    const float64x2_t t_new = vdupq_n_f64(frame_time_stamp), hs_new = vdupq_n_f64(hs_frame_new);
+    const uint64x2_t past_second = vdupq_n_u64(past_second_frame ? ~0ull : 0ull);
+    for (; i + 2 <= num_feet; i += 2) {
+        float64x2_t vert = vld1q_f64(vert_in + i), sag = vld1q_f64(sag_in + i);
+        float64x2_t vert_1 = vld1q_f64(vert1 + i);
+        float64x2_t p1 = vld1q_f64(v1 + i), p2 = vld1q_f64(v2 + i), p3 = vld1q_f64(v3 + i);
+        float64x2_t vel_z = vsubq_f64(vert, vert_1);
+        float64x2_t vel_s = vsubq_f64(sag, vld1q_f64(sag1 + i));
+        float64x2_t srch = vld1q_f64(search + i), minh = vld1q_f64(min_h + i);
+
+        // Condition for detecting a foot-strike, and for detecting the maximum vertical position of the heel marker
+        uint64x2_t p1_le = vcleq_f64(p1, zero);
+        uint64x2_t strike = vandq_u64(vcgeq_f64(vel_z, zero), p1_le);
+        strike = vandq_u64(strike, vcleq_f64(p2, zero));
+        strike = vandq_u64(strike, vcleq_f64(p3, zero));
+        strike = vandq_u64(strike, vreinterpretq_u64_u32(vmvnq_u32(vreinterpretq_u32_u64(vceqq_f64(srch, zero)))));
+        strike = vandq_u64(strike, vcleq_f64(vel_s, zero));
+        strike = vandq_u64(strike, vcltq_f64(vert, v500));
+        uint64x2_t apex = vandq_u64(past_second, vcltq_f64(vel_z, zero));
+        apex = vandq_u64(apex, p1_le);
+        apex = vandq_u64(apex, vcgeq_f64(p2, zero));
+        apex = vandq_u64(apex, vcgeq_f64(p3, zero));
+        apex = vandq_u64(apex, vcgtq_f64(vsubq_f64(vld1q_f64(vert2 + i), minh), v100));
+
+        vst1q_f64(search + i, vbslq_f64(strike, zero, vbslq_f64(apex, one, srch)));
+        vst1q_f64(min_h + i, vbslq_f64(strike, vert_1, minh));
+        vst1q_f64(hs_frame + i, vbslq_f64(strike, hs_new, vld1q_f64(hs_frame + i)));
+        vst1q_f64(gc + i, vaddq_f64(vld1q_f64(gc + i), vbslq_f64(strike, one, zero)));
+
+        // Time stamp, duration window and average duration of the gait cycles
+        float64x2_t ts_prev = vld1q_f64(ts_hs + i);
+        float64x2_t new_duration = vsubq_f64(t_new, ts_prev);
+        float64x2_t d0 = vld1q_f64(w0 + i), d1 = vld1q_f64(w1 + i), d2 = vld1q_f64(w2 + i);
+        float64x2_t d3 = vld1q_f64(w3 + i), d4 = vld1q_f64(w4 + i);
+        float64x2_t new_sum = vaddq_f64(vsubq_f64(vld1q_f64(sum + i), d0), new_duration);
+        vst1q_f64(ts_hs + i, vbslq_f64(strike, t_new, ts_prev));
+        vst1q_f64(sum + i, vbslq_f64(strike, new_sum, vld1q_f64(sum + i)));
+        vst1q_f64(gc_dur + i, vbslq_f64(strike, vdivq_f64(new_sum, window), vld1q_f64(gc_dur + i)));
+        vst1q_f64(w0 + i, vbslq_f64(strike, d1, d0));
+        vst1q_f64(w1 + i, vbslq_f64(strike, d2, d1));
+        vst1q_f64(w2 + i, vbslq_f64(strike, d3, d2));
+        vst1q_f64(w3 + i, vbslq_f64(strike, d4, d3));
+        vst1q_f64(w4 + i, vbslq_f64(strike, new_duration, d4));
+
+        // Update the previous velocity and filtered position values
+        vst1q_f64(v3 + i, p2);
+        vst1q_f64(v2 + i, p1);
+        vst1q_f64(v1 + i, vel_z);
+        vst1q_f64(vert2 + i, vert_1);
+        vst1q_f64(vert1 + i, vert);
+        vst1q_f64(sag1 + i, sag);
+
+        unsigned char s0 = static_cast<unsigned char>(vgetq_lane_u64(strike, 0) & 1);
+        unsigned char s1 = static_cast<unsigned char>(vgetq_lane_u64(strike, 1) & 1);
+        strike_out[i] = s0;
+        strike_out[i + 1] = s1;
+        strikes += s0 + s1;
+    }
+#endif
+    // Remaining feet (all feet without AVX/NEON)
+    for (; i < num_feet; i++) {
+        double vert = vert_in[i];
+        double sag = sag_in[i];
+        double vert_1 = vert1[i];
+        double p1 = v1[i], p2 = v2[i], p3 = v3[i];
+        double vel_z = vert - vert_1;
+        double vel_s = sag - sag1[i];
+
+        // Condition for detecting a foot-strike, and for detecting the maximum vertical position of the heel marker
+        bool strike = (vel_z >= 0) & (p1 <= 0) & (p2 <= 0) & (p3 <= 0) & (search[i] != 0) & (vel_s <= 0) & (vert < 500);
+        bool apex = past_second_frame & (vel_z < 0) & (p1 <= 0) & (p2 >= 0) & (p3 >= 0) & ((vert2[i] - min_h[i]) > 100);
+
+        search[i] = strike ? 0.0 : (apex ? 1.0 : search[i]);
+        min_h[i] = strike ? vert_1 : min_h[i];
+        hs_frame[i] = strike ? hs_frame_new : hs_frame[i];
+        gc[i] = gc[i] + (strike ? 1.0 : 0.0);
+
+        // Time stamp, duration window and average duration of the gait cycles
+        double ts_prev = ts_hs[i];
+        double new_duration = frame_time_stamp - ts_prev;
+        double new_sum = sum[i] - w0[i] + new_duration;
+        double d1 = w1[i], d2 = w2[i], d3 = w3[i], d4 = w4[i];
+        ts_hs[i] = strike ? frame_time_stamp : ts_prev;
+        sum[i] = strike ? new_sum : sum[i];
+        gc_dur[i] = strike ? new_sum / kDurationWindow : gc_dur[i];
+        w0[i] = strike ? d1 : w0[i];
+        w1[i] = strike ? d2 : d1;
+        w2[i] = strike ? d3 : d2;
+        w3[i] = strike ? d4 : d3;
+        w4[i] = strike ? new_duration : d4;
+
+        // Update the previous velocity and filtered position values
+        v3[i] = p2;
+        v2[i] = p1;
+        v1[i] = vel_z;
+        vert2[i] = vert_1;
+        vert1[i] = vert;
+        sag1[i] = sag;
+
+        strike_out[i] = strike;
+        strikes += strike;
+    }
+    return strikes;
+}
+
+int FootStrikeDetectorBank::feet() const {
+    return num_feet;
+}
+
+int FootStrikeDetectorBank::last_hs_frame(int foot) const {
+    return static_cast<int>(last_hs_frame_[foot]);
+}
+
+int FootStrikeDetectorBank::gait_cycle(int foot) const {
+    return static_cast<int>(gait_cycle_[foot]);
+}
+
+double FootStrikeDetectorBank::gait_cycle_duration(int foot) const {
+    return gait_cycle_duration_[foot];
+}
+
+double FootStrikeDetectorBank::time_stamp_hs(int foot) const {
+    return time_stamp_hs_[foot];
+}
+
+// Initialization function of FootStrikeDetectorBank class (same initial values as FootStrikeDetector::init)
+void FootStrikeDetectorBank::init() {
+    min_heel.assign(num_feet, -1000);
+    search_flag.assign(num_feet, 0);
+    vel_prev_1.assign(num_feet, 0);
+    vel_prev_2.assign(num_feet, 0);
+    vel_prev_3.assign(num_feet, 0);
+    heel_vert_filt_one_sample_ago.assign(num_feet, 0);
+    heel_vert_filt_two_samples_ago.assign(num_feet, 0);
+    heel_sag_filt_one_sample_ago.assign(num_feet, 0);
+    temp_sum.assign(num_feet, 0);
+    last_hs_frame_.assign(num_feet, 0);
+    time_stamp_hs_.assign(num_feet, 0);
+    gait_cycle_duration_.assign(num_feet, 0);
+    gait_cycle_.assign(num_feet, 1);
+    for (int k = 0; k < kDurationWindow; k++) {
+        gait_cycle_duration_window[k].assign(num_feet, 0);
+    }
+    foot_strike_flags.assign(num_feet, 0);
+}
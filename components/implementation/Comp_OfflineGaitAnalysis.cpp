@@ -0,0 +1,77 @@
+// Definition and analysis of the offline gait analysis functions
+
+#include "components/Comp_OfflineGaitAnalysis.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+using namespace std;
+
+// Zero-phase filter several channels in parallel
+// Inputs: cutoff and sampling frequency of the Butterworth filter, arrays of the n samples of every channel,
+// number of channels, number of samples n, maximum number of threads (0: one per hardware thread)
+// Output: arrays of the n zero-phase filtered samples of every channel
+void FiltFiltChannels(double cutoffFreq, double sampleFreq, const double* const* inputs, double* const* outputs,
+                      int numChannels, size_t n, int numThreads) {
+    const ButterworthFilter filter(cutoffFreq, sampleFreq);
+    if (numThreads <= 0) {
+        numThreads = std::max(1, static_cast<int>(thread::hardware_concurrency()));
+    }
+    numThreads = std::min(numThreads, numChannels);
+
+    // Every worker takes the next channel that has not been filtered yet, so long and short trials balance out
+    atomic<int> next_channel(0);
+    auto worker = [&]() {
+        for (int channel = next_channel++; channel < numChannels; channel = next_channel++) {
+            filter.filtfilt(inputs[channel], outputs[channel], n);
+        }
+    };
+    vector<thread> workers;
+    for (int t = 1; t < numThreads; t++) {
+        workers.emplace_back(worker);
+    }
+    worker();   // the calling thread filters channels too
+    for (thread& t : workers) {
+        t.join();
+    }
+}
+
+// Offline F-VESPA algorithm on a whole recorded trial
+// Inputs: frame numbers, raw vertical and sagittal positions of the heel marker (n samples each), number of samples n,
+// cutoff and sampling frequency of the Butterworth filter
+// Output: frame numbers of the detected foot-strikes
+vector<int> OfflineFVESPA(const int* frames, const double* heel_vert, const double* heel_sag, size_t n,
+                          double cutoffFreq, double sampleFreq) {
+    // (1) Zero-phase filter both coordinates (in parallel)
+    vector<double> vert_f(n), sag_f(n);
+    const double* inputs[2] = {heel_vert, heel_sag};
+    double* outputs[2] = {vert_f.data(), sag_f.data()};
+    FiltFiltChannels(cutoffFreq, sampleFreq, inputs, outputs, 2, n);
+
+    // (2) Run the detection conditions of F-VESPA frame by frame
+    FootStrikeDetector detector(TimeSource::FRAME_CLOCK, sampleFreq);
+    vector<int> foot_strikes;
+    for (size_t i = 0; i < n; i++) {
+        if (detector.FVESPA(frames[i], vert_f[i], sag_f[i])) {
+            foot_strikes.push_back(detector.last_hs_frame);
+        }
+    }
+    return foot_strikes;
+}
+
+// Expand foot-strike frames to the "last foot-strike frame" column of a trial
+// Inputs: frame numbers (n samples), number of samples n, foot-strike frames in order, value before the first foot-strike
+// Output: last foot-strike frame before every frame
+vector<int> LastFootStrikeColumn(const int* frames, size_t n, const vector<int>& foot_strikes, int initial) {
+    vector<int> column(n);
+    int last_foot_strike = initial;
+    size_t next = 0;
+    for (size_t i = 0; i < n; i++) {
+        while (next < foot_strikes.size() && foot_strikes[next] < frames[i]) {
+            last_foot_strike = foot_strikes[next];
+            next++;
+        }
+        column[i] = last_foot_strike;
+    }
+    return column;
+}
@@ -0,0 +1,300 @@
+// Definition and analysis of the member functions of the ViconHandler class
+
+#include "components/Comp_ViconHandler.h"
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+using namespace ViconDataStreamSDK::CPP;
+
+// Names of the wanted markers (indexed by ViconMarker)
+static const char* const kMarkerNames[] = {"RHEE", "LHEE", "RTOE", "LTOE"};
+
+// Fields of the x, y and z coordinates of the wanted markers in MarkerFrame (indexed by ViconMarker)
+static double MarkerFrame::* const kMarkerFields[][3] = {
+    {&MarkerFrame::RHEEx, &MarkerFrame::RHEEy, &MarkerFrame::RHEEz},
+    {&MarkerFrame::LHEEx, &MarkerFrame::LHEEy, &MarkerFrame::LHEEz},
+    {&MarkerFrame::RTOEx, &MarkerFrame::RTOEy, &MarkerFrame::RTOEz},
+    {&MarkerFrame::LTOEx, &MarkerFrame::LTOEy, &MarkerFrame::LTOEz}
+};
+
+// Constructor for ViconHandler class
+// Input: connected Vicon DataStream client
+ViconHandler::ViconHandler(Client& client) : client(client), arrival_intervals(0.25) {
+    // Initialize the cached names and the timing
+    this->init();
+}
+
+// Public member function of ViconHandler class responsible for getting the next frame from the DataStream
+// Input: longest time to wait for a frame in milliseconds
+// Returns true when a frame arrived (its markers are then read with ReadFrame), false after the timeout
+bool ViconHandler::WaitForFrame(int timeoutMs) {
+    auto start = chrono::steady_clock::now();
+    int failures = 0, backoff_ms = 1;
+    // In ServerPush and ClientPullPreFetch mode GetFrame blocks until the next frame arrives; a failure (e.g. no
+    // connection yet) is retried at once a few times, then with sleeps doubling up to kMaxBackoffMs
+    while (client.GetFrame().Result != Result::Success) {
+        ingest_stats.failed_gets++;
+        arrival_valid = false;
+        if (chrono::steady_clock::now() - start >= chrono::milliseconds(timeoutMs)) {
+            return false;
+        }
+        if (++failures <= kImmediateRetries) {
+            continue;
+        }
+        ingest_stats.backoffs++;
+        this_thread::sleep_for(chrono::milliseconds(backoff_ms));
+        backoff_ms = (backoff_ms * 2 > kMaxBackoffMs) ? kMaxBackoffMs : backoff_ms * 2;
+    }
+
+    // Interval between the arrivals of this frame and the previous one
+    auto arrival = chrono::steady_clock::now();
+    if (has_previous_arrival) {
+        arrival_intervals.Add(chrono::duration<double, milli>(arrival - last_arrival).count());
+    }
+    last_arrival = arrival;
+    has_previous_arrival = true;
+    arrival_valid = true;
+    return true;
+}
+
+// Public member function of ViconHandler class setting the latency budget of the frames
+// Input: largest acceptable latency of a frame in seconds (0 disables the alarm)
+void ViconHandler::set_latency_budget(double budgetSeconds) {
+    latency_budget = budgetSeconds;
+}
+
+// Public member function of ViconHandler class responsible for reading the wanted markers of the current frame
+// Output: marker coordinates and frame number of the current frame; returns false if a wanted marker was missing
+bool ViconHandler::ReadFrame(MarkerFrame& frame) {
+    auto start = chrono::steady_clock::now();
+
+    // Scan the subjects again when their number changed or a cached marker could no longer be read; while a wanted
+    // marker is not found at all, scan again at a low rate only
+    unsigned int current_subject_count = client.GetSubjectCount().SubjectCount;
+    bool all_found = found[0] && found[1] && found[2] && found[3];
+    if (current_subject_count != subject_count || stale || (!all_found && ++frames_since_resolve >= kResolveRetryFrames)) {
+        resolve();
+    }
+
+    // Fetch the wanted markers by their cached names (the SDK strings only point to the cached names)
+    bool complete = true;
+    for (int m = 0; m < kNumMarkers; m++) {
+        if (!found[m]) {
+            ingest_stats.missing++;
+            complete = false;
+            continue;
+        }
+        Output_GetMarkerGlobalTranslation translation = client.GetMarkerGlobalTranslation(subject_names[m], marker_names[m]);
+        if (translation.Result != Result::Success) {
+            ingest_stats.missing++;
+            complete = false;
+            stale = true;
+            continue;
+        }
+        ingest_stats.occluded += translation.Occluded;
+        store(static_cast<ViconMarker>(m), translation.Translation, frame);
+    }
+
+    finish_frame(frame, start);
+    return complete;
+}
+
+// Public member function of ViconHandler class reading the wanted markers of the current frame with the original scan
+// of every subject and marker by name (the reference for the ingest time of ReadFrame)
+// Output: marker coordinates and frame number of the current frame; returns false if a wanted marker was missing
+bool ViconHandler::ScanFrame(MarkerFrame& frame) {
+    auto start = chrono::steady_clock::now();
+
+    bool seen[kNumMarkers] = {false, false, false, false};
+    unsigned int current_subject_count = client.GetSubjectCount().SubjectCount;
+    for (unsigned int subject_index = 0; subject_index < current_subject_count; ++subject_index) {
+        std::string subject_name = client.GetSubjectName(subject_index).SubjectName;
+        unsigned int marker_count = client.GetMarkerCount(subject_name).MarkerCount;
+        for (unsigned int marker_index = 0; marker_index < marker_count; ++marker_index) {
+            std::string marker_name = client.GetMarkerName(subject_name, marker_index).MarkerName;
+            std::string marker_parent_name = client.GetMarkerParentName(subject_name, marker_name).SegmentName;
+            Output_GetMarkerGlobalTranslation translation = client.GetMarkerGlobalTranslation(subject_name, marker_name);
+            for (int m = 0; m < kNumMarkers; m++) {
+                if (marker_name == kMarkerNames[m]) {
+                    store(static_cast<ViconMarker>(m), translation.Translation, frame);
+                    ingest_stats.occluded += translation.Occluded;
+                    seen[m] = true;
+                }
+            }
+        }
+    }
+
+    bool complete = true;
+    for (int m = 0; m < kNumMarkers; m++) {
+        if (!seen[m]) {
+            ingest_stats.missing++;
+            complete = false;
+        }
+    }
+    finish_frame(frame, start);
+    return complete;
+}
+
+// Public member function of ViconHandler class scanning the subjects and markers for the wanted marker names
+// Returns true if all wanted markers were found (if several subjects have a wanted marker, the last one is used, as
+// the original scan does)
+bool ViconHandler::resolve() {
+    for (int m = 0; m < kNumMarkers; m++) {
+        found[m] = false;
+    }
+    subject_count = client.GetSubjectCount().SubjectCount;
+    for (unsigned int subject_index = 0; subject_index < subject_count; ++subject_index) {
+        std::string subject_name = client.GetSubjectName(subject_index).SubjectName;
+        unsigned int marker_count = client.GetMarkerCount(subject_name).MarkerCount;
+        for (unsigned int marker_index = 0; marker_index < marker_count; ++marker_index) {
+            std::string marker_name = client.GetMarkerName(subject_name, marker_index).MarkerName;
+            for (int m = 0; m < kNumMarkers; m++) {
+                if (marker_name == kMarkerNames[m]) {
+                    subject_names[m] = subject_name;
+                    marker_names[m] = marker_name;
+                    found[m] = true;
+                }
+            }
+        }
+    }
+    stale = false;
+    frames_since_resolve = 0;
+    ingest_stats.resolutions++;
+    return found[0] && found[1] && found[2] && found[3];
+}
+
+// Public member function of ViconHandler class returning the timing of the ingest
+const ViconIngestStats& ViconHandler::stats() const {
+    return ingest_stats;
+}
+
+// Public member function of ViconHandler class returning the histogram of the intervals between the arrivals of the frames [ms]
+const ViconArrivalHistogram& ViconHandler::arrival_histogram() const {
+    return arrival_intervals;
+}
+
+// Public member function of ViconHandler class returning whether a wanted marker was found by the last scan
+bool ViconHandler::resolved(ViconMarker marker) const {
+    return found[static_cast<int>(marker)];
+}
+
+// Public member function of ViconHandler class returning the subject of a wanted marker found by the last scan
+const std::string& ViconHandler::subject_name(ViconMarker marker) const {
+    return subject_names[static_cast<int>(marker)];
+}
+
+// Private member function of ViconHandler class copying the coordinates of a marker to its fields of the marker frame
+void ViconHandler::store(ViconMarker marker, const double translation[3], MarkerFrame& frame) const {
+    for (int axis = 0; axis < 3; axis++) {
+        frame.*kMarkerFields[static_cast<int>(marker)][axis] = translation[axis];
+    }
+}
+
+// Private member function of ViconHandler class completing a frame read by ReadFrame or ScanFrame: frame number, latency
+// and latency alarm, ingest time
+// Inputs: marker frame, time at which the reading of the markers started
+void ViconHandler::finish_frame(MarkerFrame& frame, chrono::steady_clock::time_point start) {
+    unsigned int frame_number = client.GetFrameNumber().FrameNumber;
+    if (last_frame_number != 0 && frame_number > last_frame_number + 1) {
+        ingest_stats.dropped_frames += frame_number - last_frame_number - 1;
+    }
+    last_frame_number = frame_number;
+    frame.frame = frame_number;
+
+    // Latency of the frame: latency reported by the SDK (from the camera exposure to the arrival of the frame) plus
+    // the time spent since its arrival (or since the start of the reading if the frame was not got by WaitForFrame)
+    Output_GetLatencyTotal sdk_latency = client.GetLatencyTotal();
+    frame.vicon_latency = (sdk_latency.Result == Result::Success) ? sdk_latency.Total : 0;
+    auto end = chrono::steady_clock::now();
+    double local_latency = chrono::duration<double>(end - (arrival_valid ? last_arrival : start)).count();
+    double latency = frame.vicon_latency + local_latency;
+    ingest_stats.last_latency_s = latency;
+    if (latency > ingest_stats.max_latency_s) {
+        ingest_stats.max_latency_s = latency;
+    }
+    bool over = latency_budget > 0 && latency > latency_budget;
+    if (over) {
+        ingest_stats.latency_alarms++;
+        if (!over_budget) {
+            cerr << "Latency budget exceeded at frame " << frame_number << ": " << latency * 1000 << " ms > "
+                 << latency_budget * 1000 << " ms" << endl;
+        }
+    }
+    over_budget = over;
+    arrival_valid = false;
+
+    record_time(chrono::duration<double, micro>(end - start).count());
+}
+
+// Private member function of ViconHandler class adding the ingest time of a frame to the statistics
+void ViconHandler::record_time(double elapsed_us) {
+    ingest_stats.frames++;
+    ingest_stats.last_us = elapsed_us;
+    ingest_stats.total_us += elapsed_us;
+    if (elapsed_us > ingest_stats.max_us) {
+        ingest_stats.max_us = elapsed_us;
+    }
+}
+
+// Initialization function of ViconHandler class
+void ViconHandler::init() {
+    for (int m = 0; m < kNumMarkers; m++) {
+        found[m] = false;                       // no marker has been found before the first scan
+    }
+    subject_count = ~0u;                        // force a scan at the first frame
+    stale = true;
+    frames_since_resolve = 0;
+    ingest_stats = ViconIngestStats();
+    arrival_intervals.Reset();
+    arrival_valid = false;                      // no frame has been got by WaitForFrame yet
+    has_previous_arrival = false;
+    last_frame_number = 0;
+    latency_budget = 0.020;                     // default latency budget: two frames at 100 Hz
+    over_budget = false;
+}
+
+
+// Constructor for ViconFrameSource class
+// Input: connected Vicon DataStream client
+ViconFrameSource::ViconFrameSource(Client& client) : client(client), marker_handler(client), last_frame() {
+}
+
+// Public member function of ViconFrameSource class responsible for reading the next frame streamed by Vicon Nexus
+// Inputs: array receiving the frame, its capacity, longest time to wait for the frame in milliseconds
+// Returns 1 if a frame was read, 0 after the timeout
+size_t ViconFrameSource::Read(MarkerFrame* frames, size_t maxFrames, int timeoutMs) {
+    if (maxFrames == 0 || !marker_handler.WaitForFrame(timeoutMs)) {
+        return 0;
+    }
+    marker_handler.ReadFrame(last_frame);
+    frames[0] = last_frame;
+    return 1;
+}
+
+// Public member function of ViconFrameSource class returning whether the client was disconnected
+bool ViconFrameSource::Finished() const {
+    return !client.IsConnected().Connected;
+}
+
+// Public member function of ViconFrameSource class returning the frame rate of the stream (100 Hz until it is known)
+double ViconFrameSource::SampleRate() const {
+    Output_GetFrameRate rate = client.GetFrameRate();
+    return (rate.Result == Result::Success && rate.FrameRateHz > 0) ? rate.FrameRateHz : 100;
+}
+
+// Public member function of ViconFrameSource class returning the frame numbers skipped by the stream
+unsigned long long ViconFrameSource::Dropped() const {
+    return marker_handler.stats().dropped_frames;
+}
+
+// Public member function of ViconFrameSource class describing the source
+std::string ViconFrameSource::Describe() const {
+    return "Vicon DataStream";
+}
+
+// Public member function of ViconFrameSource class returning the marker reader (ingest statistics, latency budget)
+ViconHandler& ViconFrameSource::handler() {
+    return marker_handler;
+}
@@ -0,0 +1,228 @@
+#pragma once // Ensure inclusion only once
+
+#include "SharedMemStruct.h"
+#include <cmath>
+#include <cstdint>
+
+/*  Generator of synthetic heel and toe marker trajectories of both feet, with the ground-truth foot-strike frames, for
+*   benchmarks and accuracy tests at any scale (capture rates up to kHz, many subjects, pathological gait) that the one
+*   recorded trial cannot cover. The trajectories follow the shape of the recorded healthy trial: during stance the heel
+*   rests at the ground height and moves backwards with the treadmill belt; after heel-off it rises to its swing apex
+*   and descends smoothly (zero vertical velocity) onto the ground at the foot-strike, while it moves forwards.
+*
+*   Every gait cycle of the left foot draws its duration from a normal distribution (mean cycle_seconds, relative
+*   standard deviation cycle_variability); the right foot repeats the same sequence of durations, so each of its
+*   foot-strikes follows a left foot-strike by (0.5 + step_asymmetry) mean gait cycles. Gaussian noise is added to every
+*   coordinate, and a marker can drop out for a few frames, during which all its coordinates are 0 (as the Vicon
+*   DataStream reports occluded markers).
+*
+*   The generator does not allocate memory and uses a xorshift random number generator and a sum-of-uniforms normal
+*   approximation, so it produces several million frames per second.
+*/
+
+// Bits of the ground truth returned by GaitGenerator::Next: a foot-strike of the foot happened in the frame
+const int kGaitLeftStrike = 1;
+const int kGaitRightStrike = 2;
+
+struct GaitGeneratorParams {
+    double sample_rate = 100;           // [Hz] Capture rate
+    double cycle_seconds = 1.1;         // [s] Mean gait cycle duration
+    double cycle_variability = 0;       // Standard deviation of the gait cycle durations relative to their mean (e.g. 0.03)
+    double noise_mm = 0.1;              // [mm] Standard deviation of the noise added to every coordinate
+    double dropout_rate = 0;            // Probability per frame and marker that a marker drops out
+    int dropout_frames = 5;             // Length of a dropout [frames]
+    double step_asymmetry = 0;          // Delay of the right foot-strikes past half a gait cycle [gait cycles]
+    double right_swing_scale = 1;       // Swing height of the right foot relative to the left foot (e.g. 0.5: reduced clearance)
+    double ground_height_mm = 450;      // [mm] Vertical position of the heel marker during stance
+    double swing_height_mm = 215;       // [mm] Rise of the heel marker at the swing apex
+    double stride_mm = 560;             // [mm] Sagittal excursion of the heel marker during a gait cycle
+    double heel_off = 0.42;             // Gait cycle fraction at which the heel leaves the ground
+    double toe_off = 0.58;              // Gait cycle fraction at which the toe leaves the ground (end of the stance)
+    double swing_apex = 0.70;           // Gait cycle fraction of the highest heel position
+    unsigned int seed = 1;              // Seed of the random numbers (noise, cycle durations, dropouts)
+};
+
+class GaitGenerator {
+public:
+    explicit GaitGenerator(const GaitGeneratorParams& params = GaitGeneratorParams()) : params_(params) {
+        Reset();
+    }
+
+    // Restart at frame 1 with the initial random numbers
+    void Reset() {
+        frame_ = 0;
+        noise_state_ = Seed(params_.seed, 1);
+        const double mean = params_.cycle_seconds;
+        // The trajectories start in the stance of the left foot, 0.2 gait cycles after a foot-strike; the right foot
+        // starts in the swing of its previous gait cycle, whose duration is the mean as well
+        feet_[0].cycle_start = -0.2 * mean;
+        feet_[0].cycle_duration = mean;
+        feet_[0].mean_cycles = 0;
+        feet_[0].duration_state = Seed(params_.seed, 2);
+        feet_[1].cycle_start = feet_[0].cycle_start + (0.5 + params_.step_asymmetry) * mean - mean;
+        feet_[1].cycle_duration = mean;
+        feet_[1].mean_cycles = 1;                               // the next gait cycle matches the first left gait cycle
+        feet_[1].duration_state = Seed(params_.seed, 2);        // same sequence of durations as the left foot
+        for (int foot = 0; foot < 2; foot++) {
+            feet_[foot].swing_height = params_.swing_height_mm * (foot == 1 ? params_.right_swing_scale : 1);
+            feet_[foot].lateral = foot == 0 ? -100 : 100;
+            feet_[foot].dropout[0] = feet_[foot].dropout[1] = 0;
+        }
+    }
+
+    // Generate the next frame. Returns the ground truth of the frame: kGaitLeftStrike and/or kGaitRightStrike if the
+    // heel of the foot touched the ground since the previous frame (the first frame at or after the contact).
+    int Next(MarkerFrame& frame) {
+        frame_++;
+        const double t = frame_ / params_.sample_rate;
+        int strikes = 0;
+        for (int foot = 0; foot < 2; foot++) {
+            FootState& state = feet_[foot];
+            while (t >= state.cycle_start + state.cycle_duration) {
+                state.cycle_start += state.cycle_duration;
+                state.cycle_duration = NextDuration(state);
+                strikes |= (foot == 0) ? kGaitLeftStrike : kGaitRightStrike;
+            }
+            double phase = (t - state.cycle_start) / state.cycle_duration;
+            double heel[3], toe[3];
+            Markers(state, phase, heel, toe);
+            double* heel_fields[3];
+            double* toe_fields[3];
+            if (foot == 0) {
+                heel_fields[0] = &frame.LHEEx; heel_fields[1] = &frame.LHEEy; heel_fields[2] = &frame.LHEEz;
+                toe_fields[0] = &frame.LTOEx; toe_fields[1] = &frame.LTOEy; toe_fields[2] = &frame.LTOEz;
+            }
+            else {
+                heel_fields[0] = &frame.RHEEx; heel_fields[1] = &frame.RHEEy; heel_fields[2] = &frame.RHEEz;
+                toe_fields[0] = &frame.RTOEx; toe_fields[1] = &frame.RTOEy; toe_fields[2] = &frame.RTOEz;
+            }
+            bool heel_visible = Visible(state.dropout[0]);
+            bool toe_visible = Visible(state.dropout[1]);
+            for (int axis = 0; axis < 3; axis++) {
+                *heel_fields[axis] = heel_visible ? heel[axis] + params_.noise_mm * Normal() : 0;
+                *toe_fields[axis] = toe_visible ? toe[axis] + params_.noise_mm * Normal() : 0;
+            }
+        }
+        frame.frame = frame_;
+        frame.vicon_latency = 0;
+        return strikes;
+    }
+
+    // Generate "count" frames; the ground truth of every frame is written to "strikes" unless it is a null pointer
+    void Generate(MarkerFrame* frames, unsigned char* strikes, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            int truth = Next(frames[i]);
+            if (strikes != nullptr) {
+                strikes[i] = static_cast<unsigned char>(truth);
+            }
+        }
+    }
+
+    // Frame number of the last generated frame (0 before the first one)
+    int frame() const { return frame_; }
+    const GaitGeneratorParams& params() const { return params_; }
+
+private:
+    struct FootState {
+        double cycle_start;             // [s] Time of the last foot-strike
+        double cycle_duration;          // [s] Duration of the current gait cycle
+        int mean_cycles;                // Gait cycles still to be given the mean duration (keeps the right foot in step)
+        uint64_t duration_state;        // Random numbers of the gait cycle durations
+        double swing_height;            // [mm]
+        double lateral;                 // [mm] Lateral position of the markers
+        int dropout[2];                 // Frames left in the dropout of the heel and the toe marker
+    };
+
+    GaitGeneratorParams params_;
+    FootState feet_[2];
+    uint64_t noise_state_;
+    int frame_;
+
+    static uint64_t Seed(unsigned int seed, uint64_t stream) {
+        // splitmix64 of the seed and the stream, never 0 (the xorshift state must not be 0)
+        uint64_t z = (static_cast<uint64_t>(seed) << 8) + stream + 0x9E3779B97F4A7C15ull;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        z = z ^ (z >> 31);
+        return z != 0 ? z : 1;
+    }
+
+    static uint64_t Random(uint64_t& state) {
+        // xorshift64*
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1Dull;
+    }
+
+    // Standard normal approximation: sum of four uniforms of 16 bits each (Irwin-Hall), scaled to unit variance
+    static double Normal(uint64_t& state) {
+        uint64_t bits = Random(state);
+        double sum = static_cast<double>((bits & 0xFFFF) + ((bits >> 16) & 0xFFFF) + ((bits >> 32) & 0xFFFF) + (bits >> 48));
+        return (sum / 65536.0 - 2.0) * 1.7320508075688772;     // variance of the sum of 4 uniforms: 1/3
+    }
+
+    double Normal() {
+        return Normal(noise_state_);
+    }
+
+    double NextDuration(FootState& state) {
+        if (state.mean_cycles > 0) {
+            state.mean_cycles--;
+            return params_.cycle_seconds;
+        }
+        double duration = params_.cycle_seconds * (1 + params_.cycle_variability * Normal(state.duration_state));
+        double lowest = 0.5 * params_.cycle_seconds, highest = 1.5 * params_.cycle_seconds;
+        return duration < lowest ? lowest : (duration > highest ? highest : duration);
+    }
+
+    // Whether a marker is visible in this frame (a new dropout starts with probability dropout_rate)
+    bool Visible(int& dropout) {
+        if (dropout > 0) {
+            dropout--;
+            return false;
+        }
+        if (params_.dropout_rate > 0 && (Random(noise_state_) >> 11) * (1.0 / 9007199254740992.0) < params_.dropout_rate) {
+            dropout = params_.dropout_frames - 1;
+            return false;
+        }
+        return true;
+    }
+
+    // Positions of the heel and toe markers of one foot at a phase of its gait cycle (0: foot-strike)
+    void Markers(const FootState& state, double phase, double heel[3], double toe[3]) const {
+        const double pi = 3.14159265358979323846;
+        const double ground = params_.ground_height_mm;
+        const double half_stride = 0.5 * params_.stride_mm;
+        const double foot_length = 200;                         // [mm] Heel to toe marker
+        double heel_rise = 0, toe_rise = 0;
+
+        // Vertical: the heel rises from heel-off to the swing apex and descends to the foot-strike, both halves
+        // shaped as raised cosines (zero vertical velocity at heel-off, apex and foot-strike)
+        if (phase >= params_.heel_off && phase < params_.swing_apex) {
+            heel_rise = state.swing_height * 0.5 * (1 - std::cos(pi * (phase - params_.heel_off) / (params_.swing_apex - params_.heel_off)));
+        }
+        else if (phase >= params_.swing_apex) {
+            heel_rise = state.swing_height * 0.5 * (1 + std::cos(pi * (phase - params_.swing_apex) / (1 - params_.swing_apex)));
+        }
+        if (phase >= params_.toe_off) {
+            toe_rise = 0.5 * state.swing_height * 0.5 * (1 - std::cos(2 * pi * (phase - params_.toe_off) / (1 - params_.toe_off)));
+        }
+
+        // Sagittal: backwards with the belt during the stance, forwards during the swing (raised cosine)
+        double sagittal;
+        if (phase < params_.toe_off) {
+            sagittal = half_stride - params_.stride_mm * phase / params_.toe_off;
+        }
+        else {
+            sagittal = -half_stride + params_.stride_mm * 0.5 * (1 - std::cos(pi * (phase - params_.toe_off) / (1 - params_.toe_off)));
+        }
+
+        heel[0] = state.lateral;
+        heel[1] = sagittal;
+        heel[2] = ground + heel_rise;
+        toe[0] = state.lateral;
+        toe[1] = sagittal + foot_length;
+        toe[2] = ground - 30 + toe_rise;
+    }
+};
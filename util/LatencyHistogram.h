@@ -0,0 +1,90 @@
+#pragma once // Ensure inclusion only once
+
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+
+/*  Fixed-size histogram of timing measurements (e.g. the intervals between the arrivals of Vicon frames, or the
+*   lateness of replayed frames), cheap enough to be updated on every frame of a real-time loop: the bins live in the
+*   object, so Add never allocates memory and costs one division. Bin b counts the values in
+*   [lowest + b * bin_width, lowest + (b + 1) * bin_width); values below the first bin are counted in the first bin and
+*   values above the last bin in the last bin (check Min() and Max() to see whether values were clipped).
+*/
+
+template <size_t NumBins>
+class LatencyHistogram {
+public:
+    // binWidth: width of every bin; lowest: lower edge of the first bin (same unit as the values)
+    LatencyHistogram(double binWidth, double lowest = 0) : bin_width_(binWidth), lowest_(lowest) {
+        Reset();
+    }
+
+    void Reset() {
+        for (size_t b = 0; b < NumBins; b++) {
+            counts_[b] = 0;
+        }
+        count_ = 0;
+        sum_ = 0;
+        min_ = 0;
+        max_ = 0;
+    }
+
+    void Add(double value) {
+        double position = (value - lowest_) / bin_width_;
+        size_t bin = position <= 0 ? 0 : (position >= NumBins ? NumBins - 1 : static_cast<size_t>(position));
+        counts_[bin]++;
+        if (count_ == 0 || value < min_) min_ = value;
+        if (count_ == 0 || value > max_) max_ = value;
+        count_++;
+        sum_ += value;
+    }
+
+    unsigned long long Count() const { return count_; }
+    unsigned long long BinCount(size_t bin) const { return counts_[bin]; }
+    double BinLower(size_t bin) const { return lowest_ + bin * bin_width_; }
+    double Mean() const { return count_ > 0 ? sum_ / count_ : 0; }
+    double Min() const { return min_; }
+    double Max() const { return max_; }
+
+    // Upper edge of the bin holding the given fraction of the values (e.g. 0.99 for the 99th percentile)
+    double Percentile(double fraction) const {
+        if (count_ == 0) {
+            return 0;
+        }
+        unsigned long long target = static_cast<unsigned long long>(fraction * count_ + 0.5);
+        unsigned long long cumulative = 0;
+        for (size_t b = 0; b < NumBins; b++) {
+            cumulative += counts_[b];
+            if (cumulative >= target && cumulative > 0) {
+                return BinLower(b) + bin_width_;
+            }
+        }
+        return BinLower(NumBins - 1) + bin_width_;
+    }
+
+    // Print the non-empty bins, one line per bin with a bar proportional to its count
+    void Print(std::ostream& os, const char* unit) const {
+        unsigned long long largest = 0;
+        for (size_t b = 0; b < NumBins; b++) {
+            if (counts_[b] > largest) largest = counts_[b];
+        }
+        for (size_t b = 0; b < NumBins; b++) {
+            if (counts_[b] == 0) {
+                continue;
+            }
+            os << std::setw(9) << BinLower(b) << " - " << std::setw(9) << BinLower(b) + bin_width_ << " " << unit << ": "
+               << std::setw(8) << counts_[b] << " ";
+            int bar = static_cast<int>(40 * counts_[b] / largest);
+            for (int i = 0; i < bar; i++) {
+                os << '#';
+            }
+            os << std::endl;
+        }
+    }
+
+private:
+    double bin_width_, lowest_;
+    unsigned long long counts_[NumBins];
+    unsigned long long count_;
+    double sum_, min_, max_;
+};
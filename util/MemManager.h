@@ -1,28 +1,119 @@
 // Shared memory manager class
+#pragma once // Ensure inclusion only once
+
 #include <iostream>
-#include <windows.h>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <string>
+#include <thread>
 #include "SharedMemStruct.h" // Include the struct definition from SharedMemStruct.h
 
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <cerrno>
+  #include <ctime>
+  #include <fcntl.h>      // For O_* constants
+  #include <sys/mman.h>   // For shm_open(), mmap(), mlock()
+  #include <sys/stat.h>   // For mode constants
+  #include <unistd.h>     // For ftruncate(), close(), syscall()
+  #include <linux/futex.h> // For FUTEX_WAIT, FUTEX_WAKE
+  #include <sys/syscall.h> // For SYS_futex
+#endif
+
+/*  On Windows the shared memory is a named file mapping (CreateFileMappingW/MapViewOfFile).
+*   On Linux it is a POSIX shared memory object (shm_open/mmap) named after the same wide string,
+*   e.g. L"Vicon_SharedMemory" becomes "/Vicon_SharedMemory" under /dev/shm.
+*   The Linux mapping is pre-faulted (MAP_POPULATE) and locked in RAM (mlock) so that the real-time
+*   loops never take a page fault on the hot path. Huge pages can be requested in the constructor;
+*   the mapping is then rounded up to a 2 MB boundary and advised to the kernel as a huge page region.
+*
+*   Consumers do not have to poll for new marker frames: WaitForMarkers spins for a short, adaptive time and then
+*   blocks on a futex word in the shared memory (Linux) or on a named semaphore (Windows) until the Vicon process
+*   publishes the next frame, so idle consumers use no CPU.
+*/
+
+// Wakeup statistics of one consumer (process local), filled in by MemManager::WaitForMarkers
+struct WakeupStats {
+    unsigned long long wakeups = 0;         // Number of new frames waited for
+    unsigned long long spin_wakeups = 0;    // Frames that arrived while still spinning
+    unsigned long long blocked_wakeups = 0; // Frames that arrived after blocking in the kernel
+    unsigned long long timeouts = 0;        // Waits that ended without a new frame
+    double latency_sum_us = 0;              // Sum of publish-to-wakeup latencies [us]
+    double latency_max_us = 0;              // Largest publish-to-wakeup latency [us]
+    double spin_limit_us = 20;              // Current adaptive spin budget before blocking [us]
+
+    double MeanLatencyUs() const {
+        return wakeups > 0 ? latency_sum_us / wakeups : 0;
+    }
+};
+
+// overload on << to print the wakeup statistics
+inline std::ostream& operator<<(std::ostream& os, const WakeupStats& stats) {
+    os << "wakeups: " << stats.wakeups << " (spin: " << stats.spin_wakeups << ", blocked: " << stats.blocked_wakeups
+       << ", timeouts: " << stats.timeouts << "), wakeup latency mean: " << stats.MeanLatencyUs()
+       << " us, max: " << stats.latency_max_us << " us, spin limit: " << stats.spin_limit_us << " us";
+    return os;
+}
+
 class MemManager {
 private:
     size_t size_;
     const wchar_t* name_;
+    bool use_huge_pages_;
+    WakeupStats wakeup_stats_;
+#ifdef _WIN32
     HANDLE file_handle_;
+    HANDLE notify_handle_;          // Named semaphore used to wake consumers blocked in WaitForMarkers
+#else
+    int file_handle_;               // File descriptor returned by shm_open
+    bool owner_;                    // True if this process created (and must unlink) the shared memory object
+    std::string posix_name_;        // Name of the shared memory object ("/" + name)
+#endif
+    static const size_t kHugePageSize = 2 * 1024 * 1024;
+    static constexpr double kMinSpinUs = 1;     // Bounds of the adaptive spin budget of WaitForMarkers
+    static constexpr double kMaxSpinUs = 200;
+#ifdef _WIN32
+    static const DWORD kTokenWaitMs = 100;      // Longest wait for a semaphore token already promised to a consumer
+#endif
 
 public:
     SharedMemStruct* data;
 
-    MemManager(const wchar_t* name) : name_(name), file_handle_(nullptr), data(nullptr) {
+    MemManager(const wchar_t* name, bool use_huge_pages = false) : name_(name), use_huge_pages_(use_huge_pages), data(nullptr) {
         size_ = sizeof(SharedMemStruct); // Implicitly set the size from the struct size
+        if (use_huge_pages_) {
+            size_ = (size_ + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+        }
+#ifdef _WIN32
+        file_handle_ = nullptr;
+        notify_handle_ = nullptr;
+#else
+        file_handle_ = -1;
+        owner_ = false;
+        // Shared memory object names must start with a slash and contain plain characters
+        posix_name_ = "/";
+        for (const wchar_t* c = name_; *c != L'\0'; ++c) {
+            posix_name_ += (*c > 0 && *c < 128 && *c != L'/') ? static_cast<char>(*c) : '_';
+        }
+#endif
     }
 
     ~MemManager() {
         Disconnect();
     }
 
+#ifdef _WIN32
     // Create a new memory-mapped file
     bool Create() {
-        file_handle_ = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, size_, name_);
+        DWORD protect = PAGE_READWRITE;
+        if (use_huge_pages_) {
+            protect |= SEC_COMMIT | SEC_LARGE_PAGES; // Requires the SeLockMemoryPrivilege
+        }
+        file_handle_ = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, protect, 0, size_, name_);
         if (file_handle_ == nullptr) {
             std::cerr << "CreateFileMappingW failed: " << GetLastError() << std::endl;
             return false;
@@ -32,10 +123,11 @@ public:
         if (data == nullptr) {
             std::cerr << "MapViewOfFile failed: " << GetLastError() << std::endl;
             CloseHandle(file_handle_);
+            file_handle_ = nullptr;
             return false;
         }
 
-        return true;
+        return OpenNotifier();
     }
 
     // Connect to an existing memory-mapped file
@@ -50,10 +142,11 @@ public:
         if (data == nullptr) {
             std::cerr << "MapViewOfFile failed: " << GetLastError() << std::endl;
             CloseHandle(file_handle_);
+            file_handle_ = nullptr;
             return false;
         }
 
-        return true;
+        return OpenNotifier();
     }
 
     // Disconnect from the memory-mapped file
@@ -67,9 +160,359 @@ public:
             CloseHandle(file_handle_);
             file_handle_ = nullptr;
         }
+
+        if (notify_handle_ != nullptr) {
+            CloseHandle(notify_handle_);
+            notify_handle_ = nullptr;
+        }
     }
+#else
+    // Create a new shared memory object. An object with the same name that already exists is taken over and
+    // reinitialized: on Linux it outlives a creator that crashed, with stale ring indices, sequence counters and
+    // subscriber slots. The processes still mapped to it keep the same object and see the reset layout.
+    bool Create() {
+        bool existed = false;
+        file_handle_ = shm_open(posix_name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0666);
+        if (file_handle_ == -1) {
+            if (errno != EEXIST) {
+                std::cerr << "shm_open failed: " << std::strerror(errno) << std::endl;
+                return false;
+            }
+            std::cerr << "Shared memory object " << posix_name_ << " already exists, reinitializing it" << std::endl;
+            file_handle_ = shm_open(posix_name_.c_str(), O_RDWR, 0666);
+            if (file_handle_ == -1) {
+                std::cerr << "shm_open failed: " << std::strerror(errno) << std::endl;
+                return false;
+            }
+            existed = true;
+        }
+        owner_ = true;
+
+        // Size the object; the new pages are zero-filled like a fresh Windows file mapping
+        if (ftruncate(file_handle_, static_cast<off_t>(size_)) == -1) {
+            std::cerr << "ftruncate failed: " << std::strerror(errno) << std::endl;
+            Disconnect();
+            return false;
+        }
+
+        if (!Map()) {
+            return false;
+        }
+        if (existed) {
+            memset(static_cast<void*>(data), 0, size_);     // Same layout as a new object
+        }
+        return true;
+    }
+
+    // Connect to an existing shared memory object
+    bool Connect() {
+        file_handle_ = shm_open(posix_name_.c_str(), O_RDWR, 0666);
+        if (file_handle_ == -1) {
+            std::cerr << "shm_open failed: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+
+        return Map();
+    }
+
+    // Disconnect from the shared memory object (the creator also removes its name)
+    void Disconnect() {
+        if (data != nullptr) {
+            munlock(data, size_);
+            munmap(data, size_);
+            data = nullptr;
+        }
+
+        if (file_handle_ != -1) {
+            close(file_handle_);
+            file_handle_ = -1;
+        }
+
+        if (owner_) {
+            shm_unlink(posix_name_.c_str());
+            owner_ = false;
+        }
+    }
+#endif
 
     SharedMemStruct* GetData() const {
         return data;
     }
-};
\ No newline at end of file
+
+    // Seqlock writer: publish a complete marker frame. Only the Vicon process writes markers, so this never blocks.
+    // The frame is also appended to the marker ring, so that the GaitMonitor can process every frame in order,
+    // and consumers blocked in WaitForMarkers are woken up.
+    void WriteMarkers(const MarkerFrame& frame) {
+        data->marker_ring.Push(frame);
+
+        unsigned int seq = data->marker_seq.load(std::memory_order_relaxed);
+        data->marker_seq.store(seq + 1, std::memory_order_relaxed);     // Odd: write in progress
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(&data->markers, &frame, sizeof(MarkerFrame));
+        data->marker_seq.store(seq + 2, std::memory_order_release);     // Even: frame is consistent
+
+        NotifyMarkers();
+    }
+
+    // Wake every consumer waiting for a new marker frame. The system call is skipped when nobody is blocked.
+    void NotifyMarkers() {
+        data->marker_publish_ns.store(SteadyNowNs(), std::memory_order_relaxed);
+        data->marker_notify.fetch_add(1, std::memory_order_seq_cst);
+#ifdef _WIN32
+        // Every counted waiter is taken off the count and given one semaphore token (see UnregisterWaiter)
+        unsigned int waiters = data->marker_waiters.exchange(0, std::memory_order_seq_cst);
+        if (waiters > 0) {
+            ReleaseSemaphore(notify_handle_, static_cast<LONG>(waiters), nullptr);
+        }
+#else
+        if (data->marker_waiters.load(std::memory_order_seq_cst) > 0) {
+            syscall(SYS_futex, reinterpret_cast<unsigned int*>(&data->marker_notify), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+        }
+#endif
+    }
+
+    // Consumer: wait until a marker frame newer than "seen" is published, then update "seen".
+    // Start with seen = MarkerNotifyCount(). Spins for an adaptive time (kept short when frames arrive slowly,
+    // extended when they arrive back to back) before blocking. Returns false if "timeout_ms" elapsed first
+    // (a negative timeout waits forever).
+    bool WaitForMarkers(unsigned int& seen, int timeout_ms = -1) {
+        auto start = std::chrono::steady_clock::now();
+
+        // (1) Spin phase
+        auto spin_end = start + std::chrono::nanoseconds(static_cast<long long>(wakeup_stats_.spin_limit_us * 1000));
+        unsigned int current = data->marker_notify.load(std::memory_order_acquire);
+        while (current == seen && std::chrono::steady_clock::now() < spin_end) {
+            std::this_thread::yield();
+            current = data->marker_notify.load(std::memory_order_acquire);
+        }
+        if (current != seen) {
+            // The frame arrived while spinning: spinning pays off, so allow a bit more of it
+            wakeup_stats_.spin_wakeups++;
+            // (no std::min/std::max here: they would ODR-use the constants and clash with the macros of windows.h)
+            double extended_us = wakeup_stats_.spin_limit_us * 1.25;
+            wakeup_stats_.spin_limit_us = extended_us > kMaxSpinUs ? kMaxSpinUs : extended_us;
+            return RecordWakeup(seen, current);
+        }
+
+        // (2) Blocking phase: the frame did not come soon, so spinning was wasted and its budget is halved
+        double reduced_us = wakeup_stats_.spin_limit_us * 0.5;
+        wakeup_stats_.spin_limit_us = reduced_us < kMinSpinUs ? kMinSpinUs : reduced_us;
+        auto deadline = start + std::chrono::milliseconds(timeout_ms);
+        while (current == seen) {
+            long long remaining_ms = -1;
+            if (timeout_ms >= 0) {
+                long long remaining_us = std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now()).count();
+                if (remaining_us <= 0) {
+                    wakeup_stats_.timeouts++;
+                    return false;
+                }
+                remaining_ms = (remaining_us + 999) / 1000;     // rounded up, so that the wait does not end before the deadline
+            }
+            data->marker_waiters.fetch_add(1, std::memory_order_seq_cst);
+            bool token_taken = false;
+            if (data->marker_notify.load(std::memory_order_seq_cst) == seen) {
+                token_taken = BlockOnNotify(seen, remaining_ms);
+            }
+            UnregisterWaiter(token_taken);
+            current = data->marker_notify.load(std::memory_order_acquire);
+        }
+        wakeup_stats_.blocked_wakeups++;
+        return RecordWakeup(seen, current);
+    }
+
+    // Number of marker frames published so far (the starting value of "seen" for WaitForMarkers)
+    unsigned int MarkerNotifyCount() const {
+        return data->marker_notify.load(std::memory_order_acquire);
+    }
+
+    // Wakeup statistics of this consumer
+    const WakeupStats& GetWakeupStats() const {
+        return wakeup_stats_;
+    }
+
+    // Seqlock reader: single attempt to copy the latest marker frame.
+    // Returns false (and leaves "frame" unusable) if the writer was active during the copy.
+    bool TryReadMarkers(MarkerFrame& frame) const {
+        unsigned int seq_begin = data->marker_seq.load(std::memory_order_acquire);
+        if (seq_begin & 1u) {
+            return false;
+        }
+        std::memcpy(&frame, &data->markers, sizeof(MarkerFrame));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return data->marker_seq.load(std::memory_order_relaxed) == seq_begin;
+    }
+
+    // Seqlock reader: copy a consistent snapshot of the latest marker frame, retrying while the writer is active.
+    // Returns the sequence number of the snapshot, which increases by 2 with every published frame.
+    unsigned int ReadMarkers(MarkerFrame& frame) const {
+        while (true) {
+            unsigned int seq_begin = data->marker_seq.load(std::memory_order_acquire);
+            if ((seq_begin & 1u) == 0) {
+                std::memcpy(&frame, &data->markers, sizeof(MarkerFrame));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (data->marker_seq.load(std::memory_order_relaxed) == seq_begin) {
+                    return seq_begin;
+                }
+            }
+        }
+    }
+
+    // Ring consumer (the GaitMonitor only): take the oldest marker frame not processed yet. Returns false if none is pending.
+    bool PopMarkers(MarkerFrame& frame) {
+        return data->marker_ring.Pop(frame);
+    }
+
+    // Ring consumer: take up to "max_frames" pending marker frames in order (e.g. to catch up after being descheduled)
+    size_t PopMarkers(MarkerFrame* frames, size_t max_frames) {
+        return data->marker_ring.PopBatch(frames, max_frames);
+    }
+
+    // Ring consumer: drop the frames that were published before this consumer attached
+    void SkipToLatestMarkers() {
+        data->marker_ring.SkipToLatest();
+    }
+
+    // Number of marker frames dropped because the consumer fell more than kMarkerRingCapacity frames behind
+    unsigned long long MarkerOverruns() const {
+        return data->marker_ring.Overruns();
+    }
+
+    // Heel-strike log producer (the GaitMonitor only): broadcast a foot-strike to every subscribed consumer
+    void PublishHeelStrike(const HeelStrikeRecord& record) {
+        data->heel_strike_log.Publish(record);
+    }
+
+    // Heel-strike log consumer: reserve a cursor that receives the foot-strikes published from now on.
+    // Returns the consumer id, or -1 if kMaxHeelStrikeConsumers processes are already subscribed.
+    int SubscribeHeelStrikes() {
+        return data->heel_strike_log.Subscribe();
+    }
+
+    // Heel-strike log consumer: release the cursor (must be called before the process exits)
+    void UnsubscribeHeelStrikes(int consumer) {
+        data->heel_strike_log.Unsubscribe(consumer);
+    }
+
+    // Heel-strike log consumer: take the next foot-strike not seen by this consumer. Returns false if none is pending.
+    bool PollHeelStrike(int consumer, HeelStrikeRecord& record) {
+        return data->heel_strike_log.Poll(consumer, record);
+    }
+
+    // Number of foot-strikes overwritten before this consumer read them (it fell more than kHeelStrikeLogCapacity behind)
+    unsigned long long HeelStrikesLost(int consumer) const {
+        return data->heel_strike_log.Lost(consumer);
+    }
+
+private:
+    // Monotonic time in nanoseconds, comparable between processes (CLOCK_MONOTONIC / QueryPerformanceCounter)
+    static long long SteadyNowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Update "seen" and the latency statistics after a new frame has been observed
+    bool RecordWakeup(unsigned int& seen, unsigned int current) {
+        double latency_us = (SteadyNowNs() - data->marker_publish_ns.load(std::memory_order_relaxed)) / 1e3;
+        wakeup_stats_.wakeups++;
+        wakeup_stats_.latency_sum_us += latency_us;
+        if (latency_us > wakeup_stats_.latency_max_us) {
+            wakeup_stats_.latency_max_us = latency_us;
+        }
+        seen = current;
+        return true;
+    }
+
+    // Sleep in the kernel while the notify word still equals "seen" (a negative timeout waits forever).
+    // Returns true if a semaphore token was taken (Windows), false after a timeout and always on Linux.
+    bool BlockOnNotify(unsigned int seen, long long timeout_ms) {
+#ifdef _WIN32
+        (void)seen;
+        return WaitForSingleObject(notify_handle_, timeout_ms < 0 ? INFINITE : static_cast<DWORD>(timeout_ms)) == WAIT_OBJECT_0;
+#else
+        struct timespec timeout;
+        timeout.tv_sec = static_cast<time_t>(timeout_ms / 1000);
+        timeout.tv_nsec = static_cast<long>((timeout_ms % 1000) * 1000000);
+        syscall(SYS_futex, reinterpret_cast<unsigned int*>(&data->marker_notify), FUTEX_WAIT, seen,
+                timeout_ms < 0 ? nullptr : &timeout, nullptr, 0);
+        return false;
+#endif
+    }
+
+    // Remove a consumer from the waiter count after its wait. On Windows the count and the semaphore tokens together
+    // hold one unit per registered consumer: the producer turns the whole count into tokens, a consumer woken by the
+    // semaphore has used its token, and a consumer leaving without one (new frame seen before blocking, or timeout)
+    // takes a unit off the count, or, if the producer already turned it into a token, takes that token. No token is
+    // left behind to wake a later wait spuriously.
+    void UnregisterWaiter(bool token_taken) {
+#ifdef _WIN32
+        if (token_taken) {
+            return;
+        }
+        unsigned int waiters = data->marker_waiters.load(std::memory_order_seq_cst);
+        while (waiters > 0 && !data->marker_waiters.compare_exchange_weak(waiters, waiters - 1, std::memory_order_seq_cst)) {
+        }
+        if (waiters == 0) {
+            // The token is released right after the count is taken; the bound only guards against a producer that died in between
+            WaitForSingleObject(notify_handle_, kTokenWaitMs);
+        }
+#else
+        (void)token_taken;
+        data->marker_waiters.fetch_sub(1, std::memory_order_seq_cst);
+#endif
+    }
+
+#ifdef _WIN32
+    // Create or open the named semaphore shared by the marker producer and its consumers
+    bool OpenNotifier() {
+        std::wstring notify_name = std::wstring(name_) + L"_MarkerNotify";
+        notify_handle_ = CreateSemaphoreW(nullptr, 0, LONG_MAX, notify_name.c_str());
+        if (notify_handle_ == nullptr) {
+            std::cerr << "CreateSemaphoreW failed: " << GetLastError() << std::endl;
+            Disconnect();
+            return false;
+        }
+        return true;
+    }
+#else
+    // Map the opened shared memory object, pre-fault every page and lock it in RAM
+    bool Map() {
+        // An object of another build (different SharedMemStruct) or one not yet sized by its creator would fault on access
+        struct stat object_stat;
+        if (fstat(file_handle_, &object_stat) == -1 || static_cast<size_t>(object_stat.st_size) < size_) {
+            std::cerr << "Shared memory object " << posix_name_ << " is smaller than SharedMemStruct ("
+                      << sizeof(SharedMemStruct) << " bytes)" << std::endl;
+            Disconnect();
+            return false;
+        }
+
+        // With huge pages the region has to be advised before it is faulted in, so MAP_POPULATE is skipped
+        int flags = use_huge_pages_ ? MAP_SHARED : (MAP_SHARED | MAP_POPULATE);
+        void* addr = mmap(nullptr, size_, PROT_READ | PROT_WRITE, flags, file_handle_, 0);
+        if (addr == MAP_FAILED) {
+            std::cerr << "mmap failed: " << std::strerror(errno) << std::endl;
+            Disconnect();
+            return false;
+        }
+        data = static_cast<SharedMemStruct*>(addr);
+
+#ifdef MADV_HUGEPAGE
+        // Transparent huge pages for shmem must be enabled in /sys/kernel/mm/transparent_hugepage/shmem_enabled
+        if (use_huge_pages_ && madvise(addr, size_, MADV_HUGEPAGE) == -1) {
+            std::cerr << "madvise(MADV_HUGEPAGE) failed: " << std::strerror(errno) << std::endl;
+        }
+#endif
+
+        // mlock faults in and pins every page. It fails without CAP_IPC_LOCK or a sufficient RLIMIT_MEMLOCK,
+        // in which case every page is read once by hand so that at least the first access does not fault
+        if (mlock(addr, size_) == -1) {
+            std::cerr << "mlock failed (continuing unlocked): " << std::strerror(errno) << std::endl;
+            const volatile char* page = static_cast<const volatile char*>(addr);
+            size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            for (size_t offset = 0; offset < size_; offset += page_size) {
+                (void)page[offset];
+            }
+        }
+
+        return true;
+    }
+#endif
+};
@@ -0,0 +1,121 @@
+#pragma once // Ensure inclusion only once
+
+#include "LatencyHistogram.h"
+#include <chrono>
+#include <iostream>
+#include <thread>
+#ifdef __linux__
+  #include <cerrno>
+  #include <time.h>
+#endif
+
+/*  Scheduler pacing the replay of a recording at its sampling rate times a speed multiplier (e.g. 0.5, 1, 10 or 100),
+*   or as fast as possible (speed 0: unthrottled). Every frame n has the absolute deadline start + n * period / speed,
+*   so the time spent processing a frame, the wake-up latency of the sleep and the frames that were late do not
+*   accumulate over the replay: a replay of 75000 frames ends within a frame period of its nominal duration, unlike a
+*   fixed sleep after every frame. The thread sleeps until shortly before the deadline (clock_nanosleep with an absolute
+*   CLOCK_MONOTONIC time on Linux, sleep_until elsewhere) and busy-waits the remaining "spin" seconds, which removes most
+*   of the wake-up latency at the cost of one core during the tail. Frames behind schedule are released at once until
+*   the replay has caught up.
+*   The lateness of every frame (time at which WaitNext returns minus the deadline) is collected in a histogram, and a
+*   frame later than the miss tolerance counts as a deadline miss; Report prints them with the achieved frame rate.
+*/
+
+#ifdef _WIN32
+const double kReplayDefaultSpinSeconds = 0.002;     // Sleeps of the default Windows timer are ~1-15 ms late
+#else
+const double kReplayDefaultSpinSeconds = 0.0002;
+#endif
+
+class ReplayScheduler {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    // sampleRate: [Hz] rate of the recording; speed: replay speed multiplier (0: unthrottled); spinSeconds: busy-wait
+    // before every deadline; missTolerance: lateness counted as a deadline miss, relative to the replayed frame period
+    ReplayScheduler(double sampleRate = 100, double speed = 1, double spinSeconds = kReplayDefaultSpinSeconds, double missTolerance = 0.1)
+        : speed_(speed), spin_(spinSeconds), lateness_us_(10) {
+        period_ = speed > 0 ? 1.0 / (sampleRate * speed) : 0;
+        miss_tolerance_ = missTolerance * period_;
+        Start();
+    }
+
+    // Restart the schedule: the first frame is due now
+    void Start() {
+        start_ = Clock::now();
+        last_ = start_;
+        frames_ = 0;
+        misses_ = 0;
+        lateness_us_.Reset();
+    }
+
+    // Wait until the deadline of the next frame (unthrottled: return at once). Returns the lateness [s] of the frame.
+    double WaitNext() {
+        double lateness = 0;
+        if (period_ > 0) {
+            Clock::time_point deadline = start_ + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(frames_ * period_));
+            Clock::time_point wake = deadline - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(spin_));
+            if (Clock::now() < wake) {
+                SleepUntil(wake);
+            }
+            Clock::time_point now = Clock::now();
+            while (now < deadline) {
+                now = Clock::now();
+            }
+            lateness = std::chrono::duration<double>(now - deadline).count();
+            lateness_us_.Add(lateness * 1e6);
+            misses_ += lateness > miss_tolerance_;
+            last_ = now;
+        }
+        else {
+            last_ = Clock::now();
+        }
+        frames_++;
+        return lateness;
+    }
+
+    unsigned long long Frames() const { return frames_; }
+    unsigned long long DeadlineMisses() const { return misses_; }
+    // [s] Time from the start to the release of the last frame
+    double Elapsed() const { return std::chrono::duration<double>(last_ - start_).count(); }
+    // [frames/s] Rate achieved between the first and the last frame, and rate requested (0: unthrottled)
+    double AchievedRate() const { return frames_ > 1 && Elapsed() > 0 ? (frames_ - 1) / Elapsed() : 0; }
+    double TargetRate() const { return period_ > 0 ? 1.0 / period_ : 0; }
+    // Lateness of the frames [us] (bins of 10 us up to 20 ms; Max() is exact)
+    const LatencyHistogram<2000>& Lateness() const { return lateness_us_; }
+
+    // Print the achieved rate, the deadline misses and the percentiles of the lateness
+    void Report(std::ostream& os) const {
+        os << "Replay: " << frames_ << " frames in " << Elapsed() << " s, achieved " << AchievedRate() << " frames/s";
+        if (period_ <= 0) {
+            os << " (unthrottled)" << std::endl;
+            return;
+        }
+        os << " (target " << TargetRate() << " frames/s, speed " << speed_ << "x)" << std::endl;
+        os << "Deadline misses: " << misses_ << " (later than " << miss_tolerance_ * 1e6 << " us)" << std::endl;
+        os << "Lateness [us]: mean " << lateness_us_.Mean() << ", p50 " << lateness_us_.Percentile(0.5)
+           << ", p90 " << lateness_us_.Percentile(0.9) << ", p99 " << lateness_us_.Percentile(0.99)
+           << ", p99.9 " << lateness_us_.Percentile(0.999) << ", max " << lateness_us_.Max() << std::endl;
+    }
+
+private:
+    double speed_, period_, spin_, miss_tolerance_;
+    Clock::time_point start_, last_;
+    unsigned long long frames_, misses_;
+    LatencyHistogram<2000> lateness_us_;
+
+    static void SleepUntil(Clock::time_point wake) {
+#ifdef __linux__
+        // steady_clock is CLOCK_MONOTONIC: sleep until the absolute time, so that a wake-up after a signal or a late
+        // start of the sleep does not shift the deadline
+        long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(wake.time_since_epoch()).count();
+        timespec ts;
+        ts.tv_sec = static_cast<time_t>(ns / 1000000000);
+        ts.tv_nsec = static_cast<long>(ns % 1000000000);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+        }
+#else
+        std::this_thread::sleep_until(wake);
+#endif
+    }
+};
@@ -0,0 +1,66 @@
+#pragma once // Ensure inclusion only once
+
+#include <algorithm>
+#include <cstddef>
+
+/*  Fixed-capacity circular buffer of the last "length" values of a signal (e.g. the durations of the last gait cycles),
+*   with an O(1) rolling sum. The storage is a member array of MaxLength elements, so pushing a value never allocates;
+*   the active window length is chosen in the constructor (1..MaxLength). The window starts filled with zeros, which
+*   are part of the mean until they have been pushed out (as in the original five-cycle average of FootStrikeDetector).
+*/
+
+template <typename T, size_t MaxLength>
+class RollingWindow {
+public:
+    static_assert(MaxLength > 0, "RollingWindow needs room for at least one value");
+
+    explicit RollingWindow(size_t windowLength = MaxLength) {
+        length = std::min(std::max(windowLength, static_cast<size_t>(1)), MaxLength);
+        Reset();
+    }
+
+    // Refill the window with zeros
+    void Reset() {
+        std::fill(values, values + MaxLength, T(0));
+        oldest = 0;
+        sum = T(0);
+    }
+
+    // Replace the oldest value by a new one and return the value that left the window
+    T Push(T value) {
+        T evicted = values[oldest];
+        sum = sum - evicted + value;
+        values[oldest] = value;
+        oldest = (oldest + 1 == length) ? 0 : oldest + 1;
+        return evicted;
+    }
+
+    // Value "i" of the window, oldest first (i = 0 is the oldest, i = Length() - 1 the newest value)
+    T operator[](size_t i) const {
+        size_t index = oldest + i;
+        return values[index >= length ? index - length : index];
+    }
+
+    size_t Length() const { return length; }
+    T Sum() const { return sum; }
+    T Mean() const { return sum / static_cast<T>(length); }
+
+    // Median of the window (mean of the two middle values for an even length), computed on a copy on the stack
+    T Median() const {
+        T sorted[MaxLength];
+        std::copy(values, values + length, sorted);
+        size_t middle = length / 2;
+        std::nth_element(sorted, sorted + middle, sorted + length);
+        T median = sorted[middle];
+        if (length % 2 == 0) {
+            median = (median + *std::max_element(sorted, sorted + middle)) / 2;
+        }
+        return median;
+    }
+
+private:
+    T values[MaxLength];        // Circular storage (only the first "length" elements are used)
+    size_t length;              // Active window length
+    size_t oldest;              // Index of the oldest value
+    T sum;                      // Rolling sum of the window
+};
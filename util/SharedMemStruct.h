@@ -1,6 +1,10 @@
 #pragma once // Ensure inclusion only once
 
 #include <iostream>
+#include <atomic>
+#include <cstddef>
+#include "SpscRing.h"
+#include "SpmcLog.h"
 
 /*  This is the struct which defines the size and layout for our memory mapped file (shared memory)
 *   Think of it a bit as being a bit like a template for our shared memory. It defines what our database looks like
@@ -39,9 +43,58 @@ inline std::ostream& operator<<(std::ostream& os, const ExpStates& state) {
 }
 
 
+/*  Marker positions of one Vicon frame. The Vicon process publishes a whole frame at once, so that
+*   the GaitMonitor never sees a new frame number next to half-updated heel/toe coordinates.
+*/
+struct MarkerFrame {
+    double RHEEx;                       // Right heel marker
+    double RHEEy;                       // Right heel marker
+    double RHEEz;                       // Right heel marker
+    double LHEEx;                       // Left heel marker
+    double LHEEy;                       // Left heel marker
+    double LHEEz;                       // Left heel marker
+    double RTOEx;                       // Right TOE marker
+    double RTOEy;                       // Right TOE marker
+    double RTOEz;                       // Right TOE marker
+    double LTOEx;                       // Left TOE marker
+    double LTOEy;                       // Left TOE marker
+    double LTOEz;                       // Left TOE marker
+    int frame;                          // Frame number
+    double vicon_latency;               // [s] Latency of the frame reported by the Vicon DataStream SDK (GetLatencyTotal), 0 if unknown
+};
+
+// Number of marker frames buffered between the Vicon process and the GaitMonitor (2.56 s at 100 Hz)
+const size_t kMarkerRingCapacity = 256;
+
+/*  One foot-strike, as broadcast by the GaitMonitor to every process subscribed to the heel-strike log.
+*   Unlike the gait event block, which only holds the latest foot-strike of each foot, the log lets a consumer see
+*   every foot-strike exactly once, even if two of them happen between two iterations of its loop.
+*/
+struct HeelStrikeRecord {
+    int foot;                           // 0 = left, 1 = right
+    int frame;                          // Frame number of the foot-strike
+    int gait_cycle;                     // Gait cycle number after the foot-strike
+    int missed;                         // 1 if the foot-strike was inserted by the fail-safe mechanism
+    double time_stamp;                  // Time stamp of the foot-strike in seconds
+    double duration;                    // Average duration of the gait cycle in seconds
+};
 
+// Number of foot-strikes kept in the heel-strike log (about 30 s of walking) and number of processes that can read it
+const size_t kHeelStrikeLogCapacity = 64;
+const size_t kMaxHeelStrikeConsumers = 8;
+
+// The sequence counter lives in memory shared between processes, so it must never fall back to a lock
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "std::atomic<unsigned int> must be lock-free to be used in shared memory");
+
+/*  Layout: the fields are grouped in blocks by the process that writes them, and every block starts on its own
+*   64-byte cache line (alignas(64) on the first field of the block). A process that writes its block at a high rate
+*   (e.g. the GaitMonitor updating the gait cycle percentages) therefore never invalidates the cache lines that
+*   another process is writing, and readers only miss on the lines whose owner actually changed something.
+*   Keep new variables inside the block of the process that writes them.
+*/
 struct SharedMemStruct {
-    int value1;
+    // ---- Experiment control block (written by the user interface / experiment manager) ----
+    alignas(64) int value1;
     int value2;
     ExpStates experiment_state;
     bool VSTcontrol_ready = false;
@@ -49,40 +102,61 @@ struct SharedMemStruct {
     bool UserInterface_ready = false;
     bool EncoderHandler_ready = false;
     bool DAQ_state = false;
-    float vsm_left_dStiffness_kNpm;     // Desired stiffness of left vsm [kN/m]
+
+    // ---- Actuator command block (written by the VST controller) ----
+    alignas(64) float vsm_left_dStiffness_kNpm; // Desired stiffness of left vsm [kN/m]
     float vsm_right_dStiffness_kNpm;    // Desired stiffness of right vsm [kN/m]
-    int vsm_left_aPos_cnts;             // Actual position of left vsm [counts]
-    int vsm_right_aPos_cnts;            // Actual position of right vsm [counts]
     float belt_left_dVel_mps;           // Desired linear velocity of left belt [m/s]
     float belt_right_dVel_mps;          // Desired linear velocity of right belt [m/s]
+
+    // ---- Actuator feedback block (written by the treadmill/VSM handlers) ----
+    alignas(64) int vsm_left_aPos_cnts; // Actual position of left vsm [counts]
+    int vsm_right_aPos_cnts;            // Actual position of right vsm [counts]
     float belt_left_aVel_rpm;           // Actual angular velocity of left belt motor [rpm]
     float belt_right_aVel_rpm;          // Actual angular velocity of right belt motor [rpm]
     float vsm_left_RMS;                 // RMS of left vsm motor
     float vsm_right_RMS;                // RMS of right vsm motor
     float belt_left_RMS;                // RMS of left belt motor
     float belt_right_RMS;               // RMS of right belt motor
-    double RHEEx;                       // Right heel marker
-    double RHEEy;                       // Right heel marker
-    double RHEEz;                       // Right heel marker
-    double LHEEx;                       // Left heel marker
-    double LHEEy;                       // Left heel marker
-    double LHEEz;                       // Left heel marker
-    double RTOEx;                       // Right TOE marker
-    double RTOEy;                       // Right TOE marker
-    double RTOEz;                       // Right TOE marker
-    double LTOEx;                       // Left TOE marker
-    double LTOEy;                       // Left TOE marker
-    double LTOEz;                       // Left TOE marker
-    int frame;                          // Frame number      
-    int left_gc;                        // Left Gait cycle number
-    double left_gc_pct;                 // Left Gait cycle percentage
+
+    // ---- Marker block (written by the Vicon process) ----
+    alignas(64) std::atomic<unsigned int> marker_seq; // Seqlock sequence counter of "markers" (odd while the Vicon process is writing)
+    MarkerFrame markers;                // Latest marker frame, written with MemManager::WriteMarkers and read with MemManager::ReadMarkers
+    std::atomic<unsigned int> marker_notify;    // Futex word incremented for every published marker frame (MemManager::WaitForMarkers)
+    std::atomic<long long> marker_publish_ns;   // Steady clock time of the last publish [ns], used to measure the wakeup latency
+
+    // ---- Marker consumer block (written by every process waiting for marker frames) ----
+    alignas(64) std::atomic<unsigned int> marker_waiters; // Consumers blocked (or about to block) on "marker_notify" and not yet woken
+
+    // ---- Marker ring (producer and consumer halves are aligned to separate cache lines inside SpscRing) ----
+    SpscRing<MarkerFrame, kMarkerRingCapacity> marker_ring; // Every marker frame in order, drained by the GaitMonitor with MemManager::PopMarkers
+
+    // ---- Gait event block (written by the GaitMonitor on every foot-strike) ----
+    alignas(64) int left_gc;            // Left Gait cycle number
     int left_last_hs_frame;             // Frame number of last left foot-strike
     double left_gc_dur;                 // Average duration of left gait cycle in seconds
     double left_time_stamp_hs;          // Time stamp of left foot-strike
-    int right_gc;                       // Left Gait cycle number
-    double right_gc_pct;                // Left Gait cycle percentage
-    int right_last_hs_frame;            // Frame number of last left foot-strike
-    double right_gc_dur;                // Average duration of left gait cycle in seconds
-    double right_time_stamp_hs;         // Time stamp of left foot-strike
-     // Other variables (can be different types!) added here as needed
-};
\ No newline at end of file
+    int right_gc;                       // Right Gait cycle number
+    int right_last_hs_frame;            // Frame number of last right foot-strike
+    double right_gc_dur;                // Average duration of right gait cycle in seconds
+    double right_time_stamp_hs;         // Time stamp of right foot-strike
+
+    // ---- Gait phase block (written by the GaitMonitor on every iteration of its loop) ----
+    alignas(64) double left_gc_pct;     // Left Gait cycle percentage
+    double right_gc_pct;                // Right Gait cycle percentage
+
+    // ---- Heel-strike log (written by the GaitMonitor, every consumer owns a cursor on its own cache line inside SpmcLog) ----
+    SpmcLog<HeelStrikeRecord, kHeelStrikeLogCapacity, kMaxHeelStrikeConsumers> heel_strike_log; // Every foot-strike in order, read with MemManager::PollHeelStrike
+
+     // Other variables (can be different types!) added here as needed, inside the block of their writer
+};
+
+// Every writer block must start on its own cache line
+static_assert(offsetof(SharedMemStruct, value1) % 64 == 0, "control block is not cache-line aligned");
+static_assert(offsetof(SharedMemStruct, vsm_left_dStiffness_kNpm) % 64 == 0, "actuator command block is not cache-line aligned");
+static_assert(offsetof(SharedMemStruct, vsm_left_aPos_cnts) % 64 == 0, "actuator feedback block is not cache-line aligned");
+static_assert(offsetof(SharedMemStruct, marker_seq) % 64 == 0, "marker block is not cache-line aligned");
+static_assert(offsetof(SharedMemStruct, marker_waiters) % 64 == 0, "marker consumer block is not cache-line aligned");
+static_assert(offsetof(SharedMemStruct, left_gc) % 64 == 0, "gait event block is not cache-line aligned");
+static_assert(offsetof(SharedMemStruct, left_gc_pct) % 64 == 0, "gait phase block is not cache-line aligned");
+static_assert(offsetof(SharedMemStruct, heel_strike_log) % 64 == 0, "heel-strike log is not cache-line aligned");
\ No newline at end of file
@@ -0,0 +1,117 @@
+#pragma once // Ensure inclusion only once
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+
+/*  Fixed-capacity, lock-free single-producer/multi-consumer broadcast log that can live inside the shared memory.
+*   It has no constructor: a zero-filled region (as created by MemManager) is an empty log without consumers.
+*
+*   Every element is delivered to every subscribed consumer, exactly once and in order: each consumer owns a read
+*   cursor (on its own cache line) and the log itself is never modified by the consumers. The producer never waits
+*   for the consumers: it overwrites the oldest element when the log is full. Each slot carries the position of the
+*   element it holds, so a consumer that fell more than Capacity elements behind notices it, skips to the oldest
+*   element still available and counts the skipped elements in its "lost" counter (they are never delivered twice).
+*   Consumers subscribe with Subscribe() and must Unsubscribe() when they exit, otherwise their cursor stays reserved.
+*/
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "std::atomic<unsigned long long> must be lock-free to be used in shared memory");
+
+template <typename T, size_t Capacity, size_t MaxConsumers>
+struct SpmcLog {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SpmcLog capacity must be a power of two");
+
+    // Cache-line aligned slot. "position" is the position of the element plus one once it is complete,
+    // and kWriting while the producer is overwriting it.
+    struct alignas(64) Slot {
+        std::atomic<unsigned long long> position;
+        T value;
+    };
+
+    // Read cursor of one consumer
+    struct alignas(64) Cursor {
+        std::atomic<unsigned int> active;               // 1 while the cursor is owned by a consumer
+        std::atomic<unsigned long long> next;           // Position of the next element to be read
+        std::atomic<unsigned long long> lost;           // Elements overwritten before this consumer read them
+    };
+
+    static const unsigned long long kWriting = ~0ull;
+
+    alignas(64) std::atomic<unsigned long long> head;  // Number of elements published (owned by the producer)
+    Cursor cursors[MaxConsumers];
+    Slot slots[Capacity];
+
+    // Producer: append an element, overwriting the oldest one if the log is full
+    void Publish(const T& value) {
+        unsigned long long h = head.load(std::memory_order_relaxed);
+        Slot& slot = slots[h & (Capacity - 1)];
+        slot.position.store(kWriting, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(&slot.value, &value, sizeof(T));
+        slot.position.store(h + 1, std::memory_order_release);
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    // Consumer: reserve a read cursor, positioned after the last published element.
+    // Returns the consumer id, or -1 if all MaxConsumers cursors are in use.
+    int Subscribe() {
+        for (size_t c = 0; c < MaxConsumers; c++) {
+            unsigned int expected = 0;
+            if (cursors[c].active.compare_exchange_strong(expected, 1u, std::memory_order_acq_rel)) {
+                cursors[c].lost.store(0, std::memory_order_relaxed);
+                cursors[c].next.store(head.load(std::memory_order_acquire), std::memory_order_release);
+                return static_cast<int>(c);
+            }
+        }
+        return -1;
+    }
+
+    // Consumer: release a read cursor
+    void Unsubscribe(int consumer) {
+        cursors[consumer].active.store(0, std::memory_order_release);
+    }
+
+    // Consumer: take the next element. Returns false if this consumer has read every published element.
+    bool Poll(int consumer, T& value) {
+        Cursor& cursor = cursors[consumer];
+        unsigned long long next = cursor.next.load(std::memory_order_relaxed);
+        while (true) {
+            unsigned long long h = head.load(std::memory_order_acquire);
+            if (next == h) {
+                return false;
+            }
+            // Elements older than the last Capacity ones have been overwritten
+            if (h - next > Capacity) {
+                cursor.lost.store(cursor.lost.load(std::memory_order_relaxed) + (h - Capacity - next), std::memory_order_relaxed);
+                next = h - Capacity;
+                cursor.next.store(next, std::memory_order_release);
+            }
+            const Slot& slot = slots[next & (Capacity - 1)];
+            if (slot.position.load(std::memory_order_acquire) == next + 1) {
+                std::memcpy(&value, &slot.value, sizeof(T));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.position.load(std::memory_order_relaxed) == next + 1) {
+                    cursor.next.store(next + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            // The slot is being (or has been) overwritten by a newer element: this element is lost
+            cursor.lost.store(cursor.lost.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            next++;
+            cursor.next.store(next, std::memory_order_release);
+        }
+    }
+
+    // Number of elements this consumer has not read yet (at most Capacity of them are still available)
+    size_t Pending(int consumer) const {
+        return static_cast<size_t>(head.load(std::memory_order_acquire) - cursors[consumer].next.load(std::memory_order_relaxed));
+    }
+
+    unsigned long long Lost(int consumer) const {
+        return cursors[consumer].lost.load(std::memory_order_relaxed);
+    }
+
+    unsigned long long Published() const {
+        return head.load(std::memory_order_acquire);
+    }
+};
@@ -0,0 +1,91 @@
+#pragma once // Ensure inclusion only once
+
+#include <atomic>
+#include <cstddef>
+
+/*  Fixed-capacity, lock-free single-producer/single-consumer ring buffer that can live inside the shared memory.
+*   It has no constructor: a zero-filled region (as created by MemManager) is an empty ring.
+*
+*   The producer and consumer indices are free-running 64-bit counters on separate cache lines, and every slot
+*   is padded to whole cache lines, so the producer and the consumer never write to the same line. The producer
+*   never blocks: when the ring is full the new element is dropped and counted in "overruns".
+*/
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "std::atomic<unsigned long long> must be lock-free to be used in shared memory");
+
+template <typename T, size_t Capacity>
+struct SpscRing {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SpscRing capacity must be a power of two");
+
+    // Cache-line aligned slot, so that neighbouring elements are never split across the producer and consumer
+    struct alignas(64) Slot {
+        T value;
+    };
+
+    alignas(64) std::atomic<unsigned long long> head;      // Next element to be written (owned by the producer)
+    unsigned long long cached_tail;                         // Producer's last seen value of "tail"
+    std::atomic<unsigned long long> overruns;               // Elements dropped because the ring was full (owned by the producer)
+    alignas(64) std::atomic<unsigned long long> tail;      // Next element to be read (owned by the consumer)
+    unsigned long long cached_head;                         // Consumer's last seen value of "head"
+    alignas(64) Slot slots[Capacity];
+
+    // Producer: append an element. Returns false and counts an overrun if the ring is full.
+    bool Push(const T& value) {
+        unsigned long long h = head.load(std::memory_order_relaxed);
+        if (h - cached_tail >= Capacity) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (h - cached_tail >= Capacity) {
+                overruns.store(overruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+        slots[h & (Capacity - 1)].value = value;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: remove the oldest element. Returns false if the ring is empty.
+    bool Pop(T& value) {
+        unsigned long long t = tail.load(std::memory_order_relaxed);
+        if (t == cached_head) {
+            cached_head = head.load(std::memory_order_acquire);
+            if (t == cached_head) {
+                return false;
+            }
+        }
+        value = slots[t & (Capacity - 1)].value;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: remove up to "max_count" of the oldest elements in order. Returns the number of elements copied.
+    size_t PopBatch(T* values, size_t max_count) {
+        unsigned long long t = tail.load(std::memory_order_relaxed);
+        cached_head = head.load(std::memory_order_acquire);
+        size_t count = static_cast<size_t>(cached_head - t);
+        if (count > max_count) {
+            count = max_count;
+        }
+        for (size_t i = 0; i < count; i++) {
+            values[i] = slots[(t + i) & (Capacity - 1)].value;
+        }
+        tail.store(t + count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer: discard every pending element (e.g. when attaching to a producer that has been running for a while)
+    void SkipToLatest() {
+        cached_head = head.load(std::memory_order_acquire);
+        tail.store(cached_head, std::memory_order_release);
+    }
+
+    // Number of elements waiting to be read (exact for the consumer, a lower bound for the producer)
+    size_t Size() const {
+        unsigned long long t = tail.load(std::memory_order_acquire);
+        return static_cast<size_t>(head.load(std::memory_order_acquire) - t);
+    }
+
+    unsigned long long Overruns() const {
+        return overruns.load(std::memory_order_relaxed);
+    }
+};
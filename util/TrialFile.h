@@ -0,0 +1,307 @@
+// Binary trial file reader/writer
+#pragma once // Ensure inclusion only once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <cerrno>
+  #include <fcntl.h>      // For open()
+  #include <sys/mman.h>   // For mmap()
+  #include <sys/stat.h>   // For fstat()
+  #include <unistd.h>     // For close()
+#endif
+
+/*  Compact binary format of a recorded trial (file extension .fvt), replacing the whitespace separated .txt recordings
+*   when many trials have to be reprocessed. A file consists of:
+*       1) a TrialFileHeader (magic "FVTR", version, number of columns, number of frames, sampling rate)
+*       2) one TrialColumnHeader per column (name, e.g. "frame" or "LHEEz", element type and byte offset of the data)
+*       3) the data of every column, stored contiguously (columnar) and aligned to 64 bytes
+*   The data are stored in the byte order of the machine that wrote the file (little endian on x86 and ARM).
+*   TrialFile maps a file read-only into memory, so the columns are accessed in place as TrialSpan objects without
+*   copying or parsing. WriteTrialFile creates a file from columns held in memory.
+*/
+
+// Enum defining the possible element types of a trial column
+enum class TrialColumnType : uint32_t {
+    INT32 = 0,
+    FLOAT32,
+    FLOAT64
+};
+
+struct TrialFileHeader {
+    char magic[4];                  // "FVTR"
+    uint32_t version;               // Format version (kTrialFileVersion)
+    uint32_t num_columns;           // Number of columns
+    uint32_t reserved;
+    uint64_t num_frames;            // Number of frames (elements per column)
+    double sample_rate;             // [Hz] Sampling rate of the recording
+};
+
+struct TrialColumnHeader {
+    char name[16];                  // Zero-terminated column name (marker coordinate such as "LHEEz", or "frame")
+    TrialColumnType type;           // Element type
+    uint32_t reserved;
+    uint64_t offset;                // Byte offset of the column data from the start of the file
+};
+
+const uint32_t kTrialFileVersion = 1;
+
+// Read-only view of the elements of one column (a minimal span)
+template <typename T>
+struct TrialSpan {
+    const T* data;
+    size_t size;
+
+    const T& operator[](size_t i) const { return data[i]; }
+    const T* begin() const { return data; }
+    const T* end() const { return data + size; }
+    bool empty() const { return size == 0; }
+};
+
+// Column to be written with WriteTrialFile (the data must hold "num_frames" elements of the given type)
+struct TrialColumn {
+    std::string name;
+    TrialColumnType type;
+    const void* data;
+};
+
+inline size_t TrialColumnTypeSize(TrialColumnType type) {
+    return type == TrialColumnType::FLOAT64 ? 8 : 4;
+}
+
+template <typename T> struct TrialColumnTypeOf;
+template <> struct TrialColumnTypeOf<int32_t> { static const TrialColumnType value = TrialColumnType::INT32; };
+template <> struct TrialColumnTypeOf<float> { static const TrialColumnType value = TrialColumnType::FLOAT32; };
+template <> struct TrialColumnTypeOf<double> { static const TrialColumnType value = TrialColumnType::FLOAT64; };
+
+// Write a trial file. Returns false (and prints the reason) on failure.
+inline bool WriteTrialFile(const std::string& path, double sample_rate, size_t num_frames, const std::vector<TrialColumn>& columns) {
+    TrialFileHeader header = {};
+    std::memcpy(header.magic, "FVTR", 4);
+    header.version = kTrialFileVersion;
+    header.num_columns = static_cast<uint32_t>(columns.size());
+    header.num_frames = num_frames;
+    header.sample_rate = sample_rate;
+
+    // Lay out the column data after the headers, every column starting on a 64-byte boundary
+    std::vector<TrialColumnHeader> column_headers(columns.size());
+    uint64_t offset = sizeof(TrialFileHeader) + columns.size() * sizeof(TrialColumnHeader);
+    for (size_t c = 0; c < columns.size(); c++) {
+        if (columns[c].name.size() >= sizeof(column_headers[c].name)) {
+            std::cerr << "Trial column name too long: " << columns[c].name << std::endl;
+            return false;
+        }
+        std::memset(&column_headers[c], 0, sizeof(TrialColumnHeader));
+        std::memcpy(column_headers[c].name, columns[c].name.c_str(), columns[c].name.size());
+        column_headers[c].type = columns[c].type;
+        offset = (offset + 63) / 64 * 64;
+        column_headers[c].offset = offset;
+        offset += num_frames * TrialColumnTypeSize(columns[c].type);
+    }
+
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        std::cerr << "Error opening the file " << path << " for writing." << std::endl;
+        return false;
+    }
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    if (!columns.empty()) {
+        ok = ok && std::fwrite(column_headers.data(), sizeof(TrialColumnHeader), columns.size(), file) == columns.size();
+    }
+    const char padding[64] = {};
+    for (size_t c = 0; c < columns.size() && ok; c++) {
+        long position = std::ftell(file);
+        ok = std::fwrite(padding, 1, static_cast<size_t>(column_headers[c].offset - position), file) == column_headers[c].offset - position;
+        size_t bytes = num_frames * TrialColumnTypeSize(columns[c].type);
+        ok = ok && (bytes == 0 || std::fwrite(columns[c].data, 1, bytes, file) == bytes);
+    }
+    ok = (std::fclose(file) == 0) && ok;
+    if (!ok) {
+        std::cerr << "Error writing the file " << path << std::endl;
+    }
+    return ok;
+}
+
+class TrialFile {
+private:
+    const char* base_;              // Start of the mapped file
+    size_t size_;                   // Size of the mapped file in bytes
+    const TrialFileHeader* header_;
+    const TrialColumnHeader* columns_;
+#ifdef _WIN32
+    HANDLE file_handle_;
+    HANDLE mapping_handle_;
+#endif
+
+public:
+    TrialFile() : base_(nullptr), size_(0), header_(nullptr), columns_(nullptr) {
+#ifdef _WIN32
+        file_handle_ = INVALID_HANDLE_VALUE;
+        mapping_handle_ = nullptr;
+#endif
+    }
+
+    ~TrialFile() {
+        Close();
+    }
+
+    TrialFile(const TrialFile&) = delete;
+    TrialFile& operator=(const TrialFile&) = delete;
+
+    // Map a trial file into memory and validate its headers
+    bool Open(const std::string& path) {
+        Close();
+#ifdef _WIN32
+        file_handle_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_handle_ == INVALID_HANDLE_VALUE) {
+            std::cerr << "Error opening the file " << path << ": " << GetLastError() << std::endl;
+            return false;
+        }
+        LARGE_INTEGER file_size;
+        GetFileSizeEx(file_handle_, &file_size);
+        size_ = static_cast<size_t>(file_size.QuadPart);
+        if (size_ > 0) {
+            mapping_handle_ = CreateFileMappingA(file_handle_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping_handle_ != nullptr) {
+                base_ = static_cast<const char*>(MapViewOfFile(mapping_handle_, FILE_MAP_READ, 0, 0, 0));
+            }
+            if (base_ == nullptr) {
+                std::cerr << "MapViewOfFile failed for " << path << ": " << GetLastError() << std::endl;
+                Close();
+                return false;
+            }
+        }
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd == -1) {
+            std::cerr << "Error opening the file " << path << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        struct stat file_stat;
+        fstat(fd, &file_stat);
+        size_ = static_cast<size_t>(file_stat.st_size);
+        if (size_ > 0) {
+            void* addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED) {
+                std::cerr << "mmap failed for " << path << ": " << std::strerror(errno) << std::endl;
+                close(fd);
+                size_ = 0;
+                return false;
+            }
+            base_ = static_cast<const char*>(addr);
+            madvise(addr, size_, MADV_SEQUENTIAL);
+        }
+        close(fd);  // The mapping stays valid after the descriptor is closed
+#endif
+
+        // Validate the headers and the column extents
+        header_ = reinterpret_cast<const TrialFileHeader*>(base_);
+        if (size_ < sizeof(TrialFileHeader) || std::memcmp(header_->magic, "FVTR", 4) != 0 || header_->version != kTrialFileVersion) {
+            std::cerr << "Not a trial file (or unsupported version): " << path << std::endl;
+            Close();
+            return false;
+        }
+        columns_ = reinterpret_cast<const TrialColumnHeader*>(base_ + sizeof(TrialFileHeader));
+        if (sizeof(TrialFileHeader) + header_->num_columns * sizeof(TrialColumnHeader) > size_) {
+            std::cerr << "Truncated trial file: " << path << std::endl;
+            Close();
+            return false;
+        }
+        for (uint32_t c = 0; c < header_->num_columns; c++) {
+            if (columns_[c].type > TrialColumnType::FLOAT64 || columns_[c].offset % 64 != 0 ||
+                columns_[c].offset + header_->num_frames * TrialColumnTypeSize(columns_[c].type) > size_) {
+                std::cerr << "Invalid column " << c << " in trial file: " << path << std::endl;
+                Close();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Unmap the file
+    void Close() {
+#ifdef _WIN32
+        if (base_ != nullptr) {
+            UnmapViewOfFile(base_);
+        }
+        if (mapping_handle_ != nullptr) {
+            CloseHandle(mapping_handle_);
+            mapping_handle_ = nullptr;
+        }
+        if (file_handle_ != INVALID_HANDLE_VALUE) {
+            CloseHandle(file_handle_);
+            file_handle_ = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (base_ != nullptr) {
+            munmap(const_cast<char*>(base_), size_);
+        }
+#endif
+        base_ = nullptr;
+        size_ = 0;
+        header_ = nullptr;
+        columns_ = nullptr;
+    }
+
+    bool IsOpen() const { return header_ != nullptr; }
+    size_t NumFrames() const { return static_cast<size_t>(header_->num_frames); }
+    double SampleRate() const { return header_->sample_rate; }
+    int NumColumns() const { return static_cast<int>(header_->num_columns); }
+    const char* ColumnName(int column) const { return columns_[column].name; }
+    TrialColumnType ColumnType(int column) const { return columns_[column].type; }
+
+    // Index of the column with the given name, or -1 if there is none
+    int FindColumn(const std::string& name) const {
+        for (uint32_t c = 0; c < header_->num_columns; c++) {
+            if (std::strncmp(columns_[c].name, name.c_str(), sizeof(columns_[c].name)) == 0) {
+                return static_cast<int>(c);
+            }
+        }
+        return -1;
+    }
+
+    // Zero-copy view of a column. Returns an empty span if the column does not exist or has another element type.
+    template <typename T>
+    TrialSpan<T> Column(int column) const {
+        TrialSpan<T> span = {nullptr, 0};
+        if (column >= 0 && column < NumColumns() && columns_[column].type == TrialColumnTypeOf<T>::value) {
+            span.data = reinterpret_cast<const T*>(base_ + columns_[column].offset);
+            span.size = NumFrames();
+        }
+        return span;
+    }
+
+    template <typename T>
+    TrialSpan<T> Column(const std::string& name) const {
+        return Column<T>(FindColumn(name));
+    }
+
+    // Element of any column converted to double (convenient when the element type is not known in advance)
+    double Value(int column, size_t frame) const {
+        const char* element = base_ + columns_[column].offset + frame * TrialColumnTypeSize(columns_[column].type);
+        switch (columns_[column].type) {
+            case TrialColumnType::INT32: {
+                int32_t value;
+                std::memcpy(&value, element, sizeof(value));
+                return value;
+            }
+            case TrialColumnType::FLOAT32: {
+                float value;
+                std::memcpy(&value, element, sizeof(value));
+                return value;
+            }
+            default: {
+                double value;
+                std::memcpy(&value, element, sizeof(value));
+                return value;
+            }
+        }
+    }
+};
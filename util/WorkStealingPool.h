@@ -0,0 +1,189 @@
+#pragma once // Ensure inclusion only once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*  Fixed-size thread pool running the iterations of a loop (e.g. the runs of a parameter sweep) on all cores.
+*   Run(count, fn) calls fn(index, worker) once for every index in [0, count), with "worker" in [0, Threads()),
+*   and returns when all calls have finished. The calling thread is worker 0 and takes part in the work.
+*
+*   The indices are first split into one contiguous range per worker. A worker takes the indices of its own range
+*   from the front; once its range is empty, it steals the back half of the largest remaining range of another worker.
+*   Iterations of very different cost therefore keep all workers busy until the end, without a shared queue that
+*   every worker contends on. The threads are created once, and Run itself does not allocate memory: fn is called
+*   through a plain function pointer, so per-worker scratch buffers allocated before Run are reused across iterations.
+*/
+
+class WorkStealingPool {
+public:
+    // numThreads: number of workers including the calling thread (0: one per hardware thread)
+    explicit WorkStealingPool(int numThreads = 0) : queues_(), generation_(0), busy_(0), stop_(false), job_(nullptr), invoke_(nullptr), steals_(0) {
+        if (numThreads <= 0) {
+            unsigned hardware_threads = std::thread::hardware_concurrency();
+            numThreads = hardware_threads > 0 ? static_cast<int>(hardware_threads) : 1;
+        }
+        num_workers_ = numThreads;
+        queues_.reset(new Queue[num_workers_]);
+        for (int worker = 1; worker < num_workers_; worker++) {
+            threads_.emplace_back(&WorkStealingPool::WorkerLoop, this, worker);
+        }
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            stop_ = true;
+        }
+        start_cv_.notify_all();
+        for (std::thread& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    int Threads() const {
+        return num_workers_;
+    }
+
+    // Number of ranges stolen since the pool was created (a measure of the load imbalance that was corrected)
+    unsigned long long Steals() const {
+        return steals_.load(std::memory_order_relaxed);
+    }
+
+    // Call fn(index, worker) for every index in [0, count) on all workers and wait for the calls to finish
+    template <typename Fn>
+    void Run(size_t count, Fn& fn) {
+        if (count == 0) {
+            return;
+        }
+        // Split the indices into one contiguous range per worker
+        for (int worker = 0; worker < num_workers_; worker++) {
+            std::lock_guard<std::mutex> guard(queues_[worker].lock);
+            queues_[worker].begin = count * worker / num_workers_;
+            queues_[worker].end = count * (worker + 1) / num_workers_;
+        }
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            job_ = &fn;
+            invoke_ = [](void* job, size_t index, int worker) { (*static_cast<Fn*>(job))(index, worker); };
+            busy_ = num_workers_ - 1;
+            generation_++;
+        }
+        start_cv_.notify_all();
+
+        Work(0);
+
+        // Wait for the other workers to finish their last iteration
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_cv_.wait(lock, [this]() { return busy_ == 0; });
+        job_ = nullptr;
+        invoke_ = nullptr;
+    }
+
+private:
+    // Range of indices owned by one worker, padded to its own cache lines
+    struct Queue {
+        std::mutex lock;
+        size_t begin = 0, end = 0;
+        char padding[64];
+    };
+
+    std::vector<std::thread> threads_;
+    std::unique_ptr<Queue[]> queues_;
+    int num_workers_;
+    std::mutex mutex_;
+    std::condition_variable start_cv_, done_cv_;
+    unsigned long long generation_;             // Incremented by every Run, so that the workers start each loop once
+    int busy_;                                  // Number of worker threads still running the current loop
+    bool stop_;
+    void* job_;                                 // Loop body of the current Run and its caller
+    void (*invoke_)(void*, size_t, int);
+    std::atomic<unsigned long long> steals_;
+
+    void WorkerLoop(int worker) {
+        unsigned long long seen_generation = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                start_cv_.wait(lock, [this, seen_generation]() { return stop_ || generation_ != seen_generation; });
+                if (stop_) {
+                    return;
+                }
+                seen_generation = generation_;
+            }
+            Work(worker);
+            {
+                std::lock_guard<std::mutex> guard(mutex_);
+                busy_--;
+            }
+            done_cv_.notify_one();
+        }
+    }
+
+    // Run the iterations of the own range, then of stolen ranges, until no range has indices left
+    void Work(int worker) {
+        size_t index;
+        while (Pop(worker, index) || Steal(worker, index)) {
+            invoke_(job_, index, worker);
+        }
+    }
+
+    bool Pop(int worker, size_t& index) {
+        Queue& queue = queues_[worker];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (queue.begin == queue.end) {
+            return false;
+        }
+        index = queue.begin++;
+        return true;
+    }
+
+    // Steal the back half of the largest range of the other workers; the first stolen index is returned, the rest
+    // becomes the range of this worker
+    bool Steal(int worker, size_t& index) {
+        while (true) {
+            int victim = -1;
+            size_t largest = 0;
+            for (int other = 0; other < num_workers_; other++) {
+                if (other == worker) {
+                    continue;
+                }
+                std::lock_guard<std::mutex> guard(queues_[other].lock);
+                size_t size = queues_[other].end - queues_[other].begin;
+                if (size > largest) {
+                    largest = size;
+                    victim = other;
+                }
+            }
+            if (victim < 0) {
+                return false;
+            }
+            size_t stolen_begin, stolen_end;
+            {
+                std::lock_guard<std::mutex> guard(queues_[victim].lock);
+                size_t size = queues_[victim].end - queues_[victim].begin;
+                if (size == 0) {
+                    continue;   // the victim finished its range in the meantime: look for another one
+                }
+                stolen_end = queues_[victim].end;
+                stolen_begin = stolen_end - (size + 1) / 2;
+                queues_[victim].end = stolen_begin;
+            }
+            {
+                std::lock_guard<std::mutex> guard(queues_[worker].lock);
+                queues_[worker].begin = stolen_begin + 1;
+                queues_[worker].end = stolen_end;
+            }
+            steals_.fetch_add(1, std::memory_order_relaxed);
+            index = stolen_begin;
+            return true;
+        }
+    }
+};